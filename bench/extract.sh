@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# End-to-end extractor benchmark. Generate a fixed synthetic collection, once,
+# then extract it with the fixed configuration in extract.ini and print the
+# `--stats` report of the extractor. Arguments after the binary directory are
+# passed on to the extractor, e.g. `--threads 4`.
+
+set -e
+
+SPATH="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <bin dir> [extractor options]" >&2
+    exit 1
+fi
+
+BIN=$1
+shift
+
+# The collection, change the index name along with the options
+WORK=${FXT_BENCH_DIR:-$SPATH/extract.work}
+INDEX=$WORK/synth-100k-v1
+
+mkdir -p $WORK
+if [ ! -d $INDEX ]; then
+    $BIN/generate_synthetic_index --docs 100000 --doc_len 400 \
+        --length_dist lognormal --vocab 100000 --seed 42 \
+        --queries 200 --query_len 3 --query_seed 7 --run_depth 1000 \
+        $INDEX >&2
+fi
+
+$BIN/extractor -c $SPATH/extract.ini \
+    --docnos $INDEX/docnos --field_ids $INDEX/field_ids \
+    --forward_index $INDEX/forward_index \
+    --inverted_index $INDEX/inverted_index \
+    --lexicon $INDEX/lexicon \
+    --static_doc_file $INDEX/static_doc \
+    --stats $WORK/stats.json \
+    "$@" \
+    $INDEX/queries $INDEX/run $WORK/features.csv 2> $WORK/extractor.log
+
+cat $WORK/stats.json
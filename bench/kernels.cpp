@@ -0,0 +1,544 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CLI/CLI.hpp"
+
+#include "fxt/arena_forward_index.hpp"
+#include "fxt/batch_scorer.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/features/features.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/forward_index_reader.hpp"
+#include "fxt/fused_scorer.hpp"
+#include "fxt/inverted_index.hpp"
+#include "fxt/lexicon.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/query_term_positions.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/simd.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+#include "fixture/stub_index.hpp"
+
+/*
+ * Count heap allocations, so that allocations per document can be reported
+ * next to the time. The benchmark is single threaded.
+ */
+static size_t alloc_count = 0;
+
+void *operator new(size_t n) {
+  ++alloc_count;
+  if (void *p = std::malloc(n ? n : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+/**
+ * The documents and queries a kernel is timed on. Every document is decoded
+ * up front, so that only the kernel itself is timed.
+ */
+struct BenchCorpus {
+  std::string name;
+  Lexicon lexicon;
+  FieldIdMap field_ids;
+  ForwardIndex documents;
+  InvertedIndex inverted_index;
+  std::vector<query_train> queries;
+
+  // Docids of the non-empty documents, their decoded views, and the
+  // positions of the terms of each query in them
+  std::vector<size_t> docids;
+  std::vector<DocumentView> views;
+  std::vector<std::vector<QueryTermPositions>> query_positions;
+  double avg_doc_len = 0.0;
+
+  const QueryTermPositions &positions(const query_train &qry, size_t i) const {
+    return query_positions[&qry - queries.data()][i];
+  }
+
+  void prepare() {
+    for (size_t i = 0; i < documents.size(); ++i) {
+      if (documents[i].length() > 0) {
+        docids.push_back(i);
+      }
+    }
+    views.resize(docids.size());
+    size_t total_len = 0;
+    for (size_t i = 0; i < docids.size(); ++i) {
+      views[i].decode(documents[docids[i]]);
+      total_len += views[i].length();
+    }
+    query_positions.resize(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+      query_positions[q].resize(docids.size(), QueryTermPositions(queries[q]));
+      for (size_t i = 0; i < docids.size(); ++i) {
+        query_positions[q][i].build(views[i].terms());
+      }
+    }
+    avg_doc_len = docids.empty() ? 0.0 : double(total_len) / docids.size();
+  }
+};
+
+static BenchCorpus fixture_corpus() {
+  BenchCorpus corpus;
+  corpus.name = "fixture";
+  corpus.lexicon = fixture::stub_lexicon();
+  corpus.inverted_index = fixture::stub_inverted_index();
+  for (auto &doc : fixture::stub_forward_index()) {
+    doc.compress();
+    corpus.documents.push_back(doc);
+  }
+  // The fixture has no field statistics, so the ids only need to be the ones
+  // its documents list.
+  corpus.field_ids = {{"body", 2}, {"title", 3}, {"heading", 4},
+                      {"inlink", 5}, {"a", 8}};
+  // `fixture::stub_query` leaves out the term positions that proximity needs
+  const Lexicon &lex = corpus.lexicon;
+  corpus.queries.push_back(
+      query_train_file::parse_line("1;model agnostic", lex));
+  corpus.queries.push_back(query_train_file::parse_line(
+      "2;" + lex.term(264) + " " + lex.term(493) + " " + lex.term(334), lex));
+  corpus.prepare();
+  return corpus;
+}
+
+static BenchCorpus synthetic_corpus(size_t num_docs, size_t doc_len) {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = num_docs;
+  opts.doc_len = doc_len;
+  opts.vocab_size = 50000;
+  SyntheticCorpus synthetic(opts);
+
+  BenchCorpus corpus;
+  corpus.name = "synthetic_" + std::to_string(doc_len);
+  corpus.field_ids = synthetic.field_ids;
+  corpus.queries = synthetic.queries(4, 3);
+  corpus.lexicon = std::move(synthetic.lexicon);
+  corpus.documents = std::move(synthetic.documents);
+  corpus.inverted_index = std::move(synthetic.inverted_index);
+  corpus.prepare();
+  return corpus;
+}
+
+struct BenchResult {
+  std::string kernel;
+  std::string corpus;
+  size_t docs;
+  size_t queries;
+  double avg_doc_len;
+  size_t iterations;
+  double ns_per_doc;
+  double allocs_per_doc;
+};
+
+// Keeps the results of the kernels alive
+static volatile double sink;
+
+/**
+ * Time `kernel(qry, i)` over every query and document of `corpus`. One
+ * untimed pass warms up the caches and any scratch space the kernel keeps,
+ * then passes are repeated for at least `min_ms`.
+ */
+template <typename Kernel>
+static BenchResult run(const std::string &name, BenchCorpus &corpus,
+                       double min_ms, Kernel kernel) {
+  using clock = std::chrono::steady_clock;
+  auto pass = [&]() {
+    for (auto &qry : corpus.queries) {
+      for (size_t i = 0; i < corpus.docids.size(); ++i) {
+        sink = kernel(qry, i);
+      }
+    }
+  };
+
+  pass();
+  size_t iterations = 0;
+  size_t allocs = alloc_count;
+  auto start = clock::now();
+  double elapsed_ms = 0.0;
+  do {
+    pass();
+    ++iterations;
+    elapsed_ms =
+        std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  } while (elapsed_ms < min_ms);
+  allocs = alloc_count - allocs;
+
+  double calls =
+      double(iterations) * corpus.queries.size() * corpus.docids.size();
+  return {name,
+          corpus.name,
+          corpus.docids.size(),
+          corpus.queries.size(),
+          corpus.avg_doc_len,
+          iterations,
+          calls > 0 ? elapsed_ms * 1e6 / calls : 0.0,
+          calls > 0 ? allocs / calls : 0.0};
+}
+
+/**
+ * Run every kernel whose name contains `filter` on `corpus`.
+ */
+static void bench_corpus(BenchCorpus &corpus, const std::string &filter,
+                         double min_ms, std::vector<BenchResult> &results) {
+  Lexicon &lex = corpus.lexicon;
+  FieldIdMap &fids = corpus.field_ids;
+  auto bench = [&](const std::string &name, auto kernel) {
+    if (std::string::npos == name.find(filter)) {
+      return;
+    }
+    std::cerr << corpus.name << " " << name << "..." << std::endl;
+    results.push_back(run(name, corpus, min_ms, kernel));
+  };
+  // The query contexts are built once, as the extractor does for each query
+  std::vector<QueryContext> contexts;
+  for (const auto &qry : corpus.queries) {
+    contexts.emplace_back(lex, fids, qry);
+  }
+  auto context = [&](const query_train &qry) -> const QueryContext & {
+    return contexts[&qry - corpus.queries.data()];
+  };
+  // As are the query term frequencies of each document, which the extractor
+  // gathers once for all of the families
+  std::vector<std::vector<QueryTermFreqs>> query_freqs(corpus.queries.size());
+  for (size_t q = 0; q < corpus.queries.size(); ++q) {
+    query_freqs[q].resize(corpus.docids.size());
+    for (size_t i = 0; i < corpus.docids.size(); ++i) {
+      query_freqs[q][i].gather(contexts[q], corpus.views[i]);
+    }
+  }
+  auto freqs = [&](const query_train &qry, size_t i) -> const QueryTermFreqs & {
+    return query_freqs[&qry - corpus.queries.data()][i];
+  };
+  // Time `compute` of a feature family that only needs the query context and
+  // the query term frequencies.
+  auto bench_feature = [&](const std::string &name, auto &family,
+                           feature::Id score) {
+    bench(name, [&, score](query_train &qry, size_t i) {
+      FeatureRow row = {};
+      family.compute(context(qry), row, freqs(qry, i));
+      return row[score];
+    });
+  };
+
+  doc_bm25_atire_feature bm25_atire;
+  doc_bm25_trec3_feature bm25_trec3;
+  doc_bm25_trec3_kmax_feature bm25_trec3_kmax;
+  doc_lm_dir_2500_feature lm_dir_2500;
+  doc_lm_dir_1500_feature lm_dir_1500;
+  doc_lm_dir_1000_feature lm_dir_1000;
+  doc_tfidf_feature tfidf;
+  doc_prob_feature prob;
+  doc_be_feature be;
+  doc_dph_feature dph;
+  doc_dfr_feature dfr;
+  doc_stream_feature stream;
+  document_features tag_count;
+  doc_tpscore_feature tpscore;
+  doc_proximity_feature proximity;
+  Sdm sdm;
+  DocSdmFeature f_sdm(sdm);
+  InMemoryForwardIndex fwdidx(corpus.documents);
+  // Compute every feature, as the term weighting families do by default
+  FeatureFlags all_flags;
+  all_flags.fill(true);
+
+  bench_feature("bm25_atire", bm25_atire, feature::bm25_atire);
+  bench_feature("bm25_trec3", bm25_trec3, feature::bm25_trec3);
+  bench_feature("bm25_trec3_kmax", bm25_trec3_kmax, feature::bm25_trec3_kmax);
+  bench_feature("lm_dir_2500", lm_dir_2500, feature::lm_dir_2500);
+  bench_feature("lm_dir_1500", lm_dir_1500, feature::lm_dir_1500);
+  bench_feature("lm_dir_1000", lm_dir_1000, feature::lm_dir_1000);
+  bench_feature("tfidf", tfidf, feature::tfidf);
+  bench_feature("prob", prob, feature::prob);
+  bench_feature("be", be, feature::be);
+  bench_feature("dph", dph, feature::dph);
+  bench_feature("dfr", dfr, feature::dfr);
+  // All of the term weighting families of a document, one family at a time
+  // and in the single pass of `FusedScorer`, as the extractor scores them
+  bench("term_weighting_families", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    const auto &ctx = context(qry);
+    const auto &f = freqs(qry, i);
+    bm25_atire.compute(ctx, row, f);
+    bm25_trec3.compute(ctx, row, f);
+    bm25_trec3_kmax.compute(ctx, row, f);
+    lm_dir_2500.compute(ctx, row, f);
+    lm_dir_1500.compute(ctx, row, f);
+    lm_dir_1000.compute(ctx, row, f);
+    tfidf.compute(ctx, row, f);
+    prob.compute(ctx, row, f);
+    be.compute(ctx, row, f);
+    dph.compute(ctx, row, f);
+    dfr.compute(ctx, row, f);
+    return row[feature::dfr];
+  });
+  FusedScorer fused;
+  {
+    using F = FusedScorer::Family;
+    auto add = [&](F family, feature::Id first) {
+      family.outputs = {first};
+      fused.add(family);
+    };
+    add(F::make_bm25(bm25_atire.k1, bm25_atire.b), feature::bm25_atire);
+    add(F::make_bm25(bm25_trec3.k1, bm25_trec3.b), feature::bm25_trec3);
+    add(F::make_bm25(bm25_trec3_kmax.k1, bm25_trec3_kmax.b),
+        feature::bm25_trec3_kmax);
+    add(F::make_lm(lm_dir_2500.mu), feature::lm_dir_2500);
+    add(F::make_lm(lm_dir_1500.mu), feature::lm_dir_1500);
+    add(F::make_lm(lm_dir_1000.mu), feature::lm_dir_1000);
+    add(F::make(FusedScorer::tfidf), feature::tfidf);
+    add(F::make(FusedScorer::prob), feature::prob);
+    add(F::make(FusedScorer::be), feature::be);
+    add(F::make(FusedScorer::dph), feature::dph);
+    add(F::make(FusedScorer::dfr), feature::dfr);
+  }
+  bench("term_weighting_fused", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    fused.score(context(qry), freqs(qry, i), row);
+    return row[feature::dfr];
+  });
+  bench("stream", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    stream.compute(context(qry), row, corpus.views[i], freqs(qry, i),
+                   all_flags);
+    return row[feature::stream_len];
+  });
+  bench("tag_count", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    tag_count.compute(context(qry), row, corpus.views[i], all_flags);
+    return row[feature::tag_title_count];
+  });
+  bench("tpscore", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    tpscore.compute(context(qry), row, freqs(qry, i),
+                    corpus.positions(qry, i));
+    return row[feature::tpscore];
+  });
+  bench("proximity", [&](query_train &qry, size_t i) {
+    FeatureRow row = {};
+    proximity.compute(context(qry), row, freqs(qry, i),
+                      corpus.positions(qry, i), all_flags);
+    return row[feature::bm25_bigram_u8];
+  });
+  // The batch kernels score `ScoreBatch::width` documents at once, on the first
+  // of them, so that their time per document compares with the families above.
+  // The batches are laid out beforehand, as the extractor does once for all of
+  // the families, and `batch_load` times laying them out.
+  std::vector<std::vector<ScoreBatch>> query_batches(corpus.queries.size());
+  std::vector<std::vector<FloatScoreBatch>> query_float_batches(
+      corpus.queries.size());
+  for (size_t q = 0; q < corpus.queries.size(); ++q) {
+    for (size_t i = 0; i < corpus.docids.size(); i += ScoreBatch::width) {
+      size_t n = std::min(ScoreBatch::width, corpus.docids.size() - i);
+      query_batches[q].emplace_back();
+      query_batches[q].back().load(contexts[q], &query_freqs[q][i], n);
+      query_float_batches[q].emplace_back();
+      query_float_batches[q].back().load(contexts[q], &query_freqs[q][i], n);
+    }
+  }
+  ScoreBatch batch;
+  BatchScores batch_scores;
+  FloatBatchScores float_scores;
+  bench("batch_load", [&](query_train &qry, size_t i) {
+    if (0 == i % ScoreBatch::width) {
+      size_t n = std::min(ScoreBatch::width, corpus.docids.size() - i);
+      batch.load(context(qry), &freqs(qry, i), n);
+    }
+    return double(batch.size());
+  });
+  std::vector<std::pair<std::string, BatchFamily>> batch_families = {
+      {"bm25", BatchFamily::make_bm25(doc_bm25_atire_feature::k1,
+                                      doc_bm25_atire_feature::b)},
+      {"lm", BatchFamily::make_lm(doc_lm_dir_2500_feature::mu)},
+      {"tfidf", {BatchFamily::tfidf}},
+      {"be", {BatchFamily::be}},
+      {"dph", {BatchFamily::dph}},
+      {"dfr", {BatchFamily::dfr}}};
+  for (auto level : {SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512}) {
+    if (!simd_supported(level)) {
+      continue;
+    }
+    BatchScorer scorer(level);
+    for (const auto &family : batch_families) {
+      std::string name = std::string("batch_") + family.first + "_" +
+                         simd_level_name(level);
+      bench(name, [&](query_train &qry, size_t i) {
+        if (0 == i % ScoreBatch::width) {
+          const auto &batches = query_batches[&qry - corpus.queries.data()];
+          scorer.score(context(qry), batches[i / ScoreBatch::width],
+                       family.second, batch_scores);
+        }
+        return batch_scores.score[0][i % ScoreBatch::width];
+      });
+      bench(name + "_float", [&](query_train &qry, size_t i) {
+        if (0 == i % ScoreBatch::width) {
+          const auto &batches =
+              query_float_batches[&qry - corpus.queries.data()];
+          scorer.score(context(qry), batches[i / ScoreBatch::width],
+                       family.second, float_scores);
+        }
+        return double(float_scores.score[0][i % ScoreBatch::width]);
+      });
+    }
+  }
+  bench("sdm", [&](query_train &qry, size_t i) {
+    if (0 == i) {
+      f_sdm.set_query(qry, corpus.inverted_index);
+    }
+    FeatureRow row = {};
+    f_sdm.compute(context(qry), row, corpus.views[i], fwdidx,
+                  corpus.inverted_index, corpus.positions(qry, i));
+    return row[feature::sdm];
+  });
+  // The current document is counted from the query term positions, the
+  // documents scanned for collection statistics from all of their terms.
+  bench("sdm_ordered_phrase", [&](query_train &qry, size_t i) {
+    uint64_t count = 0;
+    for (const auto &bigram : sdm.bigrams(qry)) {
+      count += sdm.count_ordered_phrase(bigram, corpus.positions(qry, i));
+    }
+    return double(count);
+  });
+  bench("sdm_unordered_phrase", [&](query_train &qry, size_t i) {
+    uint64_t count = 0;
+    for (const auto &bigram : sdm.bigrams(qry)) {
+      count += sdm.count_unordered_phrase(bigram, corpus.positions(qry, i));
+    }
+    return double(count);
+  });
+  bench("sdm_ordered_phrase_scan", [&](query_train &qry, size_t i) {
+    uint64_t count = 0;
+    for (const auto &bigram : sdm.bigrams(qry)) {
+      count += sdm.count_ordered_phrase(bigram, corpus.views[i]);
+    }
+    return double(count);
+  });
+  bench("sdm_unordered_phrase_scan", [&](query_train &qry, size_t i) {
+    uint64_t count = 0;
+    for (const auto &bigram : sdm.bigrams(qry)) {
+      count += sdm.count_unordered_phrase(bigram, corpus.views[i]);
+    }
+    return double(count);
+  });
+  QueryTermPositions positions;
+  const query_train *positions_qry = nullptr;
+  bench("positions", [&](query_train &qry, size_t i) {
+    if (positions_qry != &qry) {
+      positions.set_query(qry);
+      positions_qry = &qry;
+    }
+    positions.build(corpus.views[i].terms());
+    return double(positions.hits().size());
+  });
+  QueryTermFreqs term_freqs;
+  bench("freqs", [&](query_train &qry, size_t i) {
+    term_freqs.gather(context(qry), corpus.views[i]);
+    return double(term_freqs.length());
+  });
+  DocumentView view;
+  bench("document_view_decode", [&](query_train &, size_t i) {
+    view.decode(corpus.documents[corpus.docids[i]]);
+    return double(view.length());
+  });
+  ArenaForwardIndex arena(corpus.documents);
+  Document scratch;
+  bench("arena_view_decode", [&](query_train &, size_t i) {
+    arena.decode(corpus.docids[i], view, scratch);
+    return double(view.length());
+  });
+  // Only the streams that BM25 of the whole document and title reads
+  DecodePlan bm25_plan;
+  bm25_plan.terms = false;
+  bm25_plan.all_fields = false;
+  bm25_plan.add_field(corpus.field_ids.at("title"));
+  DocumentView planned_view;
+  planned_view.set_plan(bm25_plan);
+  bench("arena_view_decode_bm25", [&](query_train &, size_t i) {
+    arena.decode(corpus.docids[i], planned_view, scratch);
+    return double(planned_view.length());
+  });
+  // Includes copying the compressed document, since `decompress` works in
+  // place. The copy reuses the capacity of `doc`.
+  Document doc;
+  bench("document_decompress", [&](query_train &, size_t i) {
+    doc = corpus.documents[corpus.docids[i]];
+    doc.decompress();
+    return double(doc.length());
+  });
+}
+
+static void write_json(std::ostream &os,
+                       const std::vector<BenchResult> &results) {
+  os << std::fixed << std::setprecision(3);
+  os << "{\"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    os << (0 == i ? "\n  " : ",\n  ") << "{\"kernel\": \"" << r.kernel
+       << "\", \"corpus\": \"" << r.corpus << "\", \"docs\": " << r.docs
+       << ", \"queries\": " << r.queries
+       << ", \"avg_doc_len\": " << r.avg_doc_len
+       << ", \"iterations\": " << r.iterations
+       << ", \"ns_per_doc\": " << r.ns_per_doc
+       << ", \"allocs_per_doc\": " << r.allocs_per_doc << "}";
+  }
+  os << "\n]}\n";
+}
+
+/*
+ * Time the feature kernels on the test fixture and on synthetic collections
+ * of short, medium and long documents. The results are written to stdout as
+ * JSON, one entry per kernel and collection.
+ */
+int main(int argc, char **argv) {
+  std::string filter;
+  double min_ms = 200;
+  bool fixture_only = false;
+
+  CLI::App app{"Feature kernel microbenchmarks"};
+  app.add_option("--filter", filter,
+                 "Only run kernels whose name contains this string");
+  app.add_option("--min_time", min_ms, "Minimum time per kernel in ms");
+  app.add_flag("--fixture_only", fixture_only,
+               "Skip the synthetic collections");
+  CLI11_PARSE(app, argc, argv);
+
+  std::vector<BenchResult> results;
+  {
+    BenchCorpus corpus = fixture_corpus();
+    bench_corpus(corpus, filter, min_ms, results);
+  }
+  if (!fixture_only) {
+    // About a million terms in each collection
+    for (size_t doc_len : {100, 1000, 10000}) {
+      BenchCorpus corpus = synthetic_corpus(1000000 / doc_len, doc_len);
+      bench_corpus(corpus, filter, min_ms, results);
+    }
+  }
+
+  write_json(std::cout, results);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
+#include "document_blob.hpp"
+#include "document_view.hpp"
+#include "forward_index.hpp"
+#include "forward_index_reader.hpp"
+#include "index_codecs.hpp"
+
+/**
+ * A forward index that is held in memory as a single arena of document blobs.
+ *
+ * A `ForwardIndex` makes several heap allocations for every `Document`. The
+ * arena instead packs the streams of all documents back to back in one
+ * buffer, in the same layout as a mapped forward index, and keeps only the
+ * offset of each blob besides. Documents are decoded straight from the arena
+ * into a `DocumentView`.
+ */
+class ArenaForwardIndex : public ForwardIndexReader {
+  // The blobs, as 64 bit words since every blob is 8 byte aligned.
+  std::vector<uint64_t> arena_;
+  // The blob of document `i` starts at word `offsets_[i]` of the arena.
+  std::vector<uint64_t> offsets_;
+  std::string blob_;
+  StreamCodecs codecs_;
+
+  const char *blob(size_t docid) const {
+    if (docid >= size()) {
+      throw std::out_of_range("docid out of range: " + std::to_string(docid));
+    }
+    return reinterpret_cast<const char *>(arena_.data() + offsets_[docid]);
+  }
+
+ public:
+  ArenaForwardIndex() = default;
+
+  /**
+   * Load the cereal archive of a `ForwardIndex` in `is`, whose documents are
+   * decoded with the codecs recorded in its header. The archive is streamed
+   * one `Document` at a time, so the documents are never all in memory as
+   * `Document`s. Space for `reserve_bytes` of blobs is reserved up front,
+   * the size of the archive is a good estimate. Documents with dense field
+   * frequencies are converted to sparse ones as they are added.
+   */
+  explicit ArenaForwardIndex(std::istream &is, size_t reserve_bytes = 0)
+      : codecs_(IndexCodecs::read_header(is)) {
+    cereal::BinaryInputArchive archive(is);
+    // Same layout as `std::vector<Document>`, see `IndexerInteractor`.
+    size_t num_docs = 0;
+    archive(num_docs);
+    offsets_.reserve(num_docs);
+    arena_.reserve(reserve_bytes / sizeof(uint64_t));
+    Document doc;
+    for (size_t i = 0; i < num_docs; ++i) {
+      archive(doc);
+      if (codecs_.names().dense_field_freqs) {
+        doc.sparsify_field_freqs(codecs_);
+      }
+      add(doc);
+    }
+  }
+
+  /**
+   * Copy the documents of `fwdidx`, which were compressed with `codecs`.
+   */
+  explicit ArenaForwardIndex(
+      const ForwardIndex &fwdidx,
+      const StreamCodecs &codecs = StreamCodecs::defaults())
+      : codecs_(codecs) {
+    offsets_.reserve(fwdidx.size());
+    for (const auto &doc : fwdidx) {
+      add(doc);
+    }
+  }
+
+  /**
+   * Append `doc`, which gets the next docid.
+   */
+  void add(const Document &doc) {
+    DocumentBlob::write(doc, blob_);
+    size_t offset = arena_.size();
+    offsets_.push_back(offset);
+    arena_.resize(offset + blob_.size() / sizeof(uint64_t));
+    std::memcpy(arena_.data() + offset, blob_.data(), blob_.size());
+  }
+
+  size_t size() const { return offsets_.size(); }
+
+  /**
+   * Size of the blobs in bytes.
+   */
+  size_t bytes() const { return arena_.size() * sizeof(uint64_t); }
+
+  const StreamCodecs &codecs() const { return codecs_; }
+
+  const Document &get(size_t docid, Document &scratch) const {
+    DocumentBlob(blob(docid)).read(docid, scratch);
+    return scratch;
+  }
+
+  void decode(size_t docid, DocumentView &view, Document &) const {
+    view.decode(DocumentBlob(blob(docid)), docid, codecs_);
+  }
+};
@@ -0,0 +1,414 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "fxt/features/bm25/bm25.hpp"
+#include "fxt/features/bose_einstein/be.hpp"
+#include "fxt/features/dfr/dfr.hpp"
+#include "fxt/features/dph/dph.hpp"
+#include "fxt/features/lmds/lm.hpp"
+#include "fxt/features/tfidf/tfidf.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/fused_scorer.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/simd.hpp"
+
+/**
+ * The query term frequencies of a batch of up to `width` candidate documents
+ * of one query, as a structure of arrays: for each query term and each of the
+ * whole document and `QueryContext::fields`, the frequencies in every
+ * document of the batch are contiguous, and so are the lengths.
+ *
+ * A frequency is zero wherever the term weighting features skip the term, so
+ * that the kernels only need to check the frequency of each lane. Lanes past
+ * the end of the batch are empty documents of length one.
+ *
+ * The batch is scored in the precision of `T`, `double` or `float`.
+ */
+template <typename T>
+class BasicScoreBatch {
+ public:
+  using value_type = T;
+  static constexpr size_t width = 16;
+  // The whole document, followed by `QueryContext::fields`
+  static constexpr size_t slots = QueryContext::num_fields + 1;
+
+ private:
+  size_t size_ = 0;
+  alignas(64) T len_[slots][width];
+  // Frequencies of term `t` in slot `s` are `tf_[(t * slots + s) * width]`
+  std::vector<T> tf_;
+
+ public:
+  /**
+   * Lay out the `n` documents of `freqs`, gathered for `ctx`.
+   */
+  void load(const QueryContext &ctx, const QueryTermFreqs *freqs, size_t n) {
+    size_ = std::min(n, width);
+    for (size_t s = 0; s < slots; ++s) {
+      std::fill(len_[s], len_[s] + width, 1.0);
+    }
+    for (size_t d = 0; d < size_; ++d) {
+      len_[0][d] = freqs[d].length();
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        len_[1 + f][d] = freqs[d].field_len(f);
+      }
+    }
+
+    size_t num_terms = ctx.terms().size();
+    tf_.assign(num_terms * slots * width, 0.0);
+    for (size_t t = 0; t < num_terms; ++t) {
+      T *row = tf_.data() + t * slots * width;
+      for (size_t d = 0; d < size_; ++d) {
+        uint32_t freq = freqs[d].freq(t);
+        if (0 == freq) {
+          continue;
+        }
+        row[d] = freq;
+        for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+          if (0 != freqs[d].field_len(f)) {
+            row[(1 + f) * width + d] = freqs[d].field_freq(t, f);
+          }
+        }
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  /**
+   * The lengths of slot `s` in each document.
+   */
+  const T *len(size_t s) const { return len_[s]; }
+
+  /**
+   * The frequencies of `ctx.terms()[t]` in slot `s` of each document.
+   */
+  const T *tf(size_t t, size_t s) const {
+    return tf_.data() + (t * slots + s) * width;
+  }
+};
+
+using ScoreBatch = BasicScoreBatch<double>;
+using FloatScoreBatch = BasicScoreBatch<float>;
+
+/**
+ * The scores of one term weighting family for each document of a
+ * `BasicScoreBatch<T>`, summed over the query terms in each slot.
+ */
+template <typename T>
+struct BasicBatchScores {
+  alignas(64) T score[ScoreBatch::slots][ScoreBatch::width];
+};
+
+using BatchScores = BasicBatchScores<double>;
+using FloatBatchScores = BasicBatchScores<float>;
+
+/**
+ * A term weighting family and its parameters.
+ */
+struct BatchFamily {
+  // The same values as the kinds of `FusedScorer`
+  enum Kind {
+    bm25 = FusedScorer::bm25,
+    lm = FusedScorer::lm,
+    tfidf = FusedScorer::tfidf,
+    be = FusedScorer::be,
+    dph = FusedScorer::dph,
+    dfr = FusedScorer::dfr
+  };
+
+  Kind kind;
+  // BM25
+  double k1 = 0.0;
+  double b = 0.0;
+  // LM with Dirichlet smoothing
+  double mu = 0.0;
+
+  static BatchFamily make_bm25(double k1, double b) {
+    BatchFamily family{bm25};
+    family.k1 = k1;
+    family.b = b;
+    return family;
+  }
+
+  static BatchFamily make_lm(double mu) {
+    BatchFamily family{lm};
+    family.mu = mu;
+    return family;
+  }
+};
+
+namespace batch_kernels {
+
+/**
+ * Whether `family` skips a field where the term has `stats`, see
+ * `FusedScorer::skip_field`.
+ */
+inline bool skip_field(const BatchFamily &family,
+                       const QueryContext::TermStats &stats) {
+  return FusedScorer::skip_field(FusedScorer::Kind(family.kind), stats);
+}
+
+/**
+ * Scores one document at a time with the scoring functions of the feature
+ * classes, so the results are the same to the bit in double precision. In
+ * single precision only the sums are rounded to floats.
+ */
+struct ScalarLanes {
+  template <BatchFamily::Kind kind, typename T>
+  static void add_row(const BatchFamily &family,
+                      const QueryContext::TermStats &stats, double avg_dlen,
+                      const T *tf, const T *len, size_t n, T *acc) {
+    rank_bm25 bm25;
+    bm25.avg_doc_len = avg_dlen;
+    bm25.set_k1(family.k1);
+    bm25.set_b(family.b);
+    for (size_t d = 0; d < n; ++d) {
+      if (0 == tf[d]) {
+        continue;
+      }
+      uint32_t d_f = tf[d];
+      uint32_t dlen = len[d];
+      if (kind == BatchFamily::bm25) {
+        acc[d] += bm25.calculate_docscore(stats.bm25_w_qt, d_f, dlen);
+      } else if (kind == BatchFamily::lm) {
+        acc[d] += calculate_lm(d_f, stats.lm_coll_prob, dlen, family.mu);
+      } else if (kind == BatchFamily::tfidf) {
+        acc[d] += calculate_tfidf(d_f, stats.tfidf_w_qt, dlen);
+      } else if (kind == BatchFamily::be) {
+        acc[d] += calculate_be(d_f, stats.be, avg_dlen, dlen);
+      } else if (kind == BatchFamily::dph) {
+        acc[d] += calculate_dph(d_f, stats.dph, avg_dlen, dlen);
+      } else {
+        acc[d] += calculate_dfr(d_f, stats.dfr, stats.document_count,
+                                avg_dlen, dlen);
+      }
+    }
+  }
+};
+
+/**
+ * Scores `simd_traits<V>::width` documents at a time. The expressions follow
+ * the scalar scoring functions term for term, only the logarithms and the
+ * rounding of contracted multiply-adds differ. The parameters and statistics
+ * are rounded to the precision of `V` where they meet the lanes.
+ */
+template <typename V>
+struct VectorLanes {
+  using T = typename simd_traits<V>::scalar;
+  static constexpr size_t width = simd_traits<V>::width;
+
+  template <BatchFamily::Kind kind>
+  FXT_ALWAYS_INLINE static void add_row(const BatchFamily &family,
+                                        const QueryContext::TermStats &stats,
+                                        double avg_dlen, const T *tf,
+                                        const T *len, size_t n, T *acc) {
+    const V zero = {};
+    const T one = 1.0;
+    const T avg_len = avg_dlen;
+    for (size_t d = 0; d < n; d += width) {
+      V f, l, a, x;
+      simd_load(f, tf + d);
+      simd_load(l, len + d);
+      simd_load(a, acc + d);
+      if (kind == BatchFamily::bm25) {
+        const T k1 = family.k1;
+        const T b = family.b;
+        V K_d = k1 * ((1 - b) + (b * (l / avg_len)));
+        V w_dt = ((k1 + 1) * f) / (K_d + f);
+        x = w_dt * T(stats.bm25_w_qt);
+      } else if (kind == BatchFamily::lm) {
+        x = (f + T(family.mu * stats.lm_coll_prob)) / (l + T(family.mu));
+        simd_log(x);
+      } else if (kind == BatchFamily::tfidf) {
+        x = f;
+        simd_log(x);
+        x = (one / l) * (one + x) * T(stats.tfidf_w_qt);
+      } else if (kind == BatchFamily::be) {
+        V prime = one + avg_len / l;
+        simd_log(prime);
+        prime = f * prime;
+        x = (T(stats.be.l) + prime * T(stats.be.r)) / (prime + one);
+      } else if (kind == BatchFamily::dph) {
+        V tf_norm = f / l;
+        V norm = (one - tf_norm) * (one - tf_norm) / (f + one);
+        x = ((f * avg_len) / l) * T(stats.dph);
+        simd_log2(x);
+        V y = T(2.0 * M_PI) * f * (one - tf_norm);
+        simd_log2(y);
+        x = norm * (f * x + T(0.5) * y);
+      } else {
+        V prime = one + avg_len / l;
+        simd_log2(prime);
+        prime = f * prime;
+        const T c_idf = uint32_t(stats.document_count);
+        x = prime * T(stats.dfr.ir) *
+            (T(stats.dfr.fp1) / (c_idf * (prime + one)));
+      }
+      a += f > T(0.0) ? x : zero;
+      simd_store(acc + d, a);
+    }
+  }
+};
+
+/**
+ * Score the slots in `mask` of a family of `kind` for each document of
+ * `batch`, summing the terms in the same order as the feature classes. The
+ * other slots are zero.
+ */
+template <typename Lanes, BatchFamily::Kind kind, typename T>
+FXT_ALWAYS_INLINE void score_family(const QueryContext &ctx,
+                                    const BasicScoreBatch<T> &batch,
+                                    const BatchFamily &family, FamilyMask mask,
+                                    BasicBatchScores<T> &scores) {
+  for (size_t s = 0; s < ScoreBatch::slots; ++s) {
+    std::fill(scores.score[s], scores.score[s] + ScoreBatch::width, 0.0);
+  }
+  const auto &terms = ctx.terms();
+  for (size_t t = 0; t < terms.size(); ++t) {
+    // skip non-existent terms
+    if (terms[t].oov) {
+      continue;
+    }
+    if (mask[0]) {
+      Lanes::template add_row<kind>(family, ctx.stats(t), ctx.avg_doc_len(),
+                                    batch.tf(t, 0), batch.len(0),
+                                    batch.size(), scores.score[0]);
+    }
+
+    for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+      if (!mask[1 + f]) {
+        continue;
+      }
+      if (ctx.field_id(f) < 1) {
+        // field is not indexed
+        continue;
+      }
+      const auto &stats = ctx.field_stats(t, f);
+      if (skip_field(family, stats)) {
+        continue;
+      }
+      Lanes::template add_row<kind>(family, stats, ctx.avg_doc_len(),
+                                    batch.tf(t, 1 + f), batch.len(1 + f),
+                                    batch.size(), scores.score[1 + f]);
+    }
+  }
+}
+
+template <typename Lanes, typename T>
+FXT_ALWAYS_INLINE void score_rows(const QueryContext &ctx,
+                                  const BasicScoreBatch<T> &batch,
+                                  const BatchFamily &family, FamilyMask mask,
+                                  BasicBatchScores<T> &scores) {
+  switch (family.kind) {
+    case BatchFamily::bm25:
+      score_family<Lanes, BatchFamily::bm25>(ctx, batch, family, mask, scores);
+      break;
+    case BatchFamily::lm:
+      score_family<Lanes, BatchFamily::lm>(ctx, batch, family, mask, scores);
+      break;
+    case BatchFamily::tfidf:
+      score_family<Lanes, BatchFamily::tfidf>(ctx, batch, family, mask, scores);
+      break;
+    case BatchFamily::be:
+      score_family<Lanes, BatchFamily::be>(ctx, batch, family, mask, scores);
+      break;
+    case BatchFamily::dph:
+      score_family<Lanes, BatchFamily::dph>(ctx, batch, family, mask, scores);
+      break;
+    case BatchFamily::dfr:
+      score_family<Lanes, BatchFamily::dfr>(ctx, batch, family, mask, scores);
+      break;
+  }
+}
+
+template <typename T>
+void score_scalar(const QueryContext &ctx, const BasicScoreBatch<T> &batch,
+                  const BatchFamily &family, FamilyMask mask,
+                  BasicBatchScores<T> &scores) {
+  score_rows<ScalarLanes>(ctx, batch, family, mask, scores);
+}
+
+#ifdef FXT_SIMD_X86
+template <typename T>
+__attribute__((target("avx2,fma"))) void score_avx2(
+    const QueryContext &ctx, const BasicScoreBatch<T> &batch,
+    const BatchFamily &family, FamilyMask mask, BasicBatchScores<T> &scores) {
+  using V = typename simd_vectors<T>::avx2;
+  score_rows<VectorLanes<V>>(ctx, batch, family, mask, scores);
+}
+
+template <typename T>
+__attribute__((target("avx512f"))) void score_avx512(
+    const QueryContext &ctx, const BasicScoreBatch<T> &batch,
+    const BatchFamily &family, FamilyMask mask, BasicBatchScores<T> &scores) {
+  using V = typename simd_vectors<T>::avx512;
+  score_rows<VectorLanes<V>>(ctx, batch, family, mask, scores);
+}
+#endif
+
+}  // namespace batch_kernels
+
+/**
+ * Scores the term weighting families for a batch of documents at a time.
+ *
+ * The scalar kernels give the same scores as the feature classes. The AVX2
+ * and AVX-512 kernels compute the logarithms themselves and may contract
+ * multiply-adds, so their scores differ from the scalar ones by at most
+ * `tolerance` relative to the larger of the score and one.
+ *
+ * A `FloatScoreBatch` is scored in single precision, with twice as many lanes
+ * per vector, and its scores are within `float_tolerance` of the feature
+ * classes in the same way, whatever the level.
+ */
+class BatchScorer {
+  SimdLevel level_;
+
+ public:
+  static constexpr double tolerance = 1e-12;
+  static constexpr double float_tolerance = 1e-5;
+
+  /**
+   * Use the kernels of `level`, or the best ones this CPU supports if it does
+   * not support `level`.
+   */
+  explicit BatchScorer(SimdLevel level = detect_simd_level())
+      : level_(std::min(level, detect_simd_level())) {}
+
+  SimdLevel level() const { return level_; }
+
+  /**
+   * Score the slots of `family` in `mask` for each document of `batch`, the
+   * other slots are zero.
+   */
+  template <typename T>
+  void score(const QueryContext &ctx, const BasicScoreBatch<T> &batch,
+             const BatchFamily &family, BasicBatchScores<T> &scores,
+             FamilyMask mask = all_members) const {
+    switch (level_) {
+#ifdef FXT_SIMD_X86
+      case SimdLevel::avx512:
+        batch_kernels::score_avx512(ctx, batch, family, mask, scores);
+        break;
+      case SimdLevel::avx2:
+        batch_kernels::score_avx2(ctx, batch, family, mask, scores);
+        break;
+#endif
+      default:
+        batch_kernels::score_scalar(ctx, batch, family, mask, scores);
+        break;
+    }
+  }
+};
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cereal/types/string.hpp"
+#include "cereal/types/vector.hpp"
+
+/**
+ * Map document names (docnos) to docids without an Indri index.
+ *
+ * The docnos are kept sorted in a single string pool, with `offsets_[i]` the
+ * start of the `i`th docno and `docids_[i]` its docid. Lookups go through an
+ * open addressing hash table of positions in the pool, so resolving a docno
+ * costs a hash and usually a single string comparison. The hash is FNV-1a,
+ * which unlike `std::hash` is the same on every platform, because the table
+ * is stored with the index.
+ */
+class DocnoStore {
+  std::string pool_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint32_t> docids_;
+  // Position in the pool plus one, `0` marks an empty slot
+  std::vector<uint32_t> table_;
+
+  static uint64_t hash(const char *s, size_t n) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; ++i) {
+      h ^= static_cast<unsigned char>(s[i]);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  bool equals(size_t i, const std::string &docno) const {
+    size_t len = offsets_[i + 1] - offsets_[i];
+    return len == docno.size() &&
+           0 == std::memcmp(pool_.data() + offsets_[i], docno.data(), len);
+  }
+
+ public:
+  DocnoStore() = default;
+
+  /**
+   * Build the store from `(docno, docid)` pairs in any order.
+   */
+  explicit DocnoStore(std::vector<std::pair<std::string, uint32_t>> docnos) {
+    std::sort(docnos.begin(), docnos.end());
+
+    size_t pool_len = 0;
+    for (const auto &d : docnos) {
+      pool_len += d.first.size();
+    }
+    pool_.reserve(pool_len);
+    offsets_.reserve(docnos.size() + 1);
+    docids_.reserve(docnos.size());
+    offsets_.push_back(0);
+    for (const auto &d : docnos) {
+      pool_ += d.first;
+      offsets_.push_back(pool_.size());
+      docids_.push_back(d.second);
+    }
+
+    // Keep the load factor at or below 2/3
+    size_t slots = 1;
+    while (slots < docnos.size() + docnos.size() / 2 + 1) {
+      slots <<= 1;
+    }
+    table_.assign(slots, 0);
+    for (size_t i = 0; i < docids_.size(); ++i) {
+      size_t slot = hash(pool_.data() + offsets_[i],
+                         offsets_[i + 1] - offsets_[i]) &
+                    (slots - 1);
+      while (table_[slot]) {
+        slot = (slot + 1) & (slots - 1);
+      }
+      table_[slot] = i + 1;
+    }
+  }
+
+  size_t size() const { return docids_.size(); }
+
+  /**
+   * Find the docid of `docno`. Returns `false` if it is not in the store.
+   */
+  bool find(const std::string &docno, uint32_t &docid) const {
+    if (table_.empty()) {
+      return false;
+    }
+    size_t mask = table_.size() - 1;
+    size_t slot = hash(docno.data(), docno.size()) & mask;
+    while (table_[slot]) {
+      size_t i = table_[slot] - 1;
+      if (equals(i, docno)) {
+        docid = docids_[i];
+        return true;
+      }
+      slot = (slot + 1) & mask;
+    }
+    return false;
+  }
+
+  /**
+   * Resolve `docnos` in order. Like `QueryEnvironment::documentIDsFromMetadata`
+   * docnos that are not in the store are skipped.
+   */
+  template <typename Id>
+  std::vector<Id> docids(const std::vector<std::string> &docnos) const {
+    std::vector<Id> ids;
+    ids.reserve(docnos.size());
+    uint32_t docid;
+    for (const auto &docno : docnos) {
+      if (find(docno, docid)) {
+        ids.push_back(docid);
+      }
+    }
+    return ids;
+  }
+
+  template <class Archive>
+  void serialize(Archive &archive) {
+    archive(pool_, offsets_, docids_, table_);
+  }
+};
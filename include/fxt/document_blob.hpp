@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "forward_index.hpp"
+#include "span.hpp"
+
+/**
+ * A document blob packs every stream of a `Document` into a single byte
+ * range. A blob starts on an 8 byte boundary and is laid out as
+ *
+ *     DocumentBlobHeader
+ *     uint32_t field_freqs_len[num_fields]
+ *     uint32_t unique_terms[], terms[], freqs[], field_freqs[][]
+ *     uint16_t fields[num_fields], padded to 4 bytes
+ *     DocumentBlobField field_stats[num_field_stats]
+ *
+ * and is padded to a multiple of 8 bytes, so blobs can be stored back to back.
+ * The streams are stored as they are in the compressed `Document`, so a
+ * document can be fetched without decoding anything up front.
+ */
+struct DocumentBlobHeader {
+  uint32_t num_terms;
+  uint32_t unique_terms_len;
+  uint32_t terms_len;
+  uint32_t freqs_len;
+  uint32_t num_fields;
+  uint32_t num_field_stats;
+};
+
+struct DocumentBlobField {
+  uint16_t field_id;
+  uint16_t tag_count;
+  uint16_t field_len;
+  uint16_t field_min_len;
+  uint16_t field_max_len;
+  uint16_t padding;
+  uint32_t field_len_sum_sqrs;
+
+  Field stats() const {
+    return Field(tag_count, field_len, field_min_len, field_max_len,
+                 field_len_sum_sqrs);
+  }
+};
+
+/**
+ * A read-only view of the streams of a document blob, and the conversion of a
+ * `Document` to and from its blob. The view is only valid while the blob is.
+ */
+class DocumentBlob {
+  DocumentBlobHeader header_;
+  const uint32_t *field_freqs_len_;
+  const uint32_t *unique_terms_;
+  const uint32_t *terms_;
+  const uint32_t *freqs_;
+  const uint32_t *field_freqs_;
+  const uint16_t *fields_;
+  const DocumentBlobField *field_stats_;
+
+  template <typename T>
+  static void append(std::string &out, const T *data, size_t n) {
+    out.append(reinterpret_cast<const char *>(data), n * sizeof(T));
+  }
+
+ public:
+  /**
+   * Find the streams of the blob at `p`.
+   */
+  explicit DocumentBlob(const char *p) {
+    std::memcpy(&header_, p, sizeof(header_));
+    p += sizeof(header_);
+    field_freqs_len_ = reinterpret_cast<const uint32_t *>(p);
+    unique_terms_ = field_freqs_len_ + header_.num_fields;
+    terms_ = unique_terms_ + header_.unique_terms_len;
+    freqs_ = terms_ + header_.terms_len;
+    field_freqs_ = freqs_ + header_.freqs_len;
+    const uint32_t *end = field_freqs_;
+    for (size_t i = 0; i < header_.num_fields; ++i) {
+      end += field_freqs_len_[i];
+    }
+    fields_ = reinterpret_cast<const uint16_t *>(end);
+    field_stats_ = reinterpret_cast<const DocumentBlobField *>(
+        fields_ + header_.num_fields + header_.num_fields % 2);
+  }
+
+  size_t num_terms() const { return header_.num_terms; }
+
+  Span<uint32_t> unique_terms() const {
+    return {unique_terms_, header_.unique_terms_len};
+  }
+  Span<uint32_t> terms() const { return {terms_, header_.terms_len}; }
+  Span<uint32_t> freqs() const { return {freqs_, header_.freqs_len}; }
+  Span<uint16_t> fields() const { return {fields_, header_.num_fields}; }
+  Span<DocumentBlobField> field_stats() const {
+    return {field_stats_, header_.num_field_stats};
+  }
+
+  /**
+   * The lengths of the field frequency streams, and all of the streams one
+   * after the other.
+   */
+  Span<uint32_t> field_freqs_len() const {
+    return {field_freqs_len_, header_.num_fields};
+  }
+  const uint32_t *field_freqs() const { return field_freqs_; }
+
+  static void write(const Document &doc, std::string &out) {
+    out.clear();
+
+    DocumentBlobHeader header;
+    header.num_terms = doc.m_num_terms;
+    header.unique_terms_len = doc.m_unique_terms.size();
+    header.terms_len = doc.m_terms.size();
+    header.freqs_len = doc.m_freqs.size();
+    header.num_fields = doc.m_fields.size();
+    header.num_field_stats = doc.m_field_stats.size();
+    append(out, &header, 1);
+
+    for (const auto &ff : doc.m_field_freqs) {
+      uint32_t len = ff.size();
+      append(out, &len, 1);
+    }
+    append(out, doc.m_unique_terms.data(), doc.m_unique_terms.size());
+    append(out, doc.m_terms.data(), doc.m_terms.size());
+    append(out, doc.m_freqs.data(), doc.m_freqs.size());
+    for (const auto &ff : doc.m_field_freqs) {
+      append(out, ff.data(), ff.size());
+    }
+    append(out, doc.m_fields.data(), doc.m_fields.size());
+    out.resize((out.size() + 3) & ~size_t(3), '\0');
+
+    for (const auto &fs : doc.m_field_stats) {
+      DocumentBlobField field;
+      field.field_id = fs.first;
+      field.tag_count = fs.second.tag_count();
+      field.field_len = fs.second.field_len();
+      field.field_min_len = fs.second.field_min_len();
+      field.field_max_len = fs.second.field_max_len();
+      field.padding = 0;
+      field.field_len_sum_sqrs = fs.second.field_len_sum_sqrs();
+      append(out, &field, 1);
+    }
+    out.resize((out.size() + 7) & ~size_t(7), '\0');
+  }
+
+  /**
+   * Fill `doc` from the blob. The vectors of `doc` are reused, so a
+   * `Document` that is read into repeatedly stops allocating once its
+   * buffers have grown to fit.
+   */
+  void read(size_t docid, Document &doc) const {
+    doc.id_ = docid;
+    doc.m_num_terms = header_.num_terms;
+    doc.m_unique_terms.assign(unique_terms().begin(), unique_terms().end());
+    doc.m_terms.assign(terms().begin(), terms().end());
+    doc.m_freqs.assign(freqs().begin(), freqs().end());
+    doc.m_field_freqs.resize(header_.num_fields);
+    const uint32_t *ff = field_freqs_;
+    for (size_t i = 0; i < header_.num_fields; ++i) {
+      doc.m_field_freqs[i].assign(ff, ff + field_freqs_len_[i]);
+      ff += field_freqs_len_[i];
+    }
+    doc.m_fields.assign(fields().begin(), fields().end());
+
+    doc.m_field_stats.clear();
+    for (const auto &f : field_stats()) {
+      doc.m_field_stats.emplace_hint(doc.m_field_stats.end(), f.field_id,
+                                     f.stats());
+    }
+    doc.index_fields();
+  }
+};
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "forward_index.hpp"
+#include "span.hpp"
+
+class DocumentBlob;
+
+/**
+ * The streams of a document that `DocumentView::decode` decodes. The unique
+ * terms are always decoded, since every frequency lookup starts from them.
+ * By default everything is decoded, see `FeatureExtractor::decode_plan` for a
+ * plan of what the enabled features read.
+ */
+struct DecodePlan {
+  // The terms in document order, for the query term positions
+  bool terms = true;
+  // The frequency of each unique term in the whole document
+  bool freqs = true;
+  // The frequencies in every field, or only in those of `field_ids`
+  bool all_fields = true;
+  std::vector<uint16_t> field_ids;
+
+  /**
+   * Decode the field frequencies of `field_id`, if it is not already.
+   */
+  void add_field(uint16_t field_id) {
+    if (!has_field(field_id)) {
+      field_ids.push_back(field_id);
+    }
+  }
+
+  bool has_field(uint16_t field_id) const {
+    return all_fields || field_ids.end() != std::find(field_ids.begin(),
+                                                      field_ids.end(),
+                                                      field_id);
+  }
+};
+
+/**
+ * A decoded, read-only view of a `Document` in the forward index.
+ *
+ * `Document::decompress` works on a copy of the document and allocates a new
+ * vector for every stream. A `DocumentView` instead decodes the compressed
+ * streams into scratch buffers that it owns, and the buffers are reused for
+ * every document that is decoded with the same view. Once the buffers have
+ * grown to fit the largest document no more allocations are made.
+ *
+ * A view can also be decoded straight from a `DocumentBlob`, such as the
+ * blobs of a mapped or arena forward index, without filling a `Document`
+ * first. The field slots of a blob are then kept by the view.
+ *
+ * A `DecodePlan` set with `set_plan` skips the streams that nothing reads.
+ * The accessors of a skipped stream behave as if the document had no terms in
+ * it: `terms()` is empty and the frequencies are zero. `length()` is always
+ * that of the whole document.
+ *
+ * The view is only valid while the `Document` or blob it was decoded from is
+ * alive, and until the next call to `decode`.
+ */
+class DocumentView {
+  size_t id_ = 0;
+  uint32_t length_ = 0;
+  DecodePlan plan_;
+  Span<uint16_t> fields_;
+  // The field slots of the decoded `Document`, or `nullptr` for a blob whose
+  // slots are in `blob_slots_`.
+  const FieldSlots *doc_slots_ = nullptr;
+  FieldSlots blob_slots_;
+  std::vector<uint32_t> unique_terms_;
+  std::vector<uint32_t> terms_;
+  std::vector<uint32_t> freqs_;
+  // The terms of each field, as ascending indexes into `unique_terms_`, and
+  // their frequencies in the field
+  std::vector<std::vector<uint32_t>> field_terms_;
+  std::vector<std::vector<uint32_t>> field_tfs_;
+
+  const FieldSlots &slots() const {
+    return doc_slots_ ? *doc_slots_ : blob_slots_;
+  }
+
+  // Decode the streams of a document with `num_terms` terms, which were
+  // never compressed if it is zero. See `src/compression.cpp`.
+  void decode_streams(const StreamCodecs &codecs, size_t num_terms,
+                      Span<uint32_t> unique_terms, Span<uint32_t> terms,
+                      Span<uint32_t> freqs);
+  void decode_field(const StreamCodecs &codecs, size_t num_terms, size_t slot,
+                    Span<uint32_t> ff);
+  void remap_terms(size_t num_terms);
+
+ public:
+  DocumentView() = default;
+
+  /**
+   * Decode only the streams of `plan` from the next call to `decode` on.
+   */
+  void set_plan(const DecodePlan &plan) { plan_ = plan; }
+
+  const DecodePlan &plan() const { return plan_; }
+
+  /**
+   * Decode `doc`, which was compressed with `codecs`, into this view.
+   * Documents that were never compressed are copied as is. See
+   * `src/compression.cpp`.
+   */
+  void decode(const Document &doc,
+              const StreamCodecs &codecs = StreamCodecs::defaults());
+
+  /**
+   * Decode the blob of document `docid` into this view.
+   */
+  void decode(const DocumentBlob &blob, size_t docid,
+              const StreamCodecs &codecs = StreamCodecs::defaults());
+
+  size_t id() const { return id_; }
+  uint32_t length() const { return length_; }
+
+  Span<uint16_t> fields() const { return fields_; }
+  Span<uint32_t> terms() const { return terms_; }
+  Span<uint32_t> unique_terms() const { return unique_terms_; }
+  Span<uint32_t> freqs() const { return freqs_; }
+
+  /**
+   * The index of `term` in `unique_terms()`. Like `freq`, a term that is not
+   * in the document gets the index of the next larger term.
+   */
+  size_t term_slot(uint32_t term) const {
+    auto it =
+        std::lower_bound(unique_terms_.begin(), unique_terms_.end(), term);
+    return std::distance(unique_terms_.begin(), it);
+  }
+
+  /**
+   * The index of `field_id` in `fields()`, or an index past the end of
+   * `fields()` if the document does not have it.
+   */
+  size_t field_slot(uint16_t field_id) const {
+    return slots().slot(field_id);
+  }
+
+  /**
+   * The frequency at `term_slot`, in the whole document or in the field at
+   * `field_slot`.
+   */
+  uint32_t slot_freq(size_t term_slot) const {
+    if (term_slot >= freqs_.size()) {
+      return 0;
+    }
+    return freqs_[term_slot];
+  }
+
+  uint32_t slot_freq(size_t field_slot, size_t term_slot) const {
+    if (term_slot >= unique_terms_.size() ||
+        field_slot >= field_terms_.size()) {
+      return 0;
+    }
+    const auto &terms = field_terms_[field_slot];
+    auto it = std::lower_bound(terms.begin(), terms.end(), term_slot);
+    if (it == terms.end() || *it != term_slot) {
+      return 0;
+    }
+    return field_tfs_[field_slot][std::distance(terms.begin(), it)];
+  }
+
+  uint32_t freq(uint32_t term) const { return slot_freq(term_slot(term)); }
+
+  uint32_t freq(uint16_t field_id, uint32_t term) const {
+    return slot_freq(field_slot(field_id), term_slot(term));
+  }
+
+  uint16_t tag_count(uint16_t field_id) const {
+    return slots().stats(field_id).tag_count();
+  }
+
+  uint16_t field_len(uint16_t field_id) const {
+    return slots().stats(field_id).field_len();
+  }
+
+  uint16_t field_min_len(uint16_t field_id) const {
+    return slots().stats(field_id).field_min_len();
+  }
+
+  uint16_t field_max_len(uint16_t field_id) const {
+    return slots().stats(field_id).field_max_len();
+  }
+
+  uint32_t field_len_sum_sqrs(uint16_t field_id) const {
+    return slots().stats(field_id).field_len_sum_sqrs();
+  }
+};
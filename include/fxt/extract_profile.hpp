@@ -0,0 +1,242 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The parts of feature extraction that are timed when profiling. The feature
+ * families follow the branches of `FeatureExtractor::extract`.
+ */
+enum class ProfileStage : size_t {
+  bm25_atire,
+  bm25_trec3,
+  bm25_trec3_kmax,
+  lm_dir_2500,
+  lm_dir_1500,
+  lm_dir_1000,
+  tfidf,
+  prob,
+  be,
+  dph,
+  dfr,
+  term_weighting,
+  stream,
+  tag_count,
+  proximity,
+  tpscore,
+  sdm,
+  decode,
+  positions,
+  freqs,
+  output,
+  count
+};
+
+static const size_t num_profile_stages =
+    static_cast<size_t>(ProfileStage::count);
+
+static const std::array<const char *, num_profile_stages> profile_stage_names =
+    {"bm25_atire", "bm25_trec3", "bm25_trec3_kmax", "lm_dir_2500",
+     "lm_dir_1500", "lm_dir_1000", "tfidf", "prob", "be", "dph", "dfr",
+     "term_weighting", "stream", "tag_count", "proximity", "tpscore", "sdm",
+     "decode", "positions", "freqs", "output"};
+
+/**
+ * Cumulative time and call counts of each `ProfileStage`.
+ *
+ * A profile is not thread safe, each extraction thread records into its own
+ * and the profiles are combined with `merge`.
+ */
+class ExtractProfile {
+  struct Counter {
+    uint64_t ns = 0;
+    uint64_t calls = 0;
+  };
+  std::array<Counter, num_profile_stages> counters_;
+
+ public:
+  void add(ProfileStage stage, uint64_t ns) {
+    auto &c = counters_[static_cast<size_t>(stage)];
+    c.ns += ns;
+    ++c.calls;
+  }
+
+  uint64_t ns(ProfileStage stage) const {
+    return counters_[static_cast<size_t>(stage)].ns;
+  }
+
+  uint64_t calls(ProfileStage stage) const {
+    return counters_[static_cast<size_t>(stage)].calls;
+  }
+
+  void merge(const ExtractProfile &other) {
+    for (size_t i = 0; i < num_profile_stages; ++i) {
+      counters_[i].ns += other.counters_[i].ns;
+      counters_[i].calls += other.counters_[i].calls;
+    }
+  }
+
+  void clear() { counters_.fill(Counter()); }
+};
+
+/**
+ * Time a scope into `profile`. When `profile` is null, which is the case
+ * unless profiling was requested, the clock is not read at all.
+ */
+class ProfileTimer {
+  using clock = std::chrono::steady_clock;
+  ExtractProfile *profile_;
+  ProfileStage stage_;
+  clock::time_point start_;
+
+ public:
+  ProfileTimer(ExtractProfile *profile, ProfileStage stage)
+      : profile_(profile), stage_(stage) {
+    if (profile_) {
+      start_ = clock::now();
+    }
+  }
+
+  ~ProfileTimer() {
+    if (profile_) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - start_)
+                    .count();
+      profile_->add(stage_, ns);
+    }
+  }
+
+  ProfileTimer(const ProfileTimer &) = delete;
+  ProfileTimer &operator=(const ProfileTimer &) = delete;
+};
+
+/**
+ * Collect the profile of every extracted query and write them as JSON.
+ *
+ * The report has the totals of each stage, with the rate in documents per
+ * second of stage time, and the per query breakdown in the order the queries
+ * finished:
+ *
+ *     {"queries": 2, "docs": 200, "ms": 35.125,
+ *      "stages": {"bm25_atire": {"calls": 200, "ms": 1.250,
+ *                                "docs_per_sec": 160000.0}, ...},
+ *      "per_query": [{"id": "51", "docs": 100, "ms": 17.500,
+ *                     "stages": {"bm25_atire": {"calls": 100,
+ *                                               "ms": 0.625}, ...}}, ...]}
+ *
+ * Stages that were never called are left out. A report that does not keep
+ * the per query breakdown, such as that of a server that runs for an
+ * unbounded number of queries, only has the totals.
+ */
+class ProfileReport {
+  struct Query {
+    std::string id;
+    size_t docs;
+    double ms;
+    ExtractProfile profile;
+  };
+
+  std::mutex mutex_;
+  bool per_query_;
+  std::vector<Query> queries_;
+  ExtractProfile total_;
+  size_t num_queries_ = 0;
+  size_t docs_ = 0;
+  double ms_ = 0.0;
+
+  static void write_string(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (char c : s) {
+      if ('"' == c || '\\' == c) {
+        os << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char esc[8];
+        std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+        os << esc;
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+  }
+
+  static void write_stages(std::ostream &os, const ExtractProfile &profile,
+                           bool rates) {
+    os << "{";
+    bool first = true;
+    for (size_t i = 0; i < num_profile_stages; ++i) {
+      auto stage = static_cast<ProfileStage>(i);
+      if (0 == profile.calls(stage)) {
+        continue;
+      }
+      double ms = profile.ns(stage) / 1e6;
+      os << (first ? "" : ", ") << '"' << profile_stage_names[i]
+         << "\": {\"calls\": " << profile.calls(stage) << ", \"ms\": " << ms;
+      if (rates) {
+        double secs = profile.ns(stage) / 1e9;
+        os << ", \"docs_per_sec\": "
+           << (secs > 0 ? profile.calls(stage) / secs : 0.0);
+      }
+      os << "}";
+      first = false;
+    }
+    os << "}";
+  }
+
+ public:
+  explicit ProfileReport(bool per_query = true) : per_query_(per_query) {}
+
+  void add_query(const std::string &id, size_t docs, double ms,
+                 const ExtractProfile &profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (per_query_) {
+      queries_.push_back({id, docs, ms, profile});
+    }
+    total_.merge(profile);
+    ++num_queries_;
+    docs_ += docs;
+    ms_ += ms;
+  }
+
+  void write_json(std::ostream &os) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+
+    os << "{\"queries\": " << num_queries_ << ", \"docs\": " << docs_
+       << ", \"ms\": " << ms_ << ",\n \"stages\": ";
+    write_stages(os, total_, true);
+    if (per_query_) {
+      os << ",\n \"per_query\": [";
+      for (size_t i = 0; i < queries_.size(); ++i) {
+        const auto &q = queries_[i];
+        os << (0 == i ? "\n  " : ",\n  ") << "{\"id\": ";
+        write_string(os, q.id);
+        os << ", \"docs\": " << q.docs << ", \"ms\": " << q.ms
+           << ", \"stages\": ";
+        write_stages(os, q.profile, false);
+        os << "}";
+      }
+      os << "]";
+    }
+    os << "}\n";
+
+    os.flags(flags);
+    os.precision(precision);
+  }
+};
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <sys/resource.h>
+
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Throughput of a whole extractor run, for comparing builds end to end.
+ *
+ * The report is a single JSON object whose keys do not change between runs,
+ * so that results of different commits can be compared directly:
+ *
+ *     {"schema": 1, "threads": 1, "doc_threads": 1,
+ *      "load_ms": {"inverted_index": 120.500, "lexicon": 80.250, ...},
+ *      "queries": 200, "docs": 100000, "extract_ms": 5000.000,
+ *      "queries_per_sec": 40.000, "docs_per_sec": 20000.000,
+ *      "output_bytes": 52428800, "output_bytes_per_sec": 10485760.000,
+ *      "peak_rss_kb": 1048576}
+ *
+ * `load_ms` has an entry for each structure in the order it was loaded.
+ * `schema` is increased whenever a key is renamed or its meaning changes.
+ */
+class ExtractStats {
+  std::mutex mutex_;
+  std::vector<std::pair<std::string, double>> loads_;
+  size_t queries_ = 0;
+  size_t docs_ = 0;
+  size_t output_bytes_ = 0;
+
+ public:
+  static const int schema = 1;
+
+  void add_load(const std::string &structure, double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loads_.emplace_back(structure, ms);
+  }
+
+  void add_query(size_t docs, size_t output_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++queries_;
+    docs_ += docs;
+    output_bytes_ += output_bytes;
+  }
+
+  size_t queries() const { return queries_; }
+  size_t docs() const { return docs_; }
+  size_t output_bytes() const { return output_bytes_; }
+
+  /**
+   * The peak resident set size of this process in KB.
+   */
+  static long peak_rss_kb() {
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage)) {
+      return 0;
+    }
+    return usage.ru_maxrss;
+  }
+
+  /**
+   * Write the report, with the rates over `extract_ms` of extraction.
+   */
+  void write_json(std::ostream &os, double extract_ms, size_t threads,
+                  size_t doc_threads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+
+    double secs = extract_ms / 1000.0;
+    auto rate = [&](size_t n) { return secs > 0 ? n / secs : 0.0; };
+
+    os << "{\"schema\": " << schema << ", \"threads\": " << threads
+       << ", \"doc_threads\": " << doc_threads << ",\n \"load_ms\": {";
+    for (size_t i = 0; i < loads_.size(); ++i) {
+      os << (i ? ", " : "") << '"' << loads_[i].first
+         << "\": " << loads_[i].second;
+    }
+    os << "},\n \"queries\": " << queries_ << ", \"docs\": " << docs_
+       << ", \"extract_ms\": " << extract_ms
+       << ",\n \"queries_per_sec\": " << rate(queries_)
+       << ", \"docs_per_sec\": " << rate(docs_)
+       << ",\n \"output_bytes\": " << output_bytes_
+       << ", \"output_bytes_per_sec\": " << rate(output_bytes_)
+       << ",\n \"peak_rss_kb\": " << peak_rss_kb() << "}\n";
+
+    os.flags(flags);
+    os.precision(precision);
+  }
+};
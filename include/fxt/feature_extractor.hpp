@@ -7,239 +7,434 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
-#include "doc_entry_flag.hpp"
+#include "batch_scorer.hpp"
+#include "document_view.hpp"
+#include "extract_profile.hpp"
+#include "feature_row.hpp"
 #include "features/features.hpp"
+#include "fused_scorer.hpp"
+#include "query_context.hpp"
+#include "query_term_freqs.hpp"
+#include "query_term_positions.hpp"
 #include "query_train_file.hpp"
-#include "statdoc_entry_flag.hpp"
 
 /*
  * Determine which query-document features to compute.
  *
- * Coarse grained at the moment. For example, the document feature
- * `f_bm25_atire` will compute all 6 features (assuming the fields exist) that
- * are contained within.
+ * Each family only computes the features that are enabled. For example,
+ * `f_bm25_atire_title` on its own scores the title of each document, but
+ * neither the whole document nor its other fields.
  */
 class FeatureExtractor {
-  Lexicon &lexicon;
-  FieldIdMap &fid_map;
-  doc_entry_flag &qd_flags;
-  statdoc_entry_flag &sd_flags;
+  const FeatureFlags &flags;
 
   document_features features;
-  doc_bm25_atire_feature f_bm25_atire;
-  doc_bm25_trec3_feature f_bm25_trec3;
-  doc_bm25_trec3_kmax_feature f_bm25_trec3_kmax;
   doc_proximity_feature prox_feature;
-  doc_lm_dir_2500_feature f_lmds_2500;
-  doc_lm_dir_1500_feature f_lmds_1500;
-  doc_lm_dir_1000_feature f_lmds_1000;
-  doc_tfidf_feature tfidf_feature;
   doc_prob_feature prob_feature;
-  doc_be_feature be_feature;
-  doc_dph_feature dph_feature;
-  doc_dfr_feature dfr_feature;
   doc_stream_feature f_stream;
   doc_tpscore_feature f_tpscore;
 
+  // Query term frequencies of the current document, shared by the families
+  QueryTermFreqs freqs;
+  // The enabled term weighting families, scored together, see `extract`
+  FusedScorer fused;
+
+  // The documents of the current batch, see `extract_batch`
+  BatchScorer batch_scorer;
+  std::vector<QueryTermFreqs> batch_freqs;
+  // Only one of the batches is used, see `set_single_precision`
+  bool single_precision = false;
+  ScoreBatch batch;
+  BatchScores batch_scores;
+  FloatScoreBatch float_batch;
+  FloatBatchScores float_scores;
+
+  // Null unless profiling, see `set_profile`
+  ExtractProfile *profile = nullptr;
+
+  static_assert(ScoreBatch::slots == feature::family_size,
+                "a batch scores one term weighting family");
+
+  /**
+   * Copy the batch scores to the family of features that starts at `first`,
+   * for each row of the batch.
+   */
+  template <typename T>
+  static void store_scores(const BasicScoreBatch<T> &b,
+                           const BasicBatchScores<T> &scores,
+                           feature::Id first, FeatureRow *rows) {
+    for (size_t d = 0; d < b.size(); ++d) {
+      for (size_t s = 0; s < ScoreBatch::slots; ++s) {
+        rows[d][first + s] = scores.score[s][d];
+      }
+    }
+  }
+
+  void store_batch(feature::Id first, FeatureRow *rows) {
+    if (single_precision) {
+      store_scores(float_batch, float_scores, first, rows);
+    } else {
+      store_scores(batch, batch_scores, first, rows);
+    }
+  }
+
+  void score_batch(ProfileStage stage, const QueryContext &ctx,
+                   const BatchFamily &family, feature::Id first,
+                   FeatureRow *rows) {
+    ProfileTimer timer(profile, stage);
+    auto members =
+        BatchFamily::lm == family.kind ? lm_mask(first) : mask(first);
+    if (single_precision) {
+      batch_scorer.score(ctx, float_batch, family, float_scores, members);
+    } else {
+      batch_scorer.score(ctx, batch, family, batch_scores, members);
+    }
+    store_batch(first, rows);
+  }
+
+  /**
+   * Score the enabled members of the term weighting family that starts at
+   * `first` with `fused`. The scores are written to the families of
+   * `outputs`.
+   */
+  void add_fused(FusedScorer::Family family, feature::Id first,
+                 std::vector<feature::Id> outputs) {
+    if (!has_family(first)) {
+      return;
+    }
+    family.mask = FusedScorer::lm == family.kind ? lm_mask(first) : mask(first);
+    family.outputs = std::move(outputs);
+    fused.add(family);
+  }
+
+  /**
+   * The families that neither `extract` nor `extract_batch` score with the
+   * other term weighting families.
+   */
+  void extract_unweighted(const QueryContext &ctx, FeatureRow &row,
+                          const DocumentView &doc, const QueryTermFreqs &freqs,
+                          const QueryTermPositions &positions) {
+    if (has_stream()) {
+      ProfileTimer timer(profile, ProfileStage::stream);
+      f_stream.compute(ctx, row, doc, freqs, flags);
+    }
+    if (has_tag_count()) {
+      ProfileTimer timer(profile, ProfileStage::tag_count);
+      features.compute(ctx, row, doc, flags);
+    }
+    /* lgr: fixup #XXX */
+    if (has_proximity()) {
+      ProfileTimer timer(profile, ProfileStage::proximity);
+      prox_feature.compute(ctx, row, freqs, positions, flags);
+    }
+    if (has_tpscore()) {
+      ProfileTimer timer(profile, ProfileStage::tpscore);
+      f_tpscore.compute(ctx, row, freqs, positions);
+    }
+  }
+
  public:
-  FeatureExtractor(Lexicon &lex, FieldIdMap &fid, doc_entry_flag &qdf,
-                   statdoc_entry_flag &sdf)
-      : lexicon(lex),
-        fid_map(fid),
-        qd_flags(qdf),
-        sd_flags(sdf),
-        f_bm25_atire(lexicon),
-        f_bm25_trec3(lexicon),
-        f_bm25_trec3_kmax(lexicon),
-        prox_feature(lexicon),
-        f_lmds_2500(lexicon),
-        f_lmds_1500(lexicon),
-        f_lmds_1000(lexicon),
-        tfidf_feature(lexicon),
-        prob_feature(lexicon),
-        be_feature(lexicon),
-        dph_feature(lexicon),
-        dfr_feature(lexicon),
-        f_tpscore(lexicon) {}
-
-  void extract(query_train &qry, doc_entry &de, Document &doc,
-               std::unordered_map<uint32_t, std::vector<uint32_t>> &positions) {
+  explicit FeatureExtractor(const FeatureFlags &f) : flags(f) {
+    using F = FusedScorer::Family;
+    using bm25_atire = doc_bm25_atire_feature;
+    using bm25_trec3 = doc_bm25_trec3_feature;
+    using bm25_trec3_kmax = doc_bm25_trec3_kmax_feature;
+    add_fused(F::make_bm25(bm25_atire::k1, bm25_atire::b), feature::bm25_atire,
+              {feature::bm25_atire});
+    add_fused(F::make_bm25(bm25_trec3::k1, bm25_trec3::b), feature::bm25_trec3,
+              {feature::bm25_trec3});
+    add_fused(F::make_bm25(bm25_trec3_kmax::k1, bm25_trec3_kmax::b),
+              feature::bm25_trec3_kmax, {feature::bm25_trec3_kmax});
+    // `doc_lm_dir_feature::lm_dir_compute` also writes its scores to the
+    // `lm_dir_2500` family, so the last LM family enabled wins it
+    add_fused(F::make_lm(doc_lm_dir_2500_feature::mu), feature::lm_dir_2500,
+              {feature::lm_dir_2500});
+    add_fused(F::make_lm(doc_lm_dir_1500_feature::mu), feature::lm_dir_1500,
+              {feature::lm_dir_2500, feature::lm_dir_1500});
+    add_fused(F::make_lm(doc_lm_dir_1000_feature::mu), feature::lm_dir_1000,
+              {feature::lm_dir_2500, feature::lm_dir_1000});
+    add_fused(F::make(FusedScorer::tfidf), feature::tfidf, {feature::tfidf});
+    add_fused(F::make(FusedScorer::prob), feature::prob, {feature::prob});
+    add_fused(F::make(FusedScorer::be), feature::be, {feature::be});
+    add_fused(F::make(FusedScorer::dph), feature::dph, {feature::dph});
+    add_fused(F::make(FusedScorer::dfr), feature::dfr, {feature::dfr});
+  }
+
+  /**
+   * Record the time spent in each feature family into `p`, or stop recording
+   * if `p` is null.
+   */
+  void set_profile(ExtractProfile *p) { profile = p; }
+
+  /**
+   * Extract the enabled features of `doc` for the query of `ctx` into `row`.
+   * `positions` are the query term positions of `doc`, they are only read if
+   * `needs_positions`.
+   *
+   * BM25, LM, TF-IDF, probability, BE, DPH and DFR are scored by `fused` in
+   * one pass over the query terms of the document. They are profiled
+   * together as `ProfileStage::term_weighting`.
+   */
+  void extract(const QueryContext &ctx, FeatureRow &row,
+               const DocumentView &doc, const QueryTermPositions &positions) {
+    if (needs_freqs()) {
+      ProfileTimer timer(profile, ProfileStage::freqs);
+      freqs.gather(ctx, doc);
+    }
+    if (!fused.empty()) {
+      ProfileTimer timer(profile, ProfileStage::term_weighting);
+      fused.score(ctx, freqs, row);
+    }
+    extract_unweighted(ctx, row, doc, freqs, positions);
+  }
+
+  /**
+   * Use the batch kernels of `level`, if the CPU supports it.
+   */
+  void set_simd_level(SimdLevel level) { batch_scorer = BatchScorer(level); }
+
+  SimdLevel simd_level() const { return batch_scorer.level(); }
+
+  /**
+   * Score the batches in single precision, with twice as many documents per
+   * vector. The scores are within `BatchScorer::float_tolerance` of the
+   * double ones, the families that are not batched are not affected.
+   */
+  void set_single_precision(bool single) { single_precision = single; }
+
+  /**
+   * The streams of each document that the enabled features read, for the
+   * query of `ctx`. The terms in document order are only read for the query
+   * term positions, and the field frequencies only of the fields that an
+   * enabled member scores or counts query terms in. SDM is not extracted
+   * here, and also needs `DecodePlan::terms`.
+   */
+  DecodePlan decode_plan(const QueryContext &ctx) {
+    DecodePlan plan;
+    plan.terms = has_proximity() || has_tpscore();
+    plan.freqs = plan.terms;
+    plan.all_fields = false;
+    // The term weighting families skip the fields of a term that is not in
+    // the document, so they read its frequency for every member
+    for (feature::Id first :
+         {feature::bm25_atire, feature::bm25_trec3, feature::bm25_trec3_kmax,
+          feature::lm_dir_2500, feature::lm_dir_1500, feature::lm_dir_1000,
+          feature::tfidf, feature::prob, feature::be, feature::dph,
+          feature::dfr, feature::stream_len, feature::sum_stream_len,
+          feature::min_stream_len, feature::max_stream_len,
+          feature::mean_stream_len, feature::variance_stream_len}) {
+      auto members = mask(first);
+      bool stream = first >= feature::stream_len;
+      plan.freqs = plan.freqs || (stream ? members[0] : members.any());
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        if (members[1 + f] && ctx.field_id(f) > 0) {
+          plan.add_field(ctx.field_id(f));
+        }
+      }
+    }
+    for (size_t f = 0; f < QueryContext::num_tag_query_fields; ++f) {
+      if (has_tag_count() && flags[feature::tag_title_qry_count + f] &&
+          ctx.tag_field_id(f) > 0) {
+        plan.add_field(ctx.tag_field_id(f));
+      }
+    }
+    return plan;
+  }
+
+  /**
+   * Score BM25, LM, TF-IDF, BE, DPH and DFR for the first `n` documents of
+   * `docs` at once, at most `ScoreBatch::width`, with the kernels of
+   * `simd_level`. The other features of document `i` are then extracted by
+   * `extract_batched(ctx, i, ...)`.
+   */
+  void extract_batch(const QueryContext &ctx, FeatureRow *rows,
+                     const DocumentView *docs, size_t n) {
+    n = std::min(n, ScoreBatch::width);
+    batch_freqs.resize(ScoreBatch::width);
+    if (needs_freqs()) {
+      ProfileTimer timer(profile, ProfileStage::freqs);
+      for (size_t i = 0; i < n; ++i) {
+        batch_freqs[i].gather(ctx, docs[i]);
+      }
+      if (single_precision) {
+        float_batch.load(ctx, batch_freqs.data(), n);
+      } else {
+        batch.load(ctx, batch_freqs.data(), n);
+      }
+    }
+
     if (has_bm25_atire()) {
-      f_bm25_atire.compute(qry, de, doc, fid_map);
+      using F = doc_bm25_atire_feature;
+      score_batch(ProfileStage::bm25_atire, ctx,
+                  BatchFamily::make_bm25(F::k1, F::b), feature::bm25_atire,
+                  rows);
     }
     if (has_bm25_trec3()) {
-      f_bm25_trec3.compute(qry, de, doc, fid_map);
+      using F = doc_bm25_trec3_feature;
+      score_batch(ProfileStage::bm25_trec3, ctx,
+                  BatchFamily::make_bm25(F::k1, F::b), feature::bm25_trec3,
+                  rows);
     }
     if (has_bm25_trec3_kmax()) {
-      f_bm25_trec3_kmax.compute(qry, de, doc, fid_map);
+      using F = doc_bm25_trec3_kmax_feature;
+      score_batch(ProfileStage::bm25_trec3_kmax, ctx,
+                  BatchFamily::make_bm25(F::k1, F::b),
+                  feature::bm25_trec3_kmax, rows);
     }
+    // `doc_lm_dir_feature::lm_dir_compute` also writes its scores to the
+    // `lm_dir_2500` family, so the last LM family enabled wins it
     if (has_lm_dir_2500()) {
-      f_lmds_2500.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::lm_dir_2500, ctx,
+                  BatchFamily::make_lm(doc_lm_dir_2500_feature::mu),
+                  feature::lm_dir_2500, rows);
     }
     if (has_lm_dir_1500()) {
-      f_lmds_1500.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::lm_dir_1500, ctx,
+                  BatchFamily::make_lm(doc_lm_dir_1500_feature::mu),
+                  feature::lm_dir_1500, rows);
+      store_batch(feature::lm_dir_2500, rows);
     }
     if (has_lm_dir_1000()) {
-      f_lmds_1000.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::lm_dir_1000, ctx,
+                  BatchFamily::make_lm(doc_lm_dir_1000_feature::mu),
+                  feature::lm_dir_1000, rows);
+      store_batch(feature::lm_dir_2500, rows);
     }
     if (has_tfidf()) {
-      tfidf_feature.compute(qry, de, doc, fid_map);
-    }
-    if (has_prob()) {
-      prob_feature.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::tfidf, ctx, {BatchFamily::tfidf},
+                  feature::tfidf, rows);
     }
     if (has_be()) {
-      be_feature.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::be, ctx, {BatchFamily::be}, feature::be, rows);
     }
     if (has_dph()) {
-      dph_feature.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::dph, ctx, {BatchFamily::dph}, feature::dph,
+                  rows);
     }
     if (has_dfr()) {
-      dfr_feature.compute(qry, de, doc, fid_map);
-    }
-    if (has_stream()) {
-      f_stream.compute(qry, de, doc, fid_map);
-    }
-    if (has_tag_count()) {
-      features.compute(qry, de, doc, fid_map);
-    }
-    /* lgr: fixup #XXX */
-    if (has_proximity()) {
-      prox_feature.compute(qry, de, doc, positions);
-    }
-    if (has_tpscore()) {
-      f_tpscore.compute(qry, de, doc, fid_map);
+      score_batch(ProfileStage::dfr, ctx, {BatchFamily::dfr}, feature::dfr,
+                  rows);
     }
   }
 
-  inline bool has_bm25_atire() {
-    return qd_flags.f_bm25_atire || qd_flags.f_bm25_atire_body ||
-           qd_flags.f_bm25_atire_title || qd_flags.f_bm25_atire_heading ||
-           qd_flags.f_bm25_atire_inlink || qd_flags.f_bm25_atire_a;
+  /**
+   * Extract the features of document `i` of the last `extract_batch` that it
+   * does not score. `positions` are the query term positions of `doc`.
+   */
+  void extract_batched(const QueryContext &ctx, size_t i, FeatureRow &row,
+                       const DocumentView &doc,
+                       const QueryTermPositions &positions) {
+    if (has_prob()) {
+      ProfileTimer timer(profile, ProfileStage::prob);
+      prob_feature.compute(ctx, row, batch_freqs[i], mask(feature::prob));
+    }
+    extract_unweighted(ctx, row, doc, batch_freqs[i], positions);
   }
 
-  inline bool has_bm25_trec3() {
-    return qd_flags.f_bm25_trec3 || qd_flags.f_bm25_trec3_body ||
-           qd_flags.f_bm25_trec3_title || qd_flags.f_bm25_trec3_heading ||
-           qd_flags.f_bm25_trec3_inlink || qd_flags.f_bm25_trec3_a;
-  }
+  inline bool needs_positions() { return has_proximity() || has_tpscore(); }
 
-  inline bool has_bm25_trec3_kmax() {
-    return qd_flags.f_bm25_trec3_kmax || qd_flags.f_bm25_trec3_kmax_body ||
-           qd_flags.f_bm25_trec3_kmax_title ||
-           qd_flags.f_bm25_trec3_kmax_heading ||
-           qd_flags.f_bm25_trec3_kmax_inlink || qd_flags.f_bm25_trec3_kmax_a;
+  // Every family but the tag counts reads the query term frequencies
+  inline bool needs_freqs() {
+    return has_bm25_atire() || has_bm25_trec3() || has_bm25_trec3_kmax() ||
+           has_lm_dir_2500() || has_lm_dir_1500() || has_lm_dir_1000() ||
+           has_tfidf() || has_prob() || has_be() || has_dph() || has_dfr() ||
+           has_stream() || has_proximity() || has_tpscore();
   }
 
-  inline bool has_lm_dir_2500() {
-    return qd_flags.f_lm_dir_2500 || qd_flags.f_lm_dir_2500_body ||
-           qd_flags.f_lm_dir_2500_title || qd_flags.f_lm_dir_2500_heading ||
-           qd_flags.f_lm_dir_2500_inlink || qd_flags.f_lm_dir_2500_a;
+  /**
+   * The enabled members of the term weighting family that starts at `first`.
+   */
+  inline FamilyMask mask(feature::Id first) const {
+    return family_mask(flags, first);
   }
 
-  inline bool has_lm_dir_1500() {
-    return qd_flags.f_lm_dir_1500 || qd_flags.f_lm_dir_1500_body ||
-           qd_flags.f_lm_dir_1500_title || qd_flags.f_lm_dir_1500_heading ||
-           qd_flags.f_lm_dir_1500_inlink || qd_flags.f_lm_dir_1500_a;
+  /**
+   * The members of the LM family that starts at `first` to compute. Since
+   * `doc_lm_dir_feature::lm_dir_compute` also writes its scores to the
+   * `lm_dir_2500` family, these include the members enabled there, so that
+   * they hold the scores of the last LM family enabled as before.
+   */
+  inline FamilyMask lm_mask(feature::Id first) const {
+    return mask(first) | mask(feature::lm_dir_2500);
   }
 
-  inline bool has_lm_dir_1000() {
-    return qd_flags.f_lm_dir_1000 || qd_flags.f_lm_dir_1000_body ||
-           qd_flags.f_lm_dir_1000_title || qd_flags.f_lm_dir_1000_heading ||
-           qd_flags.f_lm_dir_1000_inlink || qd_flags.f_lm_dir_1000_a;
-  }
+  /**
+   * Whether any member of the term weighting family that starts at `first` is
+   * enabled.
+   */
+  inline bool has_family(feature::Id first) const { return mask(first).any(); }
 
-  inline bool has_tfidf() {
-    return qd_flags.f_tfidf || qd_flags.f_tfidf_body ||
-           qd_flags.f_tfidf_title || qd_flags.f_tfidf_heading ||
-           qd_flags.f_tfidf_inlink || qd_flags.f_tfidf_a;
-  }
+  inline bool has_bm25_atire() { return has_family(feature::bm25_atire); }
 
-  inline bool has_prob() {
-    return qd_flags.f_prob || qd_flags.f_prob_body || qd_flags.f_prob_title ||
-           qd_flags.f_prob_heading || qd_flags.f_prob_inlink ||
-           qd_flags.f_prob_a;
-  }
+  inline bool has_bm25_trec3() { return has_family(feature::bm25_trec3); }
 
-  inline bool has_be() {
-    return qd_flags.f_be || qd_flags.f_be_body || qd_flags.f_be_title ||
-           qd_flags.f_be_heading || qd_flags.f_be_inlink || qd_flags.f_be_a;
+  inline bool has_bm25_trec3_kmax() {
+    return has_family(feature::bm25_trec3_kmax);
   }
 
-  inline bool has_dph() {
-    return qd_flags.f_dph || qd_flags.f_dph_body || qd_flags.f_dph_title ||
-           qd_flags.f_dph_heading || qd_flags.f_dph_inlink || qd_flags.f_dph_a;
-  }
+  inline bool has_lm_dir_2500() { return has_family(feature::lm_dir_2500); }
 
-  inline bool has_dfr() {
-    return qd_flags.f_dfr || qd_flags.f_dfr_body || qd_flags.f_dfr_title ||
-           qd_flags.f_dfr_heading || qd_flags.f_dfr_inlink || qd_flags.f_dfr_a;
-  }
+  inline bool has_lm_dir_1500() { return has_family(feature::lm_dir_1500); }
+
+  inline bool has_lm_dir_1000() { return has_family(feature::lm_dir_1000); }
+
+  inline bool has_tfidf() { return has_family(feature::tfidf); }
+
+  inline bool has_prob() { return has_family(feature::prob); }
 
-  /* currently all stream features are grouped */
+  inline bool has_be() { return has_family(feature::be); }
+
+  inline bool has_dph() { return has_family(feature::dph); }
+
+  inline bool has_dfr() { return has_family(feature::dfr); }
+
+  /* the stream families are computed together */
   inline bool has_stream() {
     return has_stream_len() || has_sum_stream_len() || has_min_stream_len() ||
            has_max_stream_len() || has_mean_stream_len() ||
            has_variance_stream_len();
   }
 
-  inline bool has_stream_len() {
-    return qd_flags.f_stream_len || qd_flags.f_stream_len_body ||
-           qd_flags.f_stream_len_title || qd_flags.f_stream_len_heading ||
-           qd_flags.f_stream_len_inlink || qd_flags.f_stream_len_a;
-  }
+  inline bool has_stream_len() { return has_family(feature::stream_len); }
 
   inline bool has_sum_stream_len() {
-    return qd_flags.f_sum_stream_len || qd_flags.f_sum_stream_len_body ||
-           qd_flags.f_sum_stream_len_title ||
-           qd_flags.f_sum_stream_len_heading ||
-           qd_flags.f_sum_stream_len_inlink || qd_flags.f_sum_stream_len_a;
+    return has_family(feature::sum_stream_len);
   }
 
   inline bool has_min_stream_len() {
-    return qd_flags.f_min_stream_len || qd_flags.f_min_stream_len_body ||
-           qd_flags.f_min_stream_len_title ||
-           qd_flags.f_min_stream_len_heading ||
-           qd_flags.f_min_stream_len_inlink || qd_flags.f_min_stream_len_a;
+    return has_family(feature::min_stream_len);
   }
 
   inline bool has_max_stream_len() {
-    return qd_flags.f_max_stream_len || qd_flags.f_max_stream_len_body ||
-           qd_flags.f_max_stream_len_title ||
-           qd_flags.f_max_stream_len_heading ||
-           qd_flags.f_max_stream_len_inlink || qd_flags.f_max_stream_len_a;
+    return has_family(feature::max_stream_len);
   }
 
   inline bool has_mean_stream_len() {
-    return qd_flags.f_mean_stream_len || qd_flags.f_mean_stream_len_body ||
-           qd_flags.f_mean_stream_len_title ||
-           qd_flags.f_mean_stream_len_heading ||
-           qd_flags.f_mean_stream_len_inlink || qd_flags.f_mean_stream_len_a;
+    return has_family(feature::mean_stream_len);
   }
 
   inline bool has_variance_stream_len() {
-    return qd_flags.f_variance_stream_len ||
-           qd_flags.f_variance_stream_len_body ||
-           qd_flags.f_variance_stream_len_title ||
-           qd_flags.f_variance_stream_len_heading ||
-           qd_flags.f_variance_stream_len_inlink ||
-           qd_flags.f_variance_stream_len_a;
+    return has_family(feature::variance_stream_len);
   }
 
-  inline bool has_tpscore() { return qd_flags.f_tpscore; }
+  inline bool has_tpscore() { return flags[feature::tpscore]; }
 
   /* lgr: fixup #XXX */
   inline bool has_proximity() {
-    return qd_flags.f_bm25_bigram_u8 || qd_flags.f_bm25_tp_dist_w100;
+    return flags[feature::bm25_bigram_u8] || flags[feature::bm25_tp_dist_w100];
   }
 
   /* lgr: to be moved see #4 */
   inline bool has_tag_count() {
-    return qd_flags.f_tag_title_count || qd_flags.f_tag_heading_count ||
-           qd_flags.f_tag_inlink_count || qd_flags.f_tag_applet_count ||
-           qd_flags.f_tag_object_count || qd_flags.f_tag_embed_count;
+    return flags[feature::tag_title_count] ||
+           flags[feature::tag_heading_count] ||
+           flags[feature::tag_inlink_count] ||
+           flags[feature::tag_applet_count] ||
+           flags[feature::tag_object_count] || flags[feature::tag_embed_count];
   }
 };
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Every feature that can be extracted, in the order of the output columns.
+ * `X(name)` declares feature `feature::name`, which is enabled by the flag
+ * `--f_name`.
+ *
+ * The members of a term weighting family follow each other, the whole
+ * document first and then `QueryContext::fields`, so that a family is written
+ * from the id of its first member.
+ */
+#define FXT_QUERY_DOC_FEATURES(X) \
+  /* Score from training trec run file */ \
+  X(stage0_score) \
+  /* BM25 Atire */ \
+  X(bm25_atire) \
+  X(bm25_atire_body) \
+  X(bm25_atire_title) \
+  X(bm25_atire_heading) \
+  X(bm25_atire_inlink) \
+  X(bm25_atire_a) \
+  /* BM25 TREC3 k = 1.2, b = 0.75 */ \
+  X(bm25_trec3) \
+  X(bm25_trec3_body) \
+  X(bm25_trec3_title) \
+  X(bm25_trec3_heading) \
+  X(bm25_trec3_inlink) \
+  X(bm25_trec3_a) \
+  /* BM25 TREC3 k = 2.0, b = 0.75 */ \
+  X(bm25_trec3_kmax) \
+  X(bm25_trec3_kmax_body) \
+  X(bm25_trec3_kmax_title) \
+  X(bm25_trec3_kmax_heading) \
+  X(bm25_trec3_kmax_inlink) \
+  X(bm25_trec3_kmax_a) \
+  /* BM25 bigram unordered window score (sum of unigram scores) */ \
+  X(bm25_bigram_u8) \
+  /* BM25 score of bigram intervals in window (Lu, et al.) */ \
+  X(bm25_tp_dist_w100) \
+  /* SDM with default parameters */ \
+  X(sdm) \
+  /* TP-Score */ \
+  X(tpscore) \
+  /* QL mu = 2500 */ \
+  X(lm_dir_2500) \
+  X(lm_dir_2500_body) \
+  X(lm_dir_2500_title) \
+  X(lm_dir_2500_heading) \
+  X(lm_dir_2500_inlink) \
+  X(lm_dir_2500_a) \
+  /* QL mu = 1500 */ \
+  X(lm_dir_1500) \
+  X(lm_dir_1500_body) \
+  X(lm_dir_1500_title) \
+  X(lm_dir_1500_heading) \
+  X(lm_dir_1500_inlink) \
+  X(lm_dir_1500_a) \
+  /* QL mu = 1000 */ \
+  X(lm_dir_1000) \
+  X(lm_dir_1000_body) \
+  X(lm_dir_1000_title) \
+  X(lm_dir_1000_heading) \
+  X(lm_dir_1000_inlink) \
+  X(lm_dir_1000_a) \
+  /* tfidf */ \
+  X(tfidf) \
+  X(tfidf_body) \
+  X(tfidf_title) \
+  X(tfidf_heading) \
+  X(tfidf_inlink) \
+  X(tfidf_a) \
+  /* Probability */ \
+  X(prob) \
+  X(prob_body) \
+  X(prob_title) \
+  X(prob_heading) \
+  X(prob_inlink) \
+  X(prob_a) \
+  /* DFR: Bose-Einstien */ \
+  X(be) \
+  X(be_body) \
+  X(be_title) \
+  X(be_heading) \
+  X(be_inlink) \
+  X(be_a) \
+  /* DFR: DPH */ \
+  X(dph) \
+  X(dph_body) \
+  X(dph_title) \
+  X(dph_heading) \
+  X(dph_inlink) \
+  X(dph_a) \
+  /* DFR: BB2 */ \
+  X(dfr) \
+  X(dfr_body) \
+  X(dfr_title) \
+  X(dfr_heading) \
+  X(dfr_inlink) \
+  X(dfr_a) \
+  /* Stream */ \
+  X(stream_len) \
+  X(stream_len_body) \
+  X(stream_len_title) \
+  X(stream_len_heading) \
+  X(stream_len_inlink) \
+  X(stream_len_a) \
+  /* Stream sum normalised by tf */ \
+  X(sum_stream_len) \
+  X(sum_stream_len_body) \
+  X(sum_stream_len_title) \
+  X(sum_stream_len_heading) \
+  X(sum_stream_len_inlink) \
+  X(sum_stream_len_a) \
+  /* Stream min normalised by tf */ \
+  X(min_stream_len) \
+  X(min_stream_len_body) \
+  X(min_stream_len_title) \
+  X(min_stream_len_heading) \
+  X(min_stream_len_inlink) \
+  X(min_stream_len_a) \
+  /* Stream max normalised by tf */ \
+  X(max_stream_len) \
+  X(max_stream_len_body) \
+  X(max_stream_len_title) \
+  X(max_stream_len_heading) \
+  X(max_stream_len_inlink) \
+  X(max_stream_len_a) \
+  /* Stream mean normalised by tf */ \
+  X(mean_stream_len) \
+  X(mean_stream_len_body) \
+  X(mean_stream_len_title) \
+  X(mean_stream_len_heading) \
+  X(mean_stream_len_inlink) \
+  X(mean_stream_len_a) \
+  /* Stream variance normalised by tf */ \
+  X(variance_stream_len) \
+  X(variance_stream_len_body) \
+  X(variance_stream_len_title) \
+  X(variance_stream_len_heading) \
+  X(variance_stream_len_inlink) \
+  X(variance_stream_len_a) \
+  /* The frequency of query terms within the <title>, <heading> and */ \
+  /* <mainbody> tags and the inlinks */ \
+  X(tag_title_qry_count) \
+  X(tag_heading_qry_count) \
+  X(tag_mainbody_qry_count) \
+  X(tag_inlink_qry_count) \
+  /* The number of <title> and <heading> (h1-h4) tags, of inlinks, and of */ \
+  /* <applet>, <object> and <embed> tags in the document */ \
+  X(tag_title_count) \
+  X(tag_heading_count) \
+  X(tag_inlink_count) \
+  X(tag_applet_count) \
+  X(tag_object_count) \
+  X(tag_embed_count)
+
+/*
+ * The static document features, in the order of `statdoc_entry`. They follow
+ * the query-document features.
+ */
+#define FXT_STATIC_DOC_FEATURES(X) \
+  X(len) \
+  X(title_len) \
+  X(visterm_len) \
+  X(url_len) \
+  X(url_depth) \
+  X(avg_term_len) \
+  X(entropy) \
+  X(stop_cover) \
+  X(frac_stop) \
+  X(frac_anchor_text) \
+  X(frac_vis_text) \
+  X(frac_table_text) \
+  X(frac_td_text) \
+  X(is_wikipedia)
+
+namespace feature {
+
+enum Id : size_t {
+#define FXT_FEATURE_ID(name) name,
+  FXT_QUERY_DOC_FEATURES(FXT_FEATURE_ID)
+  FXT_STATIC_DOC_FEATURES(FXT_FEATURE_ID)
+#undef FXT_FEATURE_ID
+  count
+};
+
+// The members of a term weighting family, see `FXT_QUERY_DOC_FEATURES`
+constexpr size_t family_size = 6;
+
+// Features from here on are static document features
+constexpr Id first_static = len;
+
+/**
+ * The name of feature `id`, as in its flag without the `f_` prefix.
+ */
+inline const char *name(Id id) {
+  static const char *const names[] = {
+#define FXT_FEATURE_NAME(name) #name,
+      FXT_QUERY_DOC_FEATURES(FXT_FEATURE_NAME)
+      FXT_STATIC_DOC_FEATURES(FXT_FEATURE_NAME)
+#undef FXT_FEATURE_NAME
+  };
+  return names[id];
+}
+
+}  // namespace feature
+
+/**
+ * The features of one query-document pair, indexed by `feature::Id`. The
+ * feature classes write their scores straight into a row, and a row is
+ * reused from one document to the next.
+ */
+using FeatureRow = std::array<double, feature::count>;
+
+/**
+ * A `FeatureRow` rounded to single precision, for learners that only read
+ * float32 features.
+ */
+using FloatFeatureRow = std::array<float, feature::count>;
+
+/**
+ * Which features to extract, indexed by `feature::Id`.
+ */
+using FeatureFlags = std::array<bool, feature::count>;
+
+/**
+ * The ids of the features enabled by `flags`, in column order.
+ */
+inline std::vector<feature::Id> enabled_features(const FeatureFlags &flags) {
+  std::vector<feature::Id> ids;
+  for (size_t id = 0; id < feature::count; ++id) {
+    if (flags[id]) {
+      ids.push_back(feature::Id(id));
+    }
+  }
+  return ids;
+}
+
+/**
+ * The members of a term weighting family to compute: `mask[0]` is the whole
+ * document and `mask[1 + f]` is `QueryContext::fields[f]`.
+ */
+using FamilyMask = std::bitset<feature::family_size>;
+
+// Every member of a family
+constexpr FamilyMask all_members{(1ULL << feature::family_size) - 1};
+
+/**
+ * The members of the family that starts at `first` that `flags` enables.
+ */
+inline FamilyMask family_mask(const FeatureFlags &flags, feature::Id first) {
+  FamilyMask mask;
+  for (size_t s = 0; s < feature::family_size; ++s) {
+    mask[s] = flags[first + s];
+  }
+  return mask;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Format feature rows into a reusable character buffer.
+ *
+ * Numbers are formatted with `std::to_chars`, which avoids the locale and
+ * stream state handling of `std::ostream`. Doubles are written with five
+ * fixed decimals, the same as `std::fixed << std::setprecision(5)`.
+ * `clear` keeps the allocated capacity, so a buffer that is reused for every
+ * query stops allocating once it has grown to fit the largest one.
+ */
+class FeatureBuffer {
+  static const int precision = 5;
+  // Enough for any double in fixed notation: 309 integer digits, the sign,
+  // the decimal point and the decimals.
+  static const size_t max_double_len = 320;
+  std::string buf_;
+
+ public:
+  const char *data() const { return buf_.data(); }
+  size_t size() const { return buf_.size(); }
+  bool empty() const { return buf_.empty(); }
+  void clear() { buf_.clear(); }
+  void reserve(size_t n) { buf_.reserve(n); }
+
+  /**
+   * Move the formatted rows out of the buffer.
+   */
+  std::string release() {
+    std::string s;
+    s.swap(buf_);
+    return s;
+  }
+
+  void append(const char *s, size_t n) { buf_.append(s, n); }
+  void append(const FeatureBuffer &other) { buf_.append(other.buf_); }
+
+  /**
+   * Append the bytes of `v` as they are in memory, for binary output.
+   */
+  template <typename T>
+  void append_bytes(const T &v) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be written as bytes");
+    buf_.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+
+  FeatureBuffer &operator<<(double v) {
+    char tmp[max_double_len];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v,
+                             std::chars_format::fixed, precision);
+    buf_.append(tmp, res.ptr - tmp);
+    return *this;
+  }
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+  FeatureBuffer &operator<<(T v) {
+    char tmp[24];
+    auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    buf_.append(tmp, res.ptr - tmp);
+    return *this;
+  }
+
+  FeatureBuffer &operator<<(char c) {
+    buf_.push_back(c);
+    return *this;
+  }
+
+  FeatureBuffer &operator<<(const char *s) {
+    buf_.append(s);
+    return *this;
+  }
+
+  FeatureBuffer &operator<<(const std::string &s) {
+    buf_.append(s);
+    return *this;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const FeatureBuffer &buf) {
+  return os.write(buf.data(), buf.size());
+}
+
+/**
+ * A `std::streambuf` that collects output in large blocks before passing it
+ * to `sink`.
+ *
+ * With `background` set, full blocks are written by a separate thread while
+ * the next block is filled (double buffering), so the extraction threads do
+ * not wait on the disk. `sync` (that is, `flush`) hands the current block to
+ * the writer thread without waiting for it to be written. Call `close`, or
+ * destroy the writer, to wait for all output to reach `sink`.
+ */
+class FeatureWriter : public std::streambuf {
+  std::ostream &sink_;
+  bool background_;
+  std::vector<char> blocks_[2];
+  size_t active_ = 0;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // Length of the block waiting for the writer thread, `0` when idle
+  size_t pending_len_ = 0;
+  const char *pending_ = nullptr;
+  bool closed_ = false;
+  // Set by the writer thread, which owns `sink_` while it runs
+  bool failed_ = false;
+
+  void start_block() {
+    char *p = blocks_[active_].data();
+    // Leave room for the character passed to `overflow`
+    setp(p, p + blocks_[active_].size() - 1);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [&]() { return pending_len_ > 0 || closed_; });
+      if (0 == pending_len_) {
+        return;
+      }
+      const char *p = pending_;
+      size_t n = pending_len_;
+      lock.unlock();
+      sink_.write(p, n);
+      lock.lock();
+      failed_ = failed_ || !sink_;
+      pending_len_ = 0;
+      cv_.notify_all();
+    }
+  }
+
+  void wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return 0 == pending_len_; });
+  }
+
+  /**
+   * Pass the current block to the sink and start a new one.
+   */
+  void hand_off() {
+    size_t n = pptr() - pbase();
+    if (0 == n) {
+      return;
+    }
+    if (!background_) {
+      sink_.write(pbase(), n);
+      start_block();
+      return;
+    }
+    wait_idle();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = pbase();
+      pending_len_ = n;
+    }
+    cv_.notify_all();
+    active_ = 1 - active_;
+    start_block();
+  }
+
+ protected:
+  int_type overflow(int_type ch) override {
+    hand_off();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    std::streamsize left = n;
+    while (left > 0) {
+      std::streamsize room = epptr() - pptr();
+      if (0 == room) {
+        hand_off();
+        continue;
+      }
+      std::streamsize len = std::min(room, left);
+      std::memcpy(pptr(), s, len);
+      pbump(len);
+      s += len;
+      left -= len;
+    }
+    return n;
+  }
+
+  int sync() override {
+    hand_off();
+    if (background_) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return failed_ ? -1 : 0;
+    }
+    sink_.flush();
+    return sink_.good() ? 0 : -1;
+  }
+
+ public:
+  FeatureWriter(std::ostream &sink, bool background = false,
+                size_t block_size = 1 << 20)
+      : sink_(sink), background_(background) {
+    if (block_size < 2) {
+      block_size = 2;
+    }
+    blocks_[0].resize(block_size);
+    if (background_) {
+      blocks_[1].resize(block_size);
+      thread_ = std::thread(&FeatureWriter::run, this);
+    }
+    start_block();
+  }
+
+  ~FeatureWriter() { close(); }
+
+  FeatureWriter(const FeatureWriter &) = delete;
+  FeatureWriter &operator=(const FeatureWriter &) = delete;
+
+  /**
+   * Write all buffered output to the sink and stop the writer thread.
+   */
+  void close() {
+    hand_off();
+    if (thread_.joinable()) {
+      wait_idle();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+      cv_.notify_all();
+      thread_.join();
+    }
+    sink_.flush();
+  }
+};
@@ -18,13 +18,25 @@ struct rank_bm25 {
 
   void set_k1(const double val) { k1 = val; }
   void set_b(const double val) { b = val; }
-  double calculate_docscore(const double f_qt, const double f_dt,
-                            const double f_t, const double W_d) const {
-    double w_qt = std::max(
-        epsilon_score, std::log((num_docs - f_t + 0.5) / (f_t + 0.5)) * f_qt);
+
+  /**
+   * The query term weight, which does not depend on the document, `k1` or `b`.
+   */
+  double calculate_query_weight(const double f_qt, const double f_t) const {
+    return std::max(epsilon_score,
+                    std::log((num_docs - f_t + 0.5) / (f_t + 0.5)) * f_qt);
+  }
+
+  double calculate_docscore(const double w_qt, const double f_dt,
+                            const double W_d) const {
     double K_d = k1 * ((1 - b) + (b * (W_d / avg_doc_len)));
     double w_dt = ((k1 + 1) * f_dt) / (K_d + f_dt);
 
     return w_dt * w_qt;
   }
+
+  double calculate_docscore(const double f_qt, const double f_dt,
+                            const double f_t, const double W_d) const {
+    return calculate_docscore(calculate_query_weight(f_qt, f_t), f_dt, W_d);
+  }
 };
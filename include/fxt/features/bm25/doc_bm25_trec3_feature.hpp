@@ -14,20 +14,16 @@
  */
 class doc_bm25_trec3_feature : public doc_bm25_feature {
  public:
-  doc_bm25_trec3_feature(Lexicon &lex) : doc_bm25_feature(lex) {}
+  static constexpr double k1 = 1.2;
+  static constexpr double b = 0.75;
 
-  void compute(query_train &qry, doc_entry &doc, Document &doc_idx,
-               FieldIdMap &field_id_map) {
-    ranker.set_k1(1.2);
-    ranker.set_b(0.75);
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const QueryTermFreqs &freqs, FamilyMask mask = all_members) {
+    ranker.set_k1(k1);
+    ranker.set_b(b);
 
-    bm25_compute(qry, doc, doc_idx, field_id_map);
+    bm25_compute(ctx, row, freqs, mask);
 
-    doc.bm25_trec3 = _score_doc;
-    doc.bm25_trec3_body = _score_body;
-    doc.bm25_trec3_title = _score_title;
-    doc.bm25_trec3_heading = _score_heading;
-    doc.bm25_trec3_inlink = _score_inlink;
-    doc.bm25_trec3_a = _score_a;
+    store(row, feature::bm25_trec3);
   }
 };
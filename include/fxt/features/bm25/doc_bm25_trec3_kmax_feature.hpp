@@ -13,20 +13,16 @@
  */
 class doc_bm25_trec3_kmax_feature : public doc_bm25_feature {
  public:
-  doc_bm25_trec3_kmax_feature(Lexicon &lex) : doc_bm25_feature(lex) {}
+  static constexpr double k1 = 2.0;
+  static constexpr double b = 0.75;
 
-  void compute(query_train &qry, doc_entry &doc, Document &doc_idx,
-               FieldIdMap &field_id_map) {
-    ranker.set_k1(2.0);
-    ranker.set_b(0.75);
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const QueryTermFreqs &freqs, FamilyMask mask = all_members) {
+    ranker.set_k1(k1);
+    ranker.set_b(b);
 
-    bm25_compute(qry, doc, doc_idx, field_id_map);
+    bm25_compute(ctx, row, freqs, mask);
 
-    doc.bm25_trec3_kmax = _score_doc;
-    doc.bm25_trec3_kmax_body = _score_body;
-    doc.bm25_trec3_kmax_title = _score_title;
-    doc.bm25_trec3_kmax_heading = _score_heading;
-    doc.bm25_trec3_kmax_inlink = _score_inlink;
-    doc.bm25_trec3_kmax_a = _score_a;
+    store(row, feature::bm25_trec3_kmax);
   }
 };
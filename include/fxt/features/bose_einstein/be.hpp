@@ -7,14 +7,32 @@
 
 #pragma once
 
-double calculate_be(uint32_t d_f, uint64_t c_f, uint32_t num_docs,
-                    double avg_dlen, uint32_t dlen) {
-  double l, r, prime, rsv;
+/**
+ * The parts of the Bose-Einstein score that only depend on the term.
+ */
+struct be_term {
+  double l = 0.0;
+  double r = 0.0;
+};
+
+inline be_term calculate_be_term(uint64_t c_f, uint32_t num_docs) {
+  be_term term;
+  term.l = std::log(1.0 + (double)c_f / num_docs);
+  term.r = std::log(1.0 + (double)num_docs / (double)c_f);
+  return term;
+}
+
+inline double calculate_be(uint32_t d_f, const be_term &term, double avg_dlen,
+                           uint32_t dlen) {
+  double prime, rsv;
 
-  l = std::log(1.0 + (double)c_f / num_docs);
-  r = std::log(1.0 + (double)num_docs / (double)c_f);
   prime = d_f * std::log(1.0 + avg_dlen / (double)dlen);
-  rsv = (l + prime * r) / (prime + 1.0);
+  rsv = (term.l + prime * term.r) / (prime + 1.0);
 
   return rsv;
 }
+
+inline double calculate_be(uint32_t d_f, uint64_t c_f, uint32_t num_docs,
+                           double avg_dlen, uint32_t dlen) {
+  return calculate_be(d_f, calculate_be_term(c_f, num_docs), avg_dlen, dlen);
+}
@@ -7,15 +7,35 @@
 
 #pragma once
 
-double calculate_dfr(uint32_t d_f, uint64_t c_f, uint32_t c_idf,
-                     uint32_t num_docs, double avg_dlen, uint32_t dlen) {
-  double fp1, ne, ir, prime, rsv;
+/**
+ * The parts of the DFR score that only depend on the term.
+ */
+struct dfr_term {
+  double fp1 = 0.0;
+  double ir = 0.0;
+};
+
+inline dfr_term calculate_dfr_term(uint64_t c_f, uint32_t num_docs) {
+  dfr_term term;
+  double ne;
 
-  fp1 = c_f + 1.0;
+  term.fp1 = c_f + 1.0;
   ne = num_docs * (1.0 - std::pow((num_docs - 1.0) / num_docs, c_f));
-  ir = std::log2(((double)num_docs + 1.0) / (ne + 0.5));
+  term.ir = std::log2(((double)num_docs + 1.0) / (ne + 0.5));
+  return term;
+}
+
+inline double calculate_dfr(uint32_t d_f, const dfr_term &term,
+                            uint32_t c_idf, double avg_dlen, uint32_t dlen) {
+  double prime, rsv;
 
   prime = d_f * std::log2(1.0 + (double)avg_dlen / (double)dlen);
-  rsv = prime * ir * (fp1 / ((double)c_idf * (prime + 1.0)));
+  rsv = prime * term.ir * (term.fp1 / ((double)c_idf * (prime + 1.0)));
   return rsv;
 }
+
+inline double calculate_dfr(uint32_t d_f, uint64_t c_f, uint32_t c_idf,
+                            uint32_t num_docs, double avg_dlen, uint32_t dlen) {
+  return calculate_dfr(d_f, calculate_dfr_term(c_f, num_docs), c_idf, avg_dlen,
+                       dlen);
+}
@@ -17,26 +17,19 @@
 
 #include "indri/Index.hpp"
 
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/fused_scorer.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
 #include "fxt/query_train_file.hpp"
 
-namespace {
-static const std::string _field_title = "title";
-static const std::vector<std::string> _fields = {"body", _field_title,
-                                                 "heading", "inlink", "a"};
-}  // namespace
-
 /**
  * Score segments of a document with a given query.
  */
 class doc_feature {
  public:
-  Lexicon &lexicon;
-
-  uint64_t _coll_len = 0;
-  uint64_t _num_docs = 0;
-  double _avg_doc_len = 0.0;
-
   double _score_doc = 0.0;
   double _score_body = 0.0;
   double _score_title = 0.0;
@@ -46,10 +39,34 @@ class doc_feature {
   // FIXME: implement url score
   double _score_url = 0.0;
 
-  doc_feature(Lexicon &lex) : lexicon(lex) {
-    _coll_len = lexicon.term_count();
-    _num_docs = lexicon.document_count();
-    _avg_doc_len = (double)_coll_len / _num_docs;
+ private:
+  // Scores the family of the feature class, see `fused_compute`
+  FusedScorer fused_;
+  FamilyMask fused_mask_;
+
+ public:
+  /**
+   * Score the members in `mask` of the term weighting family of the feature
+   * class, `family`, with `FusedScorer`. The other members are zero.
+   */
+  void fused_compute(const QueryContext &ctx, const QueryTermFreqs &freqs,
+                     FusedScorer::Family family, FamilyMask mask) {
+    // The family of a feature class is always the same, only the mask varies
+    if (fused_.empty() || mask != fused_mask_) {
+      family.mask = mask;
+      fused_ = FusedScorer();
+      fused_.add(family);
+      fused_mask_ = mask;
+    }
+    fused_.score(ctx, freqs);
+    const double *score = fused_.scores(0);
+    _score_doc = score[0];
+    _score_body = score[1];
+    _score_title = score[2];
+    _score_heading = score[3];
+    _score_inlink = score[4];
+    _score_a = score[5];
+    _score_url = 0.0;
   }
 
   inline void reset() {
@@ -62,21 +79,43 @@ class doc_feature {
     _score_url = 0.0;
   }
 
-  void _accumulate_score(std::string key, double val) {
-    if (0 == key.compare(_fields[0])) {
-      _score_body += val;
-    } else if (0 == key.compare(_fields[1])) {
-      _score_title += val;
-    } else if (0 == key.compare(_fields[2])) {
-      _score_heading += val;
-    } else if (0 == key.compare(_fields[3])) {
-      _score_inlink += val;
-    } else if (0 == key.compare(_fields[4])) {
-      _score_a += val;
-    } else {
-      std::ostringstream oss;
-      oss << "unkown field " << key;
-      throw std::invalid_argument(oss.str());
+  /**
+   * Write the scores to the family of features that starts at `first`, see
+   * `FXT_QUERY_DOC_FEATURES`.
+   */
+  void store(FeatureRow &row, feature::Id first) const {
+    row[first] = _score_doc;
+    row[first + 1] = _score_body;
+    row[first + 2] = _score_title;
+    row[first + 3] = _score_heading;
+    row[first + 4] = _score_inlink;
+    row[first + 5] = _score_a;
+  }
+
+  /**
+   * Add `val` to the score of `QueryContext::fields[field]`.
+   */
+  void _accumulate_score(size_t field, double val) {
+    switch (field) {
+      case 0:
+        _score_body += val;
+        break;
+      case 1:
+        _score_title += val;
+        break;
+      case 2:
+        _score_heading += val;
+        break;
+      case 3:
+        _score_inlink += val;
+        break;
+      case 4:
+        _score_a += val;
+        break;
+      default:
+        std::ostringstream oss;
+        oss << "unkown field " << field;
+        throw std::invalid_argument(oss.str());
     }
   }
 };
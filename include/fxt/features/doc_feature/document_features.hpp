@@ -15,6 +15,9 @@
 
 #include "indri/Index.hpp"
 
+#include "fxt/feature_row.hpp"
+#include "fxt/query_context.hpp"
+
 class document_features {
   // The frequency of query terms within the <title> tag
   size_t tag_title_qry_count = 0;
@@ -39,59 +42,58 @@ class document_features {
     F_STR_OBJECT,
     F_STR_EMBED,
   };
-  static std::map<std::string, uint16_t> field_lookup;
 
  public:
-  void compute(query_train &qry, doc_entry &doc, Document &doc_idx,
-               FieldIdMap &field_id_map) {
+  /**
+   * The query term counts are only computed for the tags that `flags`
+   * enables, the tag counts are always set.
+   */
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const DocumentView &doc_idx, const FeatureFlags &flags) {
     /*
-     * List of fields for the current document. The field `id` indicates which
-     * field it is, e.g. title, heading, etc
+     * Fields of the current document, in the order of
+     * `QueryContext::tag_fields`, which is also the order of `field_id` from
+     * `F_STR_TITLE` and of the features from `tag_title_qry_count`.
      */
-
-    const std::vector<std::string> idx_fields = {
-        "title", "heading", "mainbody", "inlink", "applet", "object", "embed"};
-    for (auto field_str : idx_fields) {
-      int field_id = field_id_map[field_str];
+    for (size_t f = 0; f < QueryContext::num_tag_query_fields; ++f) {
+      int field_id = ctx.tag_field_id(f);
       if (field_id < 1) {
         // field does not exist
         continue;
       }
-
-      auto i = field_lookup.at(field_str);
-      if (i > MARKER_STOP_QRY_COUNT) {
-        // only count the number of tags
+      if (!flags[feature::tag_title_qry_count + f]) {
         continue;
       }
 
       size_t qry_term_count = 0;
-      for (auto &q : qry.q_ft) {
-        qry_term_count += doc_idx.freq(field_id, q.first);
+      for (auto &q : ctx.terms()) {
+        qry_term_count += doc_idx.freq(field_id, q.id);
       }
 
-      set_tag_qry_count(field_str, qry_term_count);
+      set_tag_qry_count(F_STR_TITLE + f, qry_term_count);
     }
 
-    doc.tag_title_qry_count = tag_title_qry_count;
-    doc.tag_heading_qry_count = tag_heading_qry_count;
-    doc.tag_mainbody_qry_count = tag_mainbody_qry_count;
-    doc.tag_inlink_qry_count = tag_inlink_qry_count;
+    row[feature::tag_title_qry_count] = tag_title_qry_count;
+    row[feature::tag_heading_qry_count] = tag_heading_qry_count;
+    row[feature::tag_mainbody_qry_count] = tag_mainbody_qry_count;
+    row[feature::tag_inlink_qry_count] = tag_inlink_qry_count;
 
-    doc.tag_title_count = doc_idx.tag_count(field_id_map["title"]);
-    if (doc.tag_title_count > 1) {
+    int tag_title_count = doc_idx.tag_count(ctx.tag_field_id(0));
+    if (tag_title_count > 1) {
       // penalise docs with more than 1 `title` tag
-      doc.tag_title_count = -doc.tag_title_count;
+      tag_title_count = -tag_title_count;
     }
+    row[feature::tag_title_count] = tag_title_count;
 
-    doc.tag_heading_count = doc_idx.tag_count(field_id_map["heading"]);
-    doc.tag_inlink_count = doc_idx.tag_count(field_id_map["inlink"]);
-    doc.tag_applet_count = doc_idx.tag_count(field_id_map["applet"]);
-    doc.tag_object_count = doc_idx.tag_count(field_id_map["object"]);
-    doc.tag_embed_count = doc_idx.tag_count(field_id_map["embed"]);
+    row[feature::tag_heading_count] = doc_idx.tag_count(ctx.tag_field_id(1));
+    row[feature::tag_inlink_count] = doc_idx.tag_count(ctx.tag_field_id(3));
+    row[feature::tag_applet_count] = doc_idx.tag_count(ctx.tag_field_id(4));
+    row[feature::tag_object_count] = doc_idx.tag_count(ctx.tag_field_id(5));
+    row[feature::tag_embed_count] = doc_idx.tag_count(ctx.tag_field_id(6));
   }
 
-  void set_tag_qry_count(std::string field, size_t n) {
-    switch (field_lookup.at(field)) {
+  void set_tag_qry_count(size_t field, size_t n) {
+    switch (field) {
       case F_STR_TITLE:
         tag_title_qry_count = n;
         break;
@@ -114,10 +116,3 @@ class document_features {
     }
   }
 };
-
-std::map<std::string, uint16_t> document_features::field_lookup = {
-    {"title", F_STR_TITLE},       {"heading", F_STR_HEADING},
-    {"mainbody", F_STR_MAINBODY}, {"inlink", F_STR_INLINK},
-    {"applet", F_STR_APPLET},     {"object", F_STR_OBJECT},
-    {"embed", F_STR_EMBED},
-};
@@ -7,14 +7,26 @@
 
 #pragma once
 
-double calculate_dph(uint32_t d_f, uint64_t c_f, uint32_t num_docs,
-                     double avg_dlen, uint32_t dlen) {
+/**
+ * The part of the DPH score that only depends on the term.
+ */
+inline double calculate_dph_term(uint64_t c_f, uint32_t num_docs) {
+  return (double)num_docs / (double)c_f;
+}
+
+inline double calculate_dph(uint32_t d_f, double term, double avg_dlen,
+                            uint32_t dlen) {
   double f, norm, score;
   f = (double)d_f / (double)dlen;
   norm = (1.0 - f) * (1.0 - f) / (d_f + 1.0);
   score = 1.0 * norm *
-          ((double)d_f * log2(((double)d_f * (double)avg_dlen / (double)dlen) *
-                              ((double)num_docs / (double)c_f)) +
+          ((double)d_f *
+               log2(((double)d_f * (double)avg_dlen / (double)dlen) * term) +
            0.5 * log2(2.0 * M_PI * d_f * (1.0 - f)));
   return (score);
+}
+
+inline double calculate_dph(uint32_t d_f, uint64_t c_f, uint32_t num_docs,
+                            double avg_dlen, uint32_t dlen) {
+  return calculate_dph(d_f, calculate_dph_term(c_f, num_docs), avg_dlen, dlen);
 }
\ No newline at end of file
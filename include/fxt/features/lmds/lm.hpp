@@ -9,13 +9,26 @@
 
 #include <cmath>
 
-inline double calculate_lm(uint32_t d_f, uint64_t c_f, uint32_t dlen,
-                           uint64_t clen, double mu) {
-  double numerator = d_f + mu * (c_f / clen);
+/**
+ * The collection probability of a term as `calculate_lm` smooths with it.
+ * Note that it is an integer division.
+ */
+inline double calculate_lm_term(uint64_t c_f, uint64_t clen) {
+  return c_f / clen;
+}
+
+inline double calculate_lm(uint32_t d_f, double coll_prob, uint32_t dlen,
+                           double mu) {
+  double numerator = d_f + mu * coll_prob;
   double denominator = dlen + mu;
   return std::log(numerator / denominator);
 }
 
+inline double calculate_lm(uint32_t d_f, uint64_t c_f, uint32_t dlen,
+                           uint64_t clen, double mu) {
+  return calculate_lm(d_f, calculate_lm_term(c_f, clen), dlen, mu);
+}
+
 /**
  * Dirichlet scoring function as per Indri implementation. Smoothing is applied
  * to the given context (a.k.a. collection). See
@@ -17,7 +17,11 @@
 
 #include "bm25_proximity.hpp"
 
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/query_term_positions.hpp"
 #include "fxt/query_train_file.hpp"
+#include "fxt/span.hpp"
 #include "tp_dist.hpp"
 
 struct term_data {
@@ -45,7 +49,6 @@ struct term_data {
 
 class doc_proximity_feature {
   const int cdf_empty = -1;
-  Lexicon &lexicon;
   bm25_proximity<> ranker;
   size_t feature_id = 0;  // FIXME: Can remove it is unused
   double score = 0.0;
@@ -54,18 +57,20 @@ class doc_proximity_feature {
   std::map<uint64_t, term_data> term_data_map;
 
  public:
-  doc_proximity_feature(Lexicon &lex) : lexicon(lex) {
-    ranker.num_docs = lex.document_count();
-    auto num_terms = lex.term_count();
-    ranker.avg_doc_len = (double)num_terms / ranker.num_docs;
-  }
-
   /**
-   * Two features are computed here, `bm25_bigram_u8` and `bm25_tp_dist_w100`.
+   * Two features are computed here, `bm25_bigram_u8` and `bm25_tp_dist_w100`,
+   * each only if `flags` enables it.
    */
-  void compute(query_train &query, doc_entry &doc, Document &doc_idx,
-               std::unordered_map<uint32_t, std::vector<uint32_t>> &positions) {
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const QueryTermFreqs &freqs,
+               const QueryTermPositions &positions,
+               const FeatureFlags &flags) {
+    const bool bigram = flags[feature::bm25_bigram_u8];
+    const bool tp_dist = flags[feature::bm25_tp_dist_w100];
+    const query_train &query = ctx.query();
     score = 0.0;
+    ranker.num_docs = ctx.document_count();
+    ranker.avg_doc_len = ctx.avg_doc_len();
 
     // condensed direct file
     std::vector<std::pair<uint64_t, int>> cdf;
@@ -76,21 +81,21 @@ class doc_proximity_feature {
     int i = 0;
     int s = 0;
     for (auto &tid : query.tids) {
-      if (lexicon.is_oov(tid)) {
+      if (tid == ctx.lexicon().oov_term()) {
         continue;
       }
-      if (doc_idx.freq(tid) != 0) {
+      size_t t = ctx.term_index(tid);
+      if (freqs.freq(t) != 0) {
         ++s;
-        term_data curr_term(
-            tid, lexicon[tid].document_count(), doc_idx.freq(tid),
-            ranker.calculate_wq(doc_idx.freq(tid)), query.pos[i]);
-        term_data_map.insert(std::pair<uint64_t, term_data>(tid, curr_term));
-
-        _acc_positions_insert(acc_positions, positions[tid], acc_terms,
-                              curr_term);
-
-        for (auto pos : positions[tid]) {
-          cdf.push_back(std::make_pair(tid, pos));
+        term_data curr_term(tid, ctx.stats(t).document_count, freqs.freq(t),
+                            ranker.calculate_wq(freqs.freq(t)), query.pos[i]);
+        if (bigram) {
+          term_data_map.insert(
+              std::pair<uint64_t, term_data>(tid, curr_term));
+        }
+        if (tp_dist) {
+          _acc_positions_insert(acc_positions, positions.positions(tid),
+                                acc_terms, curr_term);
         }
       }
       ++i;
@@ -100,21 +105,28 @@ class doc_proximity_feature {
       return;
     }
 
-    // sort cdf
-    std::sort(cdf.begin(), cdf.end(),
-              [](const std::pair<uint64_t, int> &lhs,
-                 const std::pair<uint64_t, int> &rhs) {
-                return lhs.second < rhs.second;
-              });
+    if (bigram) {
+      // The query term occurrences are already in position order. A query
+      // term that is repeated in the query only occurs once here, which
+      // `cdf_search` does not tell apart, since it skips pairs of the same
+      // term.
+      for (const auto &hit : positions.hits()) {
+        if (hit.term != ctx.lexicon().oov_term()) {
+          cdf.push_back(std::make_pair(hit.term, hit.pos));
+        }
+      }
 
-    // find bigrams of all query term pairs
-    score = 0.0;
-    cdf_search(TP_BIGRAM, cdf, query, 8, doc_idx.length());
-    doc.bm25_bigram_u8 = score;
+      // find bigrams of all query term pairs
+      score = 0.0;
+      cdf_search(TP_BIGRAM, cdf, ctx, 8, freqs.length());
+      row[feature::bm25_bigram_u8] = score;
+    }
 
-    // Xiaolu, et al.
-    doc.bm25_tp_dist_w100 =
-        tp_interval_score(acc_positions, acc_terms, 100, doc_idx.length());
+    if (tp_dist) {
+      // Xiaolu, et al.
+      row[feature::bm25_tp_dist_w100] =
+          tp_interval_score(acc_positions, acc_terms, 100, freqs.length());
+    }
 
     // Clear for next doc
     term_data_map.clear();
@@ -146,7 +158,7 @@ class doc_proximity_feature {
   // unordered query term pairs in the order that they appear within the CDF.
   void cdf_search(const enum term_pair_type ty,
                   std::vector<std::pair<uint64_t, int>> const &cdf,
-                  const query_train &query, const int window,
+                  const QueryContext &ctx, const int window,
                   const int doc_length) {
     std::vector<term_pair> found;
 
@@ -174,33 +186,25 @@ class doc_proximity_feature {
         if (dist > 0 && dist <= _window) {
           auto data_a = term_data_map[lhs.first];
           auto data_b = term_data_map[rhs.first];
-          int q_ft;
-
-          q_ft = 0;
-          {
-            auto it = query.q_ft.find(lhs.first);
-            if (it != query.q_ft.end()) {
-              q_ft = it->second;
-            }
-          }
-          score += ranker.score(q_ft, data_a.f_dt, data_a.total_term_docs,
-                                doc_length);
-
-          q_ft = 0;
-          {
-            auto it = query.q_ft.find(rhs.first);
-            if (it != query.q_ft.end()) {
-              q_ft = it->second;
-            }
-          }
-          score += ranker.score(q_ft, data_b.f_dt, data_b.total_term_docs,
-                                doc_length);
+
+          score += ranker.score(query_frequency(ctx, lhs.first), data_a.f_dt,
+                                data_a.total_term_docs, doc_length);
+          score += ranker.score(query_frequency(ctx, rhs.first), data_b.f_dt,
+                                data_b.total_term_docs, doc_length);
           found.emplace_back(ty, dist, lhs, rhs, score);
         }
       }
     }
   }
 
+  /**
+   * The frequency of `tid` in the query, `0` if it is not a query term.
+   */
+  static int query_frequency(const QueryContext &ctx, uint64_t tid) {
+    size_t t = ctx.term_index(tid);
+    return t < ctx.terms().size() ? ctx.terms()[t].q_ft : 0;
+  }
+
   /**
    * Bigram interval score. Based on Lu, et al. Efficient and Effective Higher
    * Order Proximity Modeling, ICTIR 2016.
@@ -248,22 +252,26 @@ class doc_proximity_feature {
    */
   void _acc_positions_insert(
       std::vector<indri::utility::greedy_vector<int>> &pos_vec,
-      const std::vector<uint32_t> &pos_el, std::vector<term_data> &term_vec,
+      Span<uint32_t> pos_el, std::vector<term_data> &term_vec,
       term_data &term_el) {
+    indri::utility::greedy_vector<int> pos;
+    for (auto p : pos_el) {
+      pos.push_back(p);
+    }
     if (pos_vec.empty()) {
-      pos_vec.push_back(pos_el);
+      pos_vec.push_back(pos);
       term_vec.push_back(term_el);
       return;
     }
 
     auto pos_itr = pos_vec.begin();
     auto term_itr = term_vec.begin();
-    while (pos_el.size() > pos_itr->size() && pos_itr != pos_vec.end()) {
+    while (pos_itr != pos_vec.end() && pos_el.size() > pos_itr->size()) {
       //!< if current freq is larger than the previous ones
       ++pos_itr;
       ++term_itr;
     }
-    pos_vec.insert(pos_itr, pos_el);
+    pos_vec.insert(pos_itr, pos);
     term_vec.insert(term_itr, term_el);
   }
 };
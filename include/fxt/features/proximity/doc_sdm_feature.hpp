@@ -7,15 +7,19 @@
 
 #pragma once
 
-#include <string>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "sdm.hpp"
 
-#include "fxt/doc_entry.hpp"
-#include "fxt/forward_index.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/forward_index_reader.hpp"
 #include "fxt/inverted_index.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_positions.hpp"
 #include "fxt/query_train_file.hpp"
 
 /**
@@ -27,11 +31,6 @@ class DocSdmFeature {
    */
   double score_ = 0.0;
 
-  /**
-   * Query with the current scoring context.
-   */
-  std::string query_id_ = "";
-
   /**
    * The SDM scoring function.
    */
@@ -44,17 +43,42 @@ class DocSdmFeature {
   DocSdmFeature(Sdm &sdm) : sdm_(sdm) {}
 
   /**
-   * Score query-document using SDM.
+   * Fetch postings and setup data structures required for scoring `query`.
+   * Called for every query, since the id of a query does not tell apart
+   * queries from different requests in server mode.
+   */
+  void set_query(const query_train &query, const InvertedIndex &invidx) {
+    sdm_.set_context(query, invidx);
+  }
+
+  /**
+   * As above, with the postings of `query` already fetched by
+   * `make_context`, which may be shared with other threads.
+   */
+  void set_query(const query_train &query,
+                 std::shared_ptr<const SdmContext> ctx) {
+    sdm_.set_context(query, std::move(ctx));
+  }
+
+  /**
+   * Fetch the postings of `query`, for `set_query`.
+   */
+  std::shared_ptr<const SdmContext> make_context(const query_train &query,
+                                                 const InvertedIndex &invidx) {
+    return sdm_.make_context(query, invidx);
+  }
+
+  /**
+   * Score query-document using SDM, given the query term `positions` of
+   * `document`. The query of `ctx` must have been passed to `set_query`.
    */
-  void compute(query_train &query, doc_entry &dentry, Document &document,
-               Lexicon &lexicon, ForwardIndex &fwdidx, InvertedIndex &invidx) {
-    if (query_id_ != query.id) {
-      // Fetch postings and setup data structures required for scoring the
-      // current query.
-      sdm_.set_context(query, invidx);
-      query_id_ = query.id;
-    }
-    score_ = sdm_.extract(query, document, lexicon, fwdidx, invidx);
-    dentry.sdm = score_;
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const DocumentView &document, const ForwardIndexReader &fwdidx,
+               const InvertedIndex &invidx,
+               const QueryTermPositions &positions) {
+    const query_train &query = ctx.query();
+    score_ = sdm_.extract(query, document, ctx.lexicon(), fwdidx, invidx,
+                          positions);
+    row[feature::sdm] = score_;
   }
 };
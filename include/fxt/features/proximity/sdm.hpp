@@ -11,12 +11,16 @@
 #include <cmath>
 #include <limits>
 #include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "fxt/features/lmds/lm.hpp"
 #include "fxt/forward_index.hpp"
+#include "fxt/forward_index_reader.hpp"
 #include "fxt/inverted_index.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/query_term_positions.hpp"
 #include "fxt/query_train_file.hpp"
 
 /**
@@ -66,6 +70,20 @@ struct SdmTerm {
   uint32_t end() { return pos + 1; }
 };
 
+/**
+ * The postings of a query that SDM scores documents with: its bigrams, the
+ * postings of its terms, and the documents that have both terms of each
+ * bigram. It is built once for each query and only read while scoring, so the
+ * `Sdm` of every thread can share it.
+ */
+struct SdmContext {
+  std::vector<SdmBigram> bigrams;
+  // Term id to posting list map
+  std::map<size_t, Posting> tid_postings;
+  // Intersection of docid's from bigram terms
+  std::vector<std::vector<uint32_t>> docid;
+};
+
 /**
  * Sequential Dependence Model.
  *
@@ -99,9 +117,13 @@ class Sdm {
   DirichletTermScore phrase_score_fn_;
 
   // Data structures for the current scoring context.
-  std::vector<SdmBigram> ctx_bigrams_;
-  std::map<size_t, Posting> ctx_tid_postings_;
-  std::vector<std::vector<uint32_t>> ctx_docid_;
+  std::shared_ptr<const SdmContext> ctx_ = std::make_shared<SdmContext>();
+  // Query term positions of the current document, unless they are given.
+  QueryTermPositions ctx_positions_;
+  // Scratch document for forward indexes that are not held in memory.
+  Document ctx_doc_;
+  // Scratch term positions for counting unordered phrases.
+  std::vector<SdmTerm> ctx_terms_;
 
  public:
   Sdm(double mu = 2500, double mu_phrase = 2500, double term_weight = 0.8,
@@ -135,15 +157,26 @@ class Sdm {
 
   /**
    * Calculate ordered bigram statistics for the current scoring context. The
-   * given `Document` is the current one to be scored.
+   * given `Document` (or `DocumentView`) is the current one to be scored.
+   */
+  template <typename Doc, typename Index>
+  std::vector<SdmBigram> search_ordered_phrase(const Doc &doc,
+                                               const Index &fwdidx) {
+    ctx_positions_.build(doc.terms());
+    return search_ordered_phrase(doc, fwdidx, ctx_positions_);
+  }
+
+  /**
+   * As above, with the query term `positions` of `doc` already collected.
    */
-  std::vector<SdmBigram> search_ordered_phrase(const Document &doc,
-                                               const ForwardIndex &fwdidx) {
+  template <typename Doc, typename Index>
+  std::vector<SdmBigram> search_ordered_phrase(
+      const Doc &, const Index &fwdidx, const QueryTermPositions &positions) {
     std::vector<SdmBigram> od;
 
-    for (size_t i = 0; i < ctx_bigrams_.size(); ++i) {
-      SdmBigram bigram = ctx_bigrams_[i];
-      bigram.document_count = count_ordered_phrase(bigram, doc);
+    for (size_t i = 0; i < ctx_->bigrams.size(); ++i) {
+      SdmBigram bigram = ctx_->bigrams[i];
+      bigram.document_count = count_ordered_phrase(bigram, positions);
 
       if (0 == bigram.document_count) {
         // Phrases that don't exist in the document are
@@ -155,8 +188,8 @@ class Sdm {
 
       // Scan the forward index to find the collection frequency for the given
       // bigram
-      for (auto j : ctx_docid_[i]) {
-        const auto &d = fwdidx[j];
+      for (auto j : ctx_->docid[i]) {
+        const auto &d = fetch_document(fwdidx, j, ctx_doc_);
         bigram.term_count += count_ordered_phrase(bigram, d);
       }
       od.push_back(bigram);
@@ -171,7 +204,8 @@ class Sdm {
    * takes ideas from the following Indri classes:
    * indri::infnet::UnorderedWindowNode, indri::infnet::ContextCountAccumulator.
    */
-  uint64_t count_ordered_phrase(const SdmBigram &qry, const Document &doc) {
+  template <typename Doc>
+  uint64_t count_ordered_phrase(const SdmBigram &qry, const Doc &doc) {
     uint64_t count = 0;
 
     if (doc.length() < min_qry_len_) {
@@ -200,17 +234,60 @@ class Sdm {
     return count;
   }
 
+  /**
+   * Count ordered phrases as above, from the query term `positions` of the
+   * document rather than all of its terms.
+   */
+  uint64_t count_ordered_phrase(const SdmBigram &qry,
+                                const QueryTermPositions &positions) {
+    uint64_t count = 0;
+    auto first = positions.positions(qry.first);
+    auto second = positions.positions(qry.second);
+
+    size_t last_end = 0;
+    size_t j = 0;
+    for (size_t pos : first) {
+      // no duplicates (overlapping)
+      if (pos < last_end) {
+        continue;
+      }
+      while (j < second.size() && second[j] <= pos) {
+        ++j;
+      }
+      if (j == second.size()) {
+        break;
+      }
+      if (second[j] == pos + 1) {
+        ++count;
+        last_end = pos + 2;
+      }
+    }
+
+    return count;
+  }
+
   /**
    * Calculate unordered bigram statistics for the current scoring context. The
-   * given `Document` is the current one to be scored.
+   * given `Document` (or `DocumentView`) is the current one to be scored.
    */
-  std::vector<SdmBigram> search_unordered_phrase(const Document &doc,
-                                                 const ForwardIndex &fwdidx) {
+  template <typename Doc, typename Index>
+  std::vector<SdmBigram> search_unordered_phrase(const Doc &doc,
+                                                 const Index &fwdidx) {
+    ctx_positions_.build(doc.terms());
+    return search_unordered_phrase(doc, fwdidx, ctx_positions_);
+  }
+
+  /**
+   * As above, with the query term `positions` of `doc` already collected.
+   */
+  template <typename Doc, typename Index>
+  std::vector<SdmBigram> search_unordered_phrase(
+      const Doc &, const Index &fwdidx, const QueryTermPositions &positions) {
     std::vector<SdmBigram> uw;
 
-    for (size_t i = 0; i < ctx_bigrams_.size(); ++i) {
-      SdmBigram bigram = ctx_bigrams_[i];
-      bigram.document_count = count_unordered_phrase(bigram, doc);
+    for (size_t i = 0; i < ctx_->bigrams.size(); ++i) {
+      SdmBigram bigram = ctx_->bigrams[i];
+      bigram.document_count = count_unordered_phrase(bigram, positions);
 
       if (0 == bigram.document_count) {
         // Phrases that don't exist in the document are
@@ -222,8 +299,8 @@ class Sdm {
 
       // Scan the forward index to find the collection frequency for the given
       // bigram
-      for (auto j : ctx_docid_[i]) {
-        const auto &d = fwdidx[j];
+      for (auto j : ctx_->docid[i]) {
+        const auto &d = fetch_document(fwdidx, j, ctx_doc_);
         bigram.term_count += count_unordered_phrase(bigram, d);
       }
       uw.push_back(bigram);
@@ -238,13 +315,14 @@ class Sdm {
    * takes ideas from  UnorderedWindowNode::prepare,
    * ContextCountAccumulator::evaluate.
    */
-  uint64_t count_unordered_phrase(const SdmBigram &qry, const Document &doc) {
-    uint64_t count = 0;
-    std::vector<SdmTerm> terms;
+  template <typename Doc>
+  uint64_t count_unordered_phrase(const SdmBigram &qry, const Doc &doc) {
+    std::vector<SdmTerm> &terms = ctx_terms_;
     std::set<size_t> seen;
+    terms.clear();
 
     // Collect term positions
-    auto tv = doc.terms();
+    const auto &tv = doc.terms();
     for (size_t i = 0; i < doc.length(); ++i) {
       if (qry.first == tv[i]) {
         terms.push_back({TY_FIRST, i, DEFAULT_LAST});
@@ -258,9 +336,49 @@ class Sdm {
 
     // Only continue if all terms appear in the document
     if (2 != seen.size()) {
-      return count;
+      return 0;
     }
 
+    return count_unordered_terms(terms);
+  }
+
+  /**
+   * Count unordered phrases as above, from the query term `positions` of the
+   * document rather than all of its terms.
+   */
+  uint64_t count_unordered_phrase(const SdmBigram &qry,
+                                  const QueryTermPositions &positions) {
+    auto first = positions.positions(qry.first);
+    auto second = positions.positions(qry.second);
+
+    // Only continue if all terms appear in the document
+    if (first.empty() || second.empty()) {
+      return 0;
+    }
+
+    // Merge the positions in the order the document scan above finds them
+    std::vector<SdmTerm> &terms = ctx_terms_;
+    terms.clear();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < first.size() || j < second.size()) {
+      if (j == second.size() || (i < first.size() && first[i] <= second[j])) {
+        terms.push_back({TY_FIRST, first[i++], DEFAULT_LAST});
+      } else {
+        terms.push_back({TY_SECOND, second[j++], DEFAULT_LAST});
+      }
+    }
+
+    return count_unordered_terms(terms);
+  }
+
+  /**
+   * Count unordered phrases in the positions `terms` of both bigram terms, in
+   * position order.
+   */
+  uint64_t count_unordered_terms(std::vector<SdmTerm> &terms) {
+    uint64_t count = 0;
+
     std::sort(terms.begin(), terms.end());
 
     // Setup `SdmTerm` last positions to track which window the term was last
@@ -418,17 +536,33 @@ class Sdm {
   }
 
   /**
-   * Set the scoring context for `qry`. Fetch the term postings and setup
+   * Build the scoring context for `qry`. Fetch the term postings and setup
    * auxillary data structures for the query bigrams and the intersection of
    * document id's having the given query bigrams.
    */
-  void set_context(const query_train &qry, const InvertedIndex invidx) {
-    // Bigrams from the query
-    ctx_bigrams_ = bigrams(qry);
-    // Term id to posting list map
-    ctx_tid_postings_ = unigram_postings(qry, invidx);
-    // Intersection of docid's from bigram terms
-    ctx_docid_ = bigram_postings(ctx_bigrams_, ctx_tid_postings_);
+  std::shared_ptr<const SdmContext> make_context(const query_train &qry,
+                                                 const InvertedIndex &invidx) {
+    auto ctx = std::make_shared<SdmContext>();
+    ctx->bigrams = bigrams(qry);
+    ctx->tid_postings = unigram_postings(qry, invidx);
+    ctx->docid = bigram_postings(ctx->bigrams, ctx->tid_postings);
+    return ctx;
+  }
+
+  /**
+   * Set the scoring context for `qry`, built by `make_context`.
+   */
+  void set_context(const query_train &qry,
+                   std::shared_ptr<const SdmContext> ctx) {
+    ctx_ = std::move(ctx);
+    ctx_positions_.set_query(qry);
+  }
+
+  /**
+   * Build the scoring context for `qry` and set it.
+   */
+  void set_context(const query_train &qry, const InvertedIndex &invidx) {
+    set_context(qry, make_context(qry, invidx));
   }
 
   /**
@@ -437,9 +571,20 @@ class Sdm {
    * FIXME: Should this be renamed to `score` or `evalute`? The clasess with
    *        `compute` functions are doing "extraction" from an API viewpoint.
    */
-  double extract(const query_train &qry, const Document &doc,
-                 const Lexicon &lex, const ForwardIndex &fwdidx,
-                 const InvertedIndex &invidx) {
+  template <typename Doc, typename Index>
+  double extract(const query_train &qry, const Doc &doc, const Lexicon &lex,
+                 const Index &fwdidx, const InvertedIndex &invidx) {
+    ctx_positions_.build(doc.terms());
+    return extract(qry, doc, lex, fwdidx, invidx, ctx_positions_);
+  }
+
+  /**
+   * As above, with the query term `positions` of `doc` already collected.
+   */
+  template <typename Doc, typename Index>
+  double extract(const query_train &qry, const Doc &doc, const Lexicon &lex,
+                 const Index &fwdidx, const InvertedIndex &,
+                 const QueryTermPositions &positions) {
     // reset score
     score_ = 0.0;
 
@@ -453,7 +598,7 @@ class Sdm {
     // Score the independent terms and compute the weights within
     // Indri's `#combine()` operator. For example `#weight(0.8 #combine(foo
     // bar))` assigns a weight of 0.4 to each of "foo" and "bar".
-    for (auto &pentry : ctx_tid_postings_) {
+    for (auto &pentry : ctx_->tid_postings) {
       // Unpack `pentry` for readability
       auto term_id = pentry.first;
       Posting postings = pentry.second;
@@ -468,7 +613,8 @@ class Sdm {
     // then score and compute weights.
     // FIXME - some form of statistics caching should be used when scoring
     // multiple documents
-    std::vector<SdmBigram> od_phrases = search_ordered_phrase(doc, fwdidx);
+    std::vector<SdmBigram> od_phrases =
+        search_ordered_phrase(doc, fwdidx, positions);
     for (auto &od : od_phrases) {
       feature_scores.push_back(score_phrase(od.document_count, doc.length(),
                                             od.term_count, lex.term_count()));
@@ -479,7 +625,8 @@ class Sdm {
     // then score and compute weights.
     // FIXME - some form of statistics caching should be used when scoring
     // multiple documents
-    std::vector<SdmBigram> uw_phrases = search_unordered_phrase(doc, fwdidx);
+    std::vector<SdmBigram> uw_phrases =
+        search_unordered_phrase(doc, fwdidx, positions);
     for (auto &uw : uw_phrases) {
       feature_scores.push_back(score_phrase(uw.document_count, doc.length(),
                                             uw.term_count, lex.term_count()));
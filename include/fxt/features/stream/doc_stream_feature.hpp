@@ -7,140 +7,94 @@
 
 #pragma once
 
+#include "fxt/feature_row.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+
 class doc_stream_feature {
- public:
-  void compute(query_train &qry, doc_entry &doc, Document &doc_idx,
-               FieldIdMap &field_id_map) {
-    auto body_id = field_id_map["body"];
-    auto title_id = field_id_map["title"];
-    auto heading_id = field_id_map["heading"];
-    auto inlink_id = field_id_map["inlink"];
-    auto a_id = field_id_map["a"];
+  /**
+   * Whether any of the features normalised by tf is enabled for member `col`
+   * of the stream families.
+   */
+  static bool has_tf_normalised(const FeatureFlags &flags, size_t col) {
+    return flags[feature::sum_stream_len + col] ||
+           flags[feature::min_stream_len + col] ||
+           flags[feature::max_stream_len + col] ||
+           flags[feature::mean_stream_len + col] ||
+           flags[feature::variance_stream_len + col];
+  }
 
+ public:
+  /**
+   * Compute the stream features enabled by `flags`, a field is skipped when
+   * none of its features are.
+   */
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const DocumentView &doc_idx, const QueryTermFreqs &freqs,
+               const FeatureFlags &flags) {
     // stream length is set for the score member variables
-    doc.stream_len = doc_idx.length();
-    doc.stream_len_body = doc_idx.field_len(body_id);
-    doc.stream_len_title = doc_idx.field_len(title_id);
-    // penalise docs with more than 1 title tag
-    if (doc_idx.tag_count(title_id) > 1) {
-      doc.stream_len_title = -doc.stream_len_title;
+    if (flags[feature::stream_len]) {
+      row[feature::stream_len] = doc_idx.length();
     }
-    doc.stream_len_heading = doc_idx.field_len(heading_id);
-    doc.stream_len_inlink = doc_idx.field_len(inlink_id);
-    doc.stream_len_a = doc_idx.field_len(a_id);
 
     double doc_tf = 0;
-    double body_tf = 0;
-    double title_tf = 0;
-    double heading_tf = 0;
-    double inlink_tf = 0;
-    double a_tf = 0;
-
-    for (auto &q : qry.q_ft) {
-      doc_tf += doc_idx.freq(q.first);
-      body_tf += doc_idx.freq(body_id, q.first);
-      title_tf += doc_idx.freq(title_id, q.first);
-      heading_tf += doc_idx.freq(heading_id, q.first);
-      inlink_tf += doc_idx.freq(inlink_id, q.first);
-      a_tf += doc_idx.freq(a_id, q.first);
+    if (has_tf_normalised(flags, 0)) {
+      doc_tf = freqs.tf_sum();
     }
-
     if (doc_tf) {
-      doc.sum_stream_len = (double)doc_idx.length() / doc_tf;
-      doc.min_stream_len = doc.sum_stream_len;
-      doc.max_stream_len = doc.sum_stream_len;
-      doc.mean_stream_len = doc.sum_stream_len;
-      doc.variance_stream_len =
+      row[feature::sum_stream_len] = (double)doc_idx.length() / doc_tf;
+      row[feature::min_stream_len] = row[feature::sum_stream_len];
+      row[feature::max_stream_len] = row[feature::sum_stream_len];
+      row[feature::mean_stream_len] = row[feature::sum_stream_len];
+      row[feature::variance_stream_len] =
           ((double)doc_idx.length() - doc_idx.length() * doc_idx.length()) /
           doc_tf;
     }
-    if (body_tf) {
-      doc.sum_stream_len_body = (double)doc_idx.field_len(body_id) / body_tf;
-      doc.min_stream_len_body =
-          (double)doc_idx.field_min_len(body_id) / body_tf;
-      doc.max_stream_len_body =
-          (double)doc_idx.field_max_len(body_id) / body_tf;
-      doc.mean_stream_len_body = (double)((double)doc_idx.field_len(body_id) /
-                                          doc_idx.tag_count(body_id)) /
-                                 body_tf;
-      doc.variance_stream_len_body =
-          (((double)doc_idx.field_len_sum_sqrs(body_id) /
-            doc_idx.field_len(body_id)) -
-           ((double)doc_idx.field_len(body_id) / doc_idx.tag_count(body_id)) *
-               ((double)doc_idx.field_len(body_id) /
-                doc_idx.tag_count(body_id))) /
-          body_tf;
-    }
-    if (title_tf) {
-      doc.sum_stream_len_title = (double)doc_idx.field_len(title_id) / title_tf;
-      doc.min_stream_len_title =
-          (double)doc_idx.field_min_len(title_id) / title_tf;
-      doc.max_stream_len_title =
-          (double)doc_idx.field_max_len(title_id) / title_tf;
-      doc.mean_stream_len_title = (double)((double)doc_idx.field_len(title_id) /
-                                           doc_idx.tag_count(title_id)) /
-                                  title_tf;
-      doc.variance_stream_len_title =
-          (((double)doc_idx.field_len_sum_sqrs(title_id) /
-            doc_idx.field_len(title_id)) -
-           ((double)doc_idx.field_len(title_id) / doc_idx.tag_count(title_id)) *
-               ((double)doc_idx.field_len(title_id) /
-                doc_idx.tag_count(title_id))) /
-          title_tf;
-    }
-    if (heading_tf) {
-      doc.sum_stream_len_heading =
-          (double)doc_idx.field_len(heading_id) / heading_tf;
-      doc.min_stream_len_heading =
-          (double)doc_idx.field_min_len(heading_id) / heading_tf;
-      doc.max_stream_len_heading =
-          (double)doc_idx.field_max_len(heading_id) / heading_tf;
-      doc.mean_stream_len_heading =
-          (double)((double)doc_idx.field_len(heading_id) /
-                   doc_idx.tag_count(heading_id)) /
-          heading_tf;
-      doc.variance_stream_len_heading =
-          (((double)doc_idx.field_len_sum_sqrs(heading_id) /
-            doc_idx.field_len(heading_id)) -
-           ((double)doc_idx.field_len(heading_id) /
-            doc_idx.tag_count(heading_id)) *
-               ((double)doc_idx.field_len(heading_id) /
-                doc_idx.tag_count(heading_id))) /
-          heading_tf;
-    }
-    if (inlink_tf) {
-      doc.sum_stream_len_inlink =
-          (double)doc_idx.field_len(inlink_id) / inlink_tf;
-      doc.min_stream_len_inlink =
-          (double)doc_idx.field_min_len(inlink_id) / inlink_tf;
-      doc.max_stream_len_inlink =
-          (double)doc_idx.field_max_len(inlink_id) / inlink_tf;
-      doc.mean_stream_len_inlink =
-          (double)((double)doc_idx.field_len(inlink_id) /
-                   doc_idx.tag_count(inlink_id)) /
-          inlink_tf;
-      doc.variance_stream_len_inlink =
-          (((double)doc_idx.field_len_sum_sqrs(inlink_id) /
-            doc_idx.field_len(inlink_id)) -
-           ((double)doc_idx.field_len(inlink_id) /
-            doc_idx.tag_count(inlink_id)) *
-               ((double)doc_idx.field_len(inlink_id) /
-                doc_idx.tag_count(inlink_id))) /
-          inlink_tf;
-    }
-    if (a_tf) {
-      doc.sum_stream_len_a = (double)doc_idx.field_len(a_id) / a_tf;
-      doc.min_stream_len_a = (double)doc_idx.field_min_len(a_id) / a_tf;
-      doc.max_stream_len_a = (double)doc_idx.field_max_len(a_id) / a_tf;
-      doc.mean_stream_len_a =
-          (double)((double)doc_idx.field_len(a_id) / doc_idx.tag_count(a_id)) /
-          a_tf;
-      doc.variance_stream_len_a =
-          (((double)doc_idx.field_len_sum_sqrs(a_id) /
-            doc_idx.field_len(a_id)) -
-           ((double)doc_idx.field_len(a_id) / doc_idx.tag_count(a_id)) *
-               ((double)doc_idx.field_len(a_id) / doc_idx.tag_count(a_id))) /
-          a_tf;
+
+    // The fields follow the whole document in each family, in the order of
+    // `QueryContext::fields`
+    for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+      auto field_id = ctx.field_id(f);
+      size_t col = 1 + f;
+
+      if (flags[feature::stream_len + col]) {
+        row[feature::stream_len + col] = doc_idx.field_len(field_id);
+        // penalise docs with more than 1 title tag
+        if (1 == f && doc_idx.tag_count(field_id) > 1) {
+          row[feature::stream_len + col] = -row[feature::stream_len + col];
+        }
+      }
+
+      if (!has_tf_normalised(flags, col)) {
+        continue;
+      }
+      double tf = freqs.field_tf_sum(f);
+      if (!tf) {
+        continue;
+      }
+
+      double len = doc_idx.field_len(field_id);
+      if (flags[feature::sum_stream_len + col]) {
+        row[feature::sum_stream_len + col] = len / tf;
+      }
+      if (flags[feature::min_stream_len + col]) {
+        row[feature::min_stream_len + col] =
+            (double)doc_idx.field_min_len(field_id) / tf;
+      }
+      if (flags[feature::max_stream_len + col]) {
+        row[feature::max_stream_len + col] =
+            (double)doc_idx.field_max_len(field_id) / tf;
+      }
+      double mean_len = len / doc_idx.tag_count(field_id);
+      if (flags[feature::mean_stream_len + col]) {
+        row[feature::mean_stream_len + col] = mean_len / tf;
+      }
+      if (flags[feature::variance_stream_len + col]) {
+        row[feature::variance_stream_len + col] =
+            ((double)doc_idx.field_len_sum_sqrs(field_id) / len -
+             mean_len * mean_len) /
+            tf;
+      }
     }
   }
 };
@@ -7,10 +7,20 @@
 
 #pragma once
 
-static double calculate_tfidf(double d_f, double t_idf, double dlen,
-                              size_t num_docs) {
+/**
+ * The part of the TF-IDF score that only depends on the term.
+ */
+inline double calculate_tfidf_term(double t_idf, size_t num_docs) {
+  return std::log(1.0 + ((double)num_docs / t_idf));
+}
+
+inline double calculate_tfidf(double d_f, double w_Qq, double dlen) {
   double doc_norm = 1.0 / dlen;
   double w_dq = 1.0 + std::log(d_f);
-  double w_Qq = std::log(1.0 + ((double)num_docs / t_idf));
   return (doc_norm * w_dq * w_Qq);
 }
+
+inline double calculate_tfidf(double d_f, double t_idf, double dlen,
+                              size_t num_docs) {
+  return calculate_tfidf(d_f, calculate_tfidf_term(t_idf, num_docs), dlen);
+}
@@ -10,6 +10,7 @@
 #include <cmath>
 
 #include "fxt/features/bm25/doc_bm25_feature.hpp"
+#include "fxt/query_term_positions.hpp"
 
 struct bctp_term {
   int id;
@@ -24,11 +25,12 @@ struct bctp_scorer {
   double b = 0.4;
   double avg_doc_len = 0.0;
 
-  double score(std::vector<bctp_term> &terms, doc_entry &doc,
-               Document &doc_idx) {
+  double score(std::vector<bctp_term> &terms, FeatureRow &row,
+               const QueryTermFreqs &freqs,
+               const QueryTermPositions &positions) {
     double score = 0.0;
 
-    if (terms.size() < 3 || doc_idx.length() < terms.size()) {
+    if (terms.size() < 3 || freqs.length() < terms.size()) {
       return score;
     }
 
@@ -36,11 +38,11 @@ struct bctp_scorer {
     for (auto &t : terms) {
       term_map.insert(std::make_pair(t.id, &t));
     }
-    score_terms(term_map, doc_idx.terms());
+    score_terms(term_map, positions.hits());
 
     for (auto const &term : terms) {
       double weight = std::min(1.0, term.weight);
-      double K = k1 * ((1 - b) + (b * (doc_idx.length() / avg_doc_len)));
+      double K = k1 * ((1 - b) + (b * (freqs.length() / avg_doc_len)));
       double x = term.accumulator * (1 + k1);
       double y = term.accumulator + K;
 
@@ -50,8 +52,13 @@ struct bctp_scorer {
     return score;
   }
 
+  /**
+   * Accumulate the weights of neighbouring query terms, given the query term
+   * occurrences `hits` in position order. Other terms in between only add to
+   * the distance.
+   */
   void score_terms(std::map<int, bctp_term *> &terms,
-                   const std::vector<uint32_t> &doc_positions) {
+                   const std::vector<QueryTermPositions::Hit> &hits) {
     bctp_term *curr_term = nullptr;
     bctp_term *prev_term = nullptr;
     size_t prev_pos = 0;
@@ -60,10 +67,12 @@ struct bctp_scorer {
       t.second->weight = rw_idf_weight(t.second->doc_count);
     }
 
-    for (size_t pos = 0; pos < doc_positions.size(); ++pos) {
-      int term_id = doc_positions[pos];
-      if (terms.count(term_id) == 1) {
-        curr_term = terms[term_id];
+    for (const auto &hit : hits) {
+      int term_id = hit.term;
+      size_t pos = hit.pos;
+      auto it = terms.find(term_id);
+      if (it != terms.end()) {
+        curr_term = it->second;
         if (prev_term && prev_term->id != curr_term->id) {
           curr_term->accumulator += prev_term->weight * distance(pos, prev_pos);
           prev_term->accumulator += curr_term->weight * distance(pos, prev_pos);
@@ -90,34 +99,35 @@ class doc_tpscore_feature : public doc_bm25_feature {
   bctp_scorer ranker_bctp;
 
  public:
-  doc_tpscore_feature(Lexicon &lex) : doc_bm25_feature(lex) {
-    ranker_bctp.num_docs = _num_docs;
-    ranker_bctp.avg_doc_len = _avg_doc_len;
-  }
-
-  void compute(query_train &qry, doc_entry &doc, Document &doc_idx,
-               FieldIdMap &field_id_map) {
-    auto bm25_atire = doc.bm25_atire;
+  void compute(const QueryContext &ctx, FeatureRow &row,
+               const QueryTermFreqs &freqs,
+               const QueryTermPositions &positions) {
+    // The BM25 Atire score of the whole document, which is only in `row` if
+    // `f_bm25_atire` is enabled
+    auto bm25_atire = row[feature::bm25_atire];
     if (bm25_atire == 0) {
       ranker.set_k1(0.9);
       ranker.set_b(0.4);
-      bm25_compute(qry, doc, doc_idx, field_id_map);
+      bm25_compute(ctx, row, freqs, FamilyMask().set(0));
       bm25_atire = _score_doc;
     }
 
+    ranker_bctp.num_docs = ctx.document_count();
+    ranker_bctp.avg_doc_len = ctx.avg_doc_len();
     std::vector<bctp_term> bctp_query;
-    for (auto &q : qry.q_ft) {
+    const auto &terms = ctx.terms();
+    for (size_t i = 0; i < terms.size(); ++i) {
       bctp_term t;
-      if (lexicon.is_oov(q.first)) {
+      if (terms[i].oov) {
         continue;
       }
-      t.id = q.first;
-      t.doc_count = lexicon[q.first].document_count();
+      t.id = terms[i].id;
+      t.doc_count = ctx.stats(i).document_count;
       bctp_query.push_back(t);
     }
 
-    double tp_score = ranker_bctp.score(bctp_query, doc, doc_idx);
+    double tp_score = ranker_bctp.score(bctp_query, row, freqs, positions);
     // The TP-Score is BM25 + BCTP
-    doc.tpscore = bm25_atire + tp_score;
+    row[feature::tpscore] = bm25_atire + tp_score;
   }
 };
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 
 using FieldIdMap = std::map<std::string, int>;
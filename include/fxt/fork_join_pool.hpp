@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Run a job on a fixed number of threads at a time, and wait for all of them
+ * to finish it.
+ *
+ * The threads are started once and wait for the next job in between, so a
+ * job costs a wake-up rather than a thread for each thread. The thread that
+ * calls `run` is one of them, so a pool of one thread starts none.
+ */
+class ForkJoinPool {
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  // The current job, only set while `run` waits for it
+  const std::function<void(size_t)> *job_ = nullptr;
+  // Incremented for each job, so that a thread runs it only once
+  size_t generation_ = 0;
+  // Threads of `threads_` still running the current job
+  size_t running_ = 0;
+  bool stop_ = false;
+
+  void loop(size_t thread) {
+    size_t seen = 0;
+    while (true) {
+      const std::function<void(size_t)> *job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+        job = job_;
+      }
+      (*job)(thread);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (0 == --running_) {
+        done_.notify_one();
+      }
+    }
+  }
+
+ public:
+  /**
+   * A pool of `num_threads` threads, at least one, counting the caller of
+   * `run`.
+   */
+  explicit ForkJoinPool(size_t num_threads) {
+    for (size_t t = 1; t < num_threads; ++t) {
+      threads_.emplace_back(&ForkJoinPool::loop, this, t);
+    }
+  }
+
+  ForkJoinPool(const ForkJoinPool &) = delete;
+  ForkJoinPool &operator=(const ForkJoinPool &) = delete;
+
+  ~ForkJoinPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto &th : threads_) {
+      th.join();
+    }
+  }
+
+  size_t size() const { return threads_.size() + 1; }
+
+  /**
+   * Call `job(t)` on each thread `t` of the pool, `0` being the calling
+   * thread, and return once every call has returned.
+   */
+  void run(const std::function<void(size_t)> &job) {
+    if (!threads_.empty()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      running_ = threads_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return 0 == running_; });
+    job_ = nullptr;
+  }
+};
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <set>
 #include <unordered_map>
@@ -18,6 +19,8 @@
 #include "cereal/types/utility.hpp"
 #include "cereal/types/vector.hpp"
 
+#include "index_codecs.hpp"
+
 class Field {
   uint16_t m_tag_count = 0;
   uint16_t m_field_len = 0;
@@ -60,9 +63,81 @@ class Field {
   }
 };
 
+/**
+ * The slot of each field of a document and the stats of each slot.
+ *
+ * The slot of a field is its index in the fields of the document, or an index
+ * past them for a field that only has stats. Slots are found through a table
+ * indexed by field id, which is small since field ids are dense, and the stats
+ * are stored by slot, zero for a field without any.
+ */
+class FieldSlots {
+  std::vector<uint16_t> slots_;
+  std::vector<Field> stats_;
+
+  static constexpr uint16_t no_slot = std::numeric_limits<uint16_t>::max();
+  inline static const Field no_stats{0, 0, 0, 0, 0};
+
+  uint16_t &slot_of(uint16_t field_id) {
+    if (field_id >= slots_.size()) {
+      slots_.resize(field_id + 1, no_slot);
+    }
+    return slots_[field_id];
+  }
+
+ public:
+  /**
+   * Give each of the `n` `fields` its slot, with zero stats. A field that is
+   * listed more than once keeps its first slot.
+   */
+  void assign(const uint16_t *fields, size_t n) {
+    slots_.clear();
+    stats_.assign(n, no_stats);
+    for (size_t i = 0; i < n; ++i) {
+      auto &slot = slot_of(fields[i]);
+      if (no_slot == slot) {
+        slot = i;
+      }
+    }
+  }
+
+  /**
+   * Set the stats of `field_id`, which gets the next slot if it has none.
+   */
+  void set_stats(uint16_t field_id, const Field &stats) {
+    auto &slot = slot_of(field_id);
+    if (no_slot == slot) {
+      slot = stats_.size();
+      stats_.push_back(stats);
+    } else {
+      stats_[slot] = stats;
+    }
+  }
+
+  size_t slot(uint16_t field_id) const {
+    if (field_id >= slots_.size()) {
+      return no_slot;
+    }
+    return slots_[field_id];
+  }
+
+  const Field &stats(uint16_t field_id) const {
+    size_t i = slot(field_id);
+    return i < stats_.size() ? stats_[i] : no_stats;
+  }
+};
+
 /**
  * Represents a document in the forward index. It is preferred to store
  * document fields as vectors for optimal compression.
+ *
+ * The frequencies of the terms in each field are sparse, only the terms that
+ * occur in the field are stored. Before compression the vector of a field
+ * holds the indexes of its terms in `unique_terms()`, in ascending order,
+ * followed by their frequencies. Once compressed it holds the number of
+ * terms and the length of the encoded indexes, then the delta coded indexes
+ * and the frequencies, each encoded with the `field_freqs` codec. A field
+ * without terms is empty either way.
  */
 class Document {
   // A document `id` is a `uint32_t` for compression in postings, but is
@@ -76,8 +151,30 @@ class Document {
   std::vector<uint32_t> m_terms;
   std::vector<uint32_t> m_freqs;
   std::vector<uint16_t> m_fields;
+  // Sparse term frequencies of each field, see above
   std::vector<std::vector<uint32_t>> m_field_freqs;
   std::map<uint16_t, Field> m_field_stats;
+  // The slot and stats of each field, rebuilt by `index_fields` when the
+  // fields are loaded or set, so the accessors below never search `m_fields`
+  // or `m_field_stats`.
+  FieldSlots m_slots;
+
+  void index_fields() {
+    m_slots.assign(m_fields.data(), m_fields.size());
+    for (const auto &fs : m_field_stats) {
+      m_slots.set_stats(fs.first, fs.second);
+    }
+  }
+
+  // Copy the stats of `field_id` to its slot after they were set.
+  void update_stats(uint16_t field_id) {
+    m_slots.set_stats(field_id, m_field_stats[field_id]);
+  }
+
+  // Decodes the compressed streams without copying the document.
+  friend class DocumentView;
+  // Reads and writes the blobs of the mapped and arena forward indexes.
+  friend class DocumentBlob;
 
  public:
   // This constructor is required for cereal
@@ -88,20 +185,29 @@ class Document {
   size_t id() const { return id_; }
   uint32_t length() const { return m_terms.size(); }
 
-  const std::vector<uint16_t> fields() const { return m_fields; }
-  const std::vector<uint32_t> terms() const { return m_terms; }
-  const std::vector<uint32_t> unique_terms() const { return m_unique_terms; }
-  const std::vector<uint32_t> freqs() const { return m_freqs; }
-  const std::vector<std::vector<uint32_t>> field_freqs() const {
+  const std::vector<uint16_t> &fields() const { return m_fields; }
+  const std::vector<uint32_t> &terms() const { return m_terms; }
+  const std::vector<uint32_t> &unique_terms() const { return m_unique_terms; }
+  const std::vector<uint32_t> &freqs() const { return m_freqs; }
+  const std::vector<std::vector<uint32_t>> &field_freqs() const {
     return m_field_freqs;
   }
-  const std::map<uint16_t, Field> field_stats() const { return m_field_stats; }
+  const std::map<uint16_t, Field> &field_stats() const {
+    return m_field_stats;
+  }
 
   void set_fields(const std::vector<uint16_t> &fields) {
     m_fields = fields;
     m_field_freqs.resize(fields.size());
+    index_fields();
   }
 
+  /**
+   * The index of `field_id` in `fields()`. A field that the document does not
+   * have gets an index past the end of `fields()`.
+   */
+  size_t field_slot(uint16_t field_id) const { return m_slots.slot(field_id); }
+
   /**
    * Set document terms.
    *
@@ -158,18 +264,23 @@ class Document {
     if (it == m_unique_terms.end()) {
       return 0;
     }
-    size_t idx = std::distance(m_unique_terms.begin(), it);
-    auto f_it = std::find(m_fields.begin(), m_fields.end(), field_id);
-    if (f_it == m_fields.end()) {
+    uint32_t idx = std::distance(m_unique_terms.begin(), it);
+    size_t slot = field_slot(field_id);
+    if (slot >= m_field_freqs.size()) {
+      return 0;
+    }
+    const auto &ff = m_field_freqs[slot];
+    size_t n = ff.size() / 2;
+    auto pos = std::lower_bound(ff.begin(), ff.begin() + n, idx);
+    if (pos == ff.begin() + n || *pos != idx) {
       return 0;
     }
-    auto idx2 = std::distance(m_fields.begin(), f_it);
-    if (idx >= m_field_freqs.at(idx2).size()) return 0;
-    return m_field_freqs.at(idx2).at(idx);
+    return ff[n + std::distance(ff.begin(), pos)];
   }
 
   /**
-   * Set term frequency within a document field.
+   * Set term frequency within a document field. A frequency of zero removes
+   * the term from the field.
    */
   void set_freq(uint16_t field_id, uint32_t term, uint32_t freq) {
     auto it =
@@ -177,80 +288,125 @@ class Document {
     if (it == m_unique_terms.end()) {
       return;
     }
-    auto idx = std::distance(m_unique_terms.begin(), it);
-    auto f_it = std::find(m_fields.begin(), m_fields.end(), field_id);
-    if (f_it == m_fields.end()) {
+    uint32_t idx = std::distance(m_unique_terms.begin(), it);
+    size_t slot = field_slot(field_id);
+    if (slot >= m_field_freqs.size()) {
       return;
     }
-    auto idx2 = std::distance(m_fields.begin(), f_it);
-    m_field_freqs[idx2].resize(m_unique_terms.size());
-    m_field_freqs[idx2][idx] = freq;
+    auto &ff = m_field_freqs[slot];
+    size_t n = ff.size() / 2;
+    size_t pos =
+        std::distance(ff.begin(), std::lower_bound(ff.begin(), ff.begin() + n,
+                                                   idx));
+    if (pos < n && ff[pos] == idx) {
+      if (0 == freq) {
+        ff.erase(ff.begin() + n + pos);
+        ff.erase(ff.begin() + pos);
+      } else {
+        ff[n + pos] = freq;
+      }
+      return;
+    }
+    if (0 == freq) {
+      return;
+    }
+    // The frequency goes in first, so that it ends up after the new index
+    ff.insert(ff.begin() + n + pos, freq);
+    ff.insert(ff.begin() + pos, idx);
   }
 
-  uint16_t tag_count(uint16_t field_id) const {
-    if (m_field_stats.find(field_id) == m_field_stats.end()) {
-      return 0;
+  /**
+   * Set the frequencies of the terms within a document field at once, which
+   * replaces those set before. Unlike `set_freq` a term at a time, this does
+   * not shift the terms already in the field.
+   */
+  void set_field_freqs(uint16_t field_id,
+                       const std::unordered_map<uint32_t, uint32_t> &freqs) {
+    size_t slot = field_slot(field_id);
+    if (slot >= m_field_freqs.size()) {
+      return;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    for (const auto &f : freqs) {
+      auto it = std::lower_bound(m_unique_terms.begin(), m_unique_terms.end(),
+                                 f.first);
+      if (it != m_unique_terms.end() && *it == f.first && 0 != f.second) {
+        entries.emplace_back(std::distance(m_unique_terms.begin(), it),
+                             f.second);
+      }
     }
-    return m_field_stats.at(field_id).tag_count();
+    std::sort(entries.begin(), entries.end());
+    auto &ff = m_field_freqs[slot];
+    ff.resize(2 * entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      ff[i] = entries[i].first;
+      ff[entries.size() + i] = entries[i].second;
+    }
+  }
+
+  uint16_t tag_count(uint16_t field_id) const {
+    return m_slots.stats(field_id).tag_count();
   }
 
   void set_tag_count(uint16_t field_id, uint32_t tag_count) {
     m_field_stats[field_id].tag_count(tag_count);
+    update_stats(field_id);
   }
 
   uint16_t field_len(uint16_t field_id) const {
-    if (m_field_stats.find(field_id) == m_field_stats.end()) {
-      return 0;
-    }
-    return m_field_stats.at(field_id).field_len();
+    return m_slots.stats(field_id).field_len();
   }
 
   void set_field_len(uint16_t field_id, uint16_t field_len) {
     m_field_stats[field_id].field_len(field_len);
+    update_stats(field_id);
   }
 
   uint16_t field_min_len(uint16_t field_id) const {
-    if (m_field_stats.find(field_id) == m_field_stats.end()) {
-      return 0;
-    }
-    return m_field_stats.at(field_id).field_min_len();
+    return m_slots.stats(field_id).field_min_len();
   }
 
   void set_field_min_len(uint16_t field_id, uint16_t field_min_len) {
     m_field_stats[field_id].field_min_len(field_min_len);
+    update_stats(field_id);
   }
 
   uint16_t field_max_len(uint16_t field_id) const {
-    if (m_field_stats.find(field_id) == m_field_stats.end()) {
-      return 0;
-    }
-    return m_field_stats.at(field_id).field_max_len();
+    return m_slots.stats(field_id).field_max_len();
   }
 
   void set_field_max_len(uint16_t field_id, uint16_t field_max_len) {
     m_field_stats[field_id].field_max_len(field_max_len);
+    update_stats(field_id);
   }
 
   uint32_t field_len_sum_sqrs(uint16_t field_id) const {
-    if (m_field_stats.find(field_id) == m_field_stats.end()) {
-      return 0;
-    }
-    return m_field_stats.at(field_id).field_len_sum_sqrs();
+    return m_slots.stats(field_id).field_len_sum_sqrs();
   }
 
   void set_field_len_sum_sqrs(uint16_t field_id, uint32_t field_len_sum_sqrs) {
     m_field_stats[field_id].field_len_sum_sqrs(field_len_sum_sqrs);
+    update_stats(field_id);
   }
 
   /**
-   * Compress document. See `src/compression.cpp`
+   * Compress document with `codecs`. See `src/compression.cpp`
    */
-  void compress();
+  void compress(const StreamCodecs &codecs = StreamCodecs::defaults());
 
   /**
-   * Decompress document. See `src/compression.cpp`
+   * Decompress document that was compressed with `codecs`. See
+   * `src/compression.cpp`
    */
-  void decompress();
+  void decompress(const StreamCodecs &codecs = StreamCodecs::defaults());
+
+  /**
+   * Convert the field frequencies of a document from a forward index that
+   * stored them densely, one per unique term, to the sparse layout. See
+   * `IndexCodecs::dense_field_freqs` and `src/compression.cpp`.
+   */
+  void sparsify_field_freqs(
+      const StreamCodecs &codecs = StreamCodecs::defaults());
 
   /**
    * Map the term ids in `m_terms` into a local document space based on
@@ -282,9 +438,16 @@ class Document {
   }
 
   template <class Archive>
-  void serialize(Archive &archive) {
+  void save(Archive &archive) const {
+    archive(id_, m_fields, m_num_terms, m_terms, m_unique_terms, m_freqs,
+            m_field_freqs, m_field_stats);
+  }
+
+  template <class Archive>
+  void load(Archive &archive) {
     archive(id_, m_fields, m_num_terms, m_terms, m_unique_terms, m_freqs,
             m_field_freqs, m_field_stats);
+    index_fields();
   }
 };
 
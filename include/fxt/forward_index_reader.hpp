@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "document_view.hpp"
+#include "forward_index.hpp"
+#include "index_codecs.hpp"
+
+/**
+ * Read access to the documents of a forward index, independent of how the
+ * index is stored.
+ */
+class ForwardIndexReader {
+ public:
+  virtual ~ForwardIndexReader() = default;
+
+  /**
+   * Number of documents, including the unused document zero.
+   */
+  virtual size_t size() const = 0;
+
+  /**
+   * Fetch the document `docid`. Readers that keep documents in memory return
+   * a reference into the index, other readers fill and return `scratch`.
+   */
+  virtual const Document &get(size_t docid, Document &scratch) const = 0;
+
+  /**
+   * The codecs the documents were compressed with.
+   */
+  virtual const StreamCodecs &codecs() const {
+    return StreamCodecs::defaults();
+  }
+
+  /**
+   * Decode the document `docid` into `view`. Readers that store documents as
+   * blobs decode them in place, other readers decode what `get` returns.
+   */
+  virtual void decode(size_t docid, DocumentView &view,
+                      Document &scratch) const {
+    view.decode(get(docid, scratch), codecs());
+  }
+};
+
+/**
+ * A forward index that is fully deserialized into memory.
+ */
+class InMemoryForwardIndex : public ForwardIndexReader {
+  const ForwardIndex &fwdidx_;
+
+ public:
+  InMemoryForwardIndex(const ForwardIndex &fwdidx) : fwdidx_(fwdidx) {}
+
+  size_t size() const { return fwdidx_.size(); }
+
+  const Document &get(size_t docid, Document &) const {
+    return fwdidx_[docid];
+  }
+};
+
+/**
+ * Fetch a document from either a `ForwardIndex` or a `ForwardIndexReader`, for
+ * code that is templated on the forward index type.
+ */
+inline const Document &fetch_document(const ForwardIndex &fwdidx, size_t docid,
+                                      Document &) {
+  return fwdidx[docid];
+}
+
+inline const Document &fetch_document(const ForwardIndexReader &fwdidx,
+                                      size_t docid, Document &scratch) {
+  return fwdidx.get(docid, scratch);
+}
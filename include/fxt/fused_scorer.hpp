@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "fxt/features/bm25/bm25.hpp"
+#include "fxt/features/bose_einstein/be.hpp"
+#include "fxt/features/dfr/dfr.hpp"
+#include "fxt/features/dph/dph.hpp"
+#include "fxt/features/lmds/lm.hpp"
+#include "fxt/features/probability/prob.hpp"
+#include "fxt/features/tfidf/tfidf.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+
+/**
+ * Scores the term weighting families of one document in a single pass over
+ * the (term, slot, tf, len) entries of its `QueryTermFreqs`, rather than a
+ * pass over every term and field for each family.
+ *
+ * This is where the term weighting features are scored: the feature classes
+ * score their family with it, and the batch kernels skip the same fields.
+ */
+class FusedScorer {
+ public:
+  static constexpr size_t slots = QueryContext::num_fields + 1;
+  static_assert(slots == feature::family_size,
+                "the slots of a family are its members");
+
+  enum Kind { bm25, lm, tfidf, prob, be, dph, dfr };
+
+  /**
+   * A term weighting family, the members of it to score and the features
+   * its scores are written to.
+   */
+  struct Family {
+    Kind kind;
+    FamilyMask mask = all_members;
+    // The first feature of each family that the scores are written to, in
+    // order
+    std::vector<feature::Id> outputs;
+    // BM25
+    double k1 = 0.0;
+    double b = 0.0;
+    // LM with Dirichlet smoothing
+    double mu = 0.0;
+
+    static Family make(Kind kind) {
+      Family family;
+      family.kind = kind;
+      return family;
+    }
+
+    static Family make_bm25(double k1, double b) {
+      Family family = make(bm25);
+      family.k1 = k1;
+      family.b = b;
+      return family;
+    }
+
+    static Family make_lm(double mu) {
+      Family family = make(lm);
+      family.mu = mu;
+      return family;
+    }
+  };
+
+ private:
+  std::vector<Family> families_;
+  // Scores of `families_[i]` are `scores_[i * slots]`, one for each slot
+  std::vector<double> scores_;
+
+ public:
+  /**
+   * Whether the family of `kind` skips a field where the term has `stats`,
+   * since its scoring function is undefined there.
+   */
+  static bool skip_field(Kind kind, const QueryContext::TermStats &stats) {
+    switch (kind) {
+      case tfidf:
+      case be:
+      case dph:
+        return 0 == stats.term_count;
+      case dfr:
+        return 0 == stats.term_count || 0 == stats.document_count;
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * Score `family` as well, after the families added before it.
+   */
+  void add(const Family &family) {
+    families_.push_back(family);
+    scores_.resize(families_.size() * slots);
+  }
+
+  bool empty() const { return families_.empty(); }
+
+  /**
+   * The scores of the `i`th family added, one for each slot, as of the last
+   * call to `score`.
+   */
+  const double *scores(size_t i) const { return scores_.data() + i * slots; }
+
+  /**
+   * Score the families of the document of `freqs`, gathered for `ctx`, and
+   * write them to `row`. The members that are not scored are zero.
+   */
+  void score(const QueryContext &ctx, const QueryTermFreqs &freqs,
+             FeatureRow &row) {
+    score(ctx, freqs);
+    const double *score = scores_.data();
+    for (const auto &family : families_) {
+      for (feature::Id first : family.outputs) {
+        std::copy(score, score + slots, row.begin() + first);
+      }
+      score += slots;
+    }
+  }
+
+  /**
+   * Score the families of the document of `freqs` as above, but only keep
+   * the scores for `scores`.
+   */
+  void score(const QueryContext &ctx, const QueryTermFreqs &freqs) {
+    std::fill(scores_.begin(), scores_.end(), 0.0);
+    const double avg_dlen = ctx.avg_doc_len();
+    rank_bm25 ranker;
+    ranker.avg_doc_len = avg_dlen;
+
+    for (const auto &e : freqs.entries()) {
+      const auto &stats =
+          0 == e.slot ? ctx.stats(e.term) : ctx.field_stats(e.term, e.slot - 1);
+      double *score = scores_.data() + e.slot;
+      for (const auto &family : families_) {
+        if (!family.mask[e.slot] ||
+            (e.slot > 0 && skip_field(family.kind, stats))) {
+          score += slots;
+          continue;
+        }
+        switch (family.kind) {
+          case bm25:
+            ranker.set_k1(family.k1);
+            ranker.set_b(family.b);
+            *score += ranker.calculate_docscore(stats.bm25_w_qt, e.tf, e.len);
+            break;
+          case lm:
+            *score += calculate_lm(e.tf, stats.lm_coll_prob, e.len, family.mu);
+            break;
+          case tfidf:
+            *score += calculate_tfidf(e.tf, stats.tfidf_w_qt, e.len);
+            break;
+          case prob:
+            *score += calculate_prob(e.tf, e.len);
+            break;
+          case be:
+            *score += calculate_be(e.tf, stats.be, avg_dlen, e.len);
+            break;
+          case dph:
+            *score += calculate_dph(e.tf, stats.dph, avg_dlen, e.len);
+            break;
+          case dfr:
+            *score += calculate_dfr(e.tf, stats.dfr, stats.document_count,
+                                    avg_dlen, e.len);
+            break;
+        }
+        score += slots;
+      }
+    }
+  }
+};
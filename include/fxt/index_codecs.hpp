@@ -0,0 +1,311 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Document;
+
+namespace FastPForLib {
+class IntegerCODEC;
+}
+
+/**
+ * The integer streams of the forward and inverted index, each of which is
+ * compressed with its own codec.
+ */
+enum class IndexStream {
+  // Delta coded term ids of the unique terms of a document
+  unique_terms,
+  // Terms of a document, as indexes into its unique terms
+  terms,
+  // Document frequency of each unique term
+  freqs,
+  // Frequency of each unique term in a field, one stream per field
+  field_freqs,
+  // Delta coded docids of a posting list
+  posting_docs,
+  // Frequencies of a posting list
+  posting_freqs,
+};
+
+constexpr size_t num_index_streams = 6;
+
+inline const char *index_stream_name(IndexStream s) {
+  static const char *names[num_index_streams] = {
+      "unique_terms", "terms",        "freqs",
+      "field_freqs",  "posting_docs", "posting_freqs"};
+  return names[size_t(s)];
+}
+
+const char index_codecs_magic[8] = {'F', 'X', 'T', 'C', 'O', 'D', 'E', 'C'};
+const uint32_t index_codecs_version = 2;
+
+/**
+ * The names of the codecs that FastPFor offers.
+ */
+std::vector<std::string> codec_names();
+
+/**
+ * The codecs that keep no scratch state in their shared instance, so that
+ * threads can decode with them at the same time. Other codecs are used under
+ * a lock.
+ */
+bool is_stateless_codec(const std::string &name);
+
+/**
+ * The FastPFor codec of each `IndexStream`, by name.
+ *
+ * The choice is recorded in a header at the start of every index file that
+ * holds compressed streams, and the readers of those files decode with the
+ * recorded codecs, see `StreamCodecs`. A file without the header was written
+ * before codecs could be chosen, and uses the defaults.
+ *
+ * Version 2 stores the field frequencies of documents sparsely, see
+ * `Document`. Forward indexes without the header or with version 1 store
+ * them densely, which `dense_field_freqs` is set for.
+ *
+ * The header is laid out as
+ *
+ *     char magic[8]
+ *     uint32_t version
+ *     uint32_t num_streams
+ *     for each stream: uint32_t len, char name[len]
+ */
+struct IndexCodecs {
+  std::array<std::string, num_index_streams> names = {
+      "streamvbyte", "streamvbyte",     "streamvbyte",
+      "streamvbyte", "simdfastpfor256", "simdfastpfor256"};
+  // Documents have a field frequency for every unique term, and are
+  // converted with `Document::sparsify_field_freqs` as they are read
+  bool dense_field_freqs = false;
+
+  const std::string &operator[](IndexStream s) const {
+    return names[size_t(s)];
+  }
+  std::string &operator[](IndexStream s) { return names[size_t(s)]; }
+
+  bool operator==(const IndexCodecs &other) const {
+    return names == other.names &&
+           dense_field_freqs == other.dense_field_freqs;
+  }
+  bool operator!=(const IndexCodecs &other) const { return !(*this == other); }
+
+  /**
+   * Parse `stream=codec` and set the codec of that stream. Documents are
+   * decoded by many threads at once, so their streams only take stateless
+   * codecs, as in `choose_codecs`.
+   */
+  void set(const std::string &assignment) {
+    auto eq = assignment.find('=');
+    if (std::string::npos != eq) {
+      std::string stream = assignment.substr(0, eq);
+      std::string codec = assignment.substr(eq + 1);
+      for (size_t s = 0; s < num_index_streams; ++s) {
+        if (stream != index_stream_name(IndexStream(s))) {
+          continue;
+        }
+        if (s < size_t(IndexStream::posting_docs) &&
+            !is_stateless_codec(codec)) {
+          throw std::invalid_argument(
+              "document streams need a stateless codec, got: " + assignment);
+        }
+        names[s] = codec;
+        return;
+      }
+    }
+    throw std::invalid_argument("expected <stream>=<codec>, got: " +
+                                assignment);
+  }
+
+  void write_header(std::ostream &os) const {
+    os.write(index_codecs_magic, sizeof(index_codecs_magic));
+    write_u32(os, index_codecs_version);
+    write_u32(os, num_index_streams);
+    for (const auto &name : names) {
+      write_u32(os, name.size());
+      os.write(name.data(), name.size());
+    }
+  }
+
+  /**
+   * Read the header at the current position of `is`. If there is none, the
+   * position is left as it was and the default codecs are returned, with
+   * dense field frequencies.
+   */
+  static IndexCodecs read_header(std::istream &is) {
+    IndexCodecs codecs;
+    auto start = is.tellg();
+    char magic[sizeof(index_codecs_magic)];
+    if (!is.read(magic, sizeof(magic)) ||
+        0 != std::memcmp(magic, index_codecs_magic, sizeof(magic))) {
+      is.clear();
+      is.seekg(start);
+      codecs.dense_field_freqs = true;
+      return codecs;
+    }
+    uint32_t version = read_u32(is);
+    uint32_t num_streams = read_u32(is);
+    if (version < 1 || version > index_codecs_version ||
+        num_streams != num_index_streams) {
+      throw std::runtime_error("unsupported index codec header");
+    }
+    for (auto &name : codecs.names) {
+      name.resize(read_u32(is));
+      is.read(&name[0], name.size());
+    }
+    if (!is) {
+      throw std::runtime_error("truncated index codec header");
+    }
+    codecs.dense_field_freqs = version < 2;
+    return codecs;
+  }
+
+ private:
+  static void write_u32(std::ostream &os, uint32_t v) {
+    os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+
+  static uint32_t read_u32(std::istream &is) {
+    uint32_t v = 0;
+    is.read(reinterpret_cast<char *>(&v), sizeof(v));
+    return v;
+  }
+};
+
+/**
+ * The FastPFor codecs of an `IndexCodecs`, which the streams of documents and
+ * posting lists are encoded and decoded with.
+ *
+ * Each reader holds the codecs recorded in the header of its index and passes
+ * them on to what it decodes, so indexes with different codecs can be open
+ * side by side. The codecs are resolved once and never change, so they can be
+ * shared between threads. See `src/compression.cpp`.
+ */
+class StreamCodecs {
+  struct Codec {
+    FastPForLib::IntegerCODEC *codec = nullptr;
+    // Set for codecs that are not stateless
+    std::mutex *lock = nullptr;
+  };
+  IndexCodecs names_;
+  std::array<Codec, num_index_streams> codecs_;
+
+ public:
+  /**
+   * Resolve the codecs of `names`. Throws `std::invalid_argument` for a codec
+   * FastPFor does not have.
+   */
+  explicit StreamCodecs(const IndexCodecs &names = IndexCodecs());
+
+  const IndexCodecs &names() const { return names_; }
+
+  /**
+   * Encode the `n` integers at `in` into `out`, which is resized to fit.
+   */
+  void encode(IndexStream s, const uint32_t *in, size_t n,
+              std::vector<uint32_t> &out) const;
+
+  /**
+   * Decode the `len` words at `in` into `out`, which has room for `n`
+   * integers, and return the number of integers decoded.
+   */
+  size_t decode(IndexStream s, const uint32_t *in, size_t len, uint32_t *out,
+                size_t n) const;
+
+  /**
+   * The default codecs, for documents and posting lists that were not read
+   * from an index.
+   */
+  static const StreamCodecs &defaults();
+};
+
+/**
+ * How well a codec compresses a sample of a stream: its size in 32 bit words,
+ * and the time to decode it. A codec that does not decode the sample to what
+ * was encoded is not `ok`.
+ */
+struct CodecTrial {
+  std::string name;
+  bool ok = false;
+  size_t words = 0;
+  double decode_ns = 0;
+};
+
+/**
+ * Encode each of the `sample` arrays with the codec `name`, and time
+ * decoding them all, the fastest of `repeats` runs. See `src/compression.cpp`.
+ */
+CodecTrial trial_codec(const std::string &name,
+                       const std::vector<std::vector<uint32_t>> &sample,
+                       size_t repeats = 5);
+
+/**
+ * The fastest decoding of the `trials` whose size is at most `size_target`
+ * times the size of the smallest, or an empty name if none is `ok`.
+ */
+inline std::string choose_codec(const std::vector<CodecTrial> &trials,
+                                double size_target) {
+  size_t smallest = SIZE_MAX;
+  for (const auto &t : trials) {
+    if (t.ok && t.words < smallest) {
+      smallest = t.words;
+    }
+  }
+  const CodecTrial *best = nullptr;
+  for (const auto &t : trials) {
+    if (!t.ok || t.words > smallest * size_target) {
+      continue;
+    }
+    if (!best || t.decode_ns < best->decode_ns ||
+        (t.decode_ns == best->decode_ns && t.words < best->words)) {
+      best = &t;
+    }
+  }
+  return best ? best->name : std::string();
+}
+
+/**
+ * Arrays of each `IndexStream` sampled from a collection, before they are
+ * encoded. See `src/compression.cpp`.
+ */
+struct CodecSample {
+  std::array<std::vector<std::vector<uint32_t>>, num_index_streams> streams;
+
+  void add(IndexStream s, std::vector<uint32_t> values) {
+    if (!values.empty()) {
+      streams[size_t(s)].push_back(std::move(values));
+    }
+  }
+
+  /**
+   * Add the streams of an uncompressed document.
+   */
+  void add(Document doc);
+
+  /**
+   * Add the streams of a posting list of ascending `docs`.
+   */
+  void add(std::vector<uint32_t> docs, const std::vector<uint32_t> &freqs);
+};
+
+/**
+ * Choose the codec of each stream in `sample` with `choose_codec`. Document
+ * streams are decoded by many threads at once, so only stateless codecs are
+ * tried for them. Streams without a sample keep their default codec.
+ */
+IndexCodecs choose_codecs(const CodecSample &sample, double size_target);
@@ -8,13 +8,20 @@
 #pragma once
 
 #include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "cereal/archives/binary.hpp"
 #include "cereal/types/string.hpp"
 #include "cereal/types/vector.hpp"
 
+#include "index_codecs.hpp"
+
 /**
  * A decoded posting list that is returned from `PostingList`.
  */
@@ -55,10 +62,15 @@ class PostingList {
   // Posting entries
   std::vector<uint32_t> docs_;
   std::vector<uint32_t> freqs_;
+  // Codecs of the index the list belongs to, or the defaults if not set. They
+  // are recorded in the header of the index rather than in each list.
+  std::shared_ptr<const StreamCodecs> codecs_;
 
  public:
   PostingList() {}
-  PostingList(const std::string &t, uint32_t tc) : term_(t), term_count_(tc) {}
+  PostingList(const std::string &t, uint32_t tc,
+              std::shared_ptr<const StreamCodecs> codecs = nullptr)
+      : term_(t), term_count_(tc), codecs_(std::move(codecs)) {}
 
   std::string term() const { return term_; }
 
@@ -70,6 +82,17 @@ class PostingList {
 
   void coding_off() { coding_on_ = false; }
 
+  const StreamCodecs &codecs() const {
+    return codecs_ ? *codecs_ : StreamCodecs::defaults();
+  }
+
+  /**
+   * Code the list with `codecs` from now on.
+   */
+  void set_codecs(std::shared_ptr<const StreamCodecs> codecs) {
+    codecs_ = std::move(codecs);
+  }
+
   /**
    * Compress posting list. See `src/compression.cpp`.
    */
@@ -117,3 +140,29 @@ class PostingList {
 };
 
 using InvertedIndex = std::vector<PostingList>;
+
+/**
+ * Write `inv_idx` to `os` after a header of `codecs`, which its posting lists
+ * were compressed with.
+ */
+inline void write_inverted_index(
+    std::ostream &os, const InvertedIndex &inv_idx,
+    const StreamCodecs &codecs = StreamCodecs::defaults()) {
+  codecs.names().write_header(os);
+  cereal::BinaryOutputArchive archive(os);
+  archive(inv_idx);
+}
+
+/**
+ * Read an inverted index from `is`, whose posting lists share the codecs
+ * recorded in its header.
+ */
+inline void read_inverted_index(std::istream &is, InvertedIndex &inv_idx) {
+  auto codecs =
+      std::make_shared<const StreamCodecs>(IndexCodecs::read_header(is));
+  cereal::BinaryInputArchive archive(is);
+  archive(inv_idx);
+  for (auto &pl : inv_idx) {
+    pl.set_codecs(codecs);
+  }
+}
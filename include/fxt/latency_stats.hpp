@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * Latency statistics of the requests served by a long running process.
+ *
+ * The count, mean and maximum cover every request. Percentiles are computed
+ * over a window of the most recent requests so that memory use stays fixed.
+ */
+class LatencyStats {
+  std::mutex mutex_;
+  size_t window_;
+  std::vector<double> recent_;
+  size_t next_ = 0;
+  size_t count_ = 0;
+  double sum_ = 0.0;
+  double max_ = 0.0;
+
+ public:
+  struct Summary {
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+  };
+
+  explicit LatencyStats(size_t window = 10000) : window_(window) {
+    if (0 == window_) {
+      window_ = 1;
+    }
+    recent_.reserve(window_);
+  }
+
+  /**
+   * Record the latency of one request in milliseconds.
+   */
+  void record(double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (recent_.size() < window_) {
+      recent_.push_back(ms);
+    } else {
+      recent_[next_] = ms;
+    }
+    next_ = (next_ + 1) % window_;
+    ++count_;
+    sum_ += ms;
+    max_ = std::max(max_, ms);
+  }
+
+  Summary summary() {
+    std::vector<double> sorted;
+    Summary s;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sorted = recent_;
+      s.count = count_;
+      s.mean = count_ ? sum_ / count_ : 0.0;
+      s.max = max_;
+    }
+    if (sorted.empty()) {
+      return s;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) {
+      size_t idx = p * (sorted.size() - 1) + 0.5;
+      return sorted[idx];
+    };
+    s.p50 = percentile(0.50);
+    s.p90 = percentile(0.90);
+    s.p99 = percentile(0.99);
+    return s;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const LatencyStats::Summary &s) {
+  os << "requests: " << s.count << ", mean: " << s.mean
+     << " ms, p50: " << s.p50 << " ms, p90: " << s.p90
+     << " ms, p99: " << s.p99 << " ms, max: " << s.max << " ms";
+  return os;
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "document_blob.hpp"
+#include "document_view.hpp"
+#include "forward_index.hpp"
+#include "forward_index_reader.hpp"
+#include "index_codecs.hpp"
+
+/**
+ * The on-disk layout of a mapped forward index is
+ *
+ *     MappedForwardIndexHeader
+ *     IndexCodecs header, padded to 8 bytes
+ *     uint64_t offsets[num_docs + 1]
+ *     document blobs
+ *
+ * Files of version 1 stored dense field frequencies, see `IndexCodecs`, and
+ * are rejected, as are headers whose sections do not fit in the file.
+ * The blob of document `i` is the byte range `[offsets[i], offsets[i + 1])`
+ * relative to `data_pos`, see `DocumentBlob` for the layout of a blob.
+ */
+struct MappedForwardIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t codecs_len;
+  uint64_t num_docs;
+  uint64_t offsets_pos;
+  uint64_t data_pos;
+  uint64_t data_len;
+};
+
+const char mapped_forward_index_magic[8] = {'F', 'X', 'T', 'F',
+                                            'W', 'D', 'I', 'X'};
+const uint32_t mapped_forward_index_version = 2;
+
+/**
+ * Write a mapped forward index. Documents must be added in docid order,
+ * starting with the unused document zero.
+ */
+class MappedForwardIndexWriter {
+  std::ofstream os_;
+  uint64_t num_docs_;
+  std::vector<uint64_t> offsets_;
+  std::string codecs_;
+  std::string blob_;
+
+  uint64_t offsets_pos() const {
+    return sizeof(MappedForwardIndexHeader) + codecs_.size();
+  }
+
+  uint64_t data_pos() const {
+    return offsets_pos() + (num_docs_ + 1) * sizeof(uint64_t);
+  }
+
+ public:
+  /**
+   * Write the documents of a forward index that were compressed with
+   * `codecs` to `path`.
+   */
+  MappedForwardIndexWriter(const std::string &path, uint64_t num_docs,
+                           const IndexCodecs &codecs = IndexCodecs())
+      : os_(path, std::ios::binary), num_docs_(num_docs) {
+    if (!os_) {
+      throw std::runtime_error("Could not open file: " + path);
+    }
+    offsets_.reserve(num_docs + 1);
+    offsets_.push_back(0);
+    std::ostringstream oss;
+    codecs.write_header(oss);
+    codecs_ = oss.str();
+    codecs_.resize((codecs_.size() + 7) & ~size_t(7), '\0');
+    // The header and offset table are filled in by `finish`
+    std::string placeholder(sizeof(MappedForwardIndexHeader), '\0');
+    os_.write(placeholder.data(), placeholder.size());
+    os_.write(codecs_.data(), codecs_.size());
+    placeholder.assign(data_pos() - offsets_pos(), '\0');
+    os_.write(placeholder.data(), placeholder.size());
+  }
+
+  void add(const Document &doc) {
+    if (offsets_.size() > num_docs_) {
+      throw std::logic_error("Too many documents for mapped forward index");
+    }
+    DocumentBlob::write(doc, blob_);
+    os_.write(blob_.data(), blob_.size());
+    offsets_.push_back(offsets_.back() + blob_.size());
+  }
+
+  void finish() {
+    if (offsets_.size() != num_docs_ + 1) {
+      std::ostringstream oss;
+      oss << "Mapped forward index expects " << num_docs_ << " documents, got "
+          << offsets_.size() - 1;
+      throw std::logic_error(oss.str());
+    }
+
+    MappedForwardIndexHeader header;
+    std::memcpy(header.magic, mapped_forward_index_magic, sizeof(header.magic));
+    header.version = mapped_forward_index_version;
+    header.codecs_len = codecs_.size();
+    header.num_docs = num_docs_;
+    header.offsets_pos = offsets_pos();
+    header.data_pos = data_pos();
+    header.data_len = offsets_.back();
+
+    os_.seekp(0);
+    os_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os_.seekp(offsets_pos());
+    os_.write(reinterpret_cast<const char *>(offsets_.data()),
+              offsets_.size() * sizeof(uint64_t));
+    os_.flush();
+    if (!os_) {
+      throw std::runtime_error("Error writing mapped forward index");
+    }
+  }
+};
+
+/**
+ * A forward index that is memory mapped from disk.
+ *
+ * Opening the index only maps the file and checks its header, so startup time
+ * does not depend on the size of the collection. Documents are read from the
+ * mapping when they are fetched, and the pages are shared through the page
+ * cache between every process that maps the same file. Documents are decoded
+ * with the codecs recorded in its header.
+ */
+class MappedForwardIndex : public ForwardIndexReader {
+  const char *base_ = nullptr;
+  size_t len_ = 0;
+  const MappedForwardIndexHeader *header_ = nullptr;
+  const uint64_t *offsets_ = nullptr;
+  const char *data_ = nullptr;
+  StreamCodecs codecs_;
+
+  static std::runtime_error error(const std::string &path,
+                                  const std::string &msg) {
+    return std::runtime_error(path + ": " + msg);
+  }
+
+ public:
+  explicit MappedForwardIndex(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw error(path, std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      ::close(fd);
+      throw error(path, std::strerror(errno));
+    }
+    len_ = st.st_size;
+    if (len_ < sizeof(MappedForwardIndexHeader)) {
+      ::close(fd);
+      throw error(path, "not a mapped forward index");
+    }
+    void *addr = ::mmap(nullptr, len_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == addr) {
+      throw error(path, std::strerror(errno));
+    }
+    base_ = static_cast<const char *>(addr);
+    // Documents are fetched in run order, not docid order
+    ::madvise(addr, len_, MADV_RANDOM);
+
+    header_ = reinterpret_cast<const MappedForwardIndexHeader *>(base_);
+    auto fail = [&](const std::string &msg) {
+      ::munmap(addr, len_);
+      return error(path, msg);
+    };
+    const MappedForwardIndexHeader &h = *header_;
+    if (0 != std::memcmp(h.magic, mapped_forward_index_magic,
+                         sizeof(h.magic))) {
+      throw fail("not a mapped forward index");
+    }
+    if (h.version < 2 || h.version > mapped_forward_index_version) {
+      throw fail("unsupported mapped forward index version " +
+                 std::to_string(h.version) + ", write it again");
+    }
+    // Each section must lie inside the file, after the one before it. The
+    // checks are ordered so that none of them overflows.
+    uint64_t codecs_end = sizeof(MappedForwardIndexHeader) + h.codecs_len;
+    if (codecs_end > len_ || h.offsets_pos < codecs_end ||
+        0 != h.offsets_pos % sizeof(uint64_t) || h.offsets_pos > len_ ||
+        h.num_docs >= (len_ - h.offsets_pos) / sizeof(uint64_t) ||
+        h.data_pos < h.offsets_pos + (h.num_docs + 1) * sizeof(uint64_t) ||
+        0 != h.data_pos % sizeof(uint64_t) || h.data_pos > len_ ||
+        h.data_len > len_ - h.data_pos) {
+      throw fail("truncated or corrupt mapped forward index");
+    }
+    std::istringstream codecs(std::string(
+        base_ + sizeof(MappedForwardIndexHeader), h.codecs_len));
+    try {
+      codecs_ = StreamCodecs(IndexCodecs::read_header(codecs));
+    } catch (const std::exception &e) {
+      throw fail(e.what());
+    }
+    if (codecs_.names().dense_field_freqs) {
+      // Blobs are decoded in place, so they can not be converted
+      throw fail("dense field frequencies are not supported");
+    }
+    offsets_ = reinterpret_cast<const uint64_t *>(base_ + header_->offsets_pos);
+    data_ = base_ + header_->data_pos;
+  }
+
+  ~MappedForwardIndex() {
+    if (base_) {
+      ::munmap(const_cast<char *>(base_), len_);
+    }
+  }
+
+  MappedForwardIndex(const MappedForwardIndex &) = delete;
+  MappedForwardIndex &operator=(const MappedForwardIndex &) = delete;
+
+  /**
+   * Check whether the file at `path` starts with the mapped forward index
+   * magic, as opposed to a cereal archive of a `ForwardIndex`.
+   */
+  static bool is_mapped(const std::string &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    char magic[sizeof(mapped_forward_index_magic)];
+    if (!ifs.read(magic, sizeof(magic))) {
+      return false;
+    }
+    return 0 == std::memcmp(magic, mapped_forward_index_magic, sizeof(magic));
+  }
+
+  size_t size() const { return header_->num_docs; }
+
+  const StreamCodecs &codecs() const { return codecs_; }
+
+  const Document &get(size_t docid, Document &scratch) const {
+    if (docid >= size()) {
+      throw std::out_of_range("docid out of range: " + std::to_string(docid));
+    }
+    DocumentBlob(data_ + offsets_[docid]).read(docid, scratch);
+    return scratch;
+  }
+
+  void decode(size_t docid, DocumentView &view, Document &) const {
+    if (docid >= size()) {
+      throw std::out_of_range("docid out of range: " + std::to_string(docid));
+    }
+    view.decode(DocumentBlob(data_ + offsets_[docid]), docid, codecs_);
+  }
+};
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fxt/features/bm25/bm25.hpp"
+#include "fxt/features/bose_einstein/be.hpp"
+#include "fxt/features/dfr/dfr.hpp"
+#include "fxt/features/dph/dph.hpp"
+#include "fxt/features/lmds/lm.hpp"
+#include "fxt/features/tfidf/tfidf.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/lexicon.hpp"
+#include "fxt/query_train_file.hpp"
+
+/**
+ * Everything the features need to know about a query that does not depend on
+ * the document being scored, worked out once per query rather than for every
+ * candidate document.
+ *
+ * The query terms are resolved against the lexicon, and their collection
+ * statistics, for the whole document and for each scored field, are copied
+ * into one flat array along with the parts of each scoring function that only
+ * depend on them. Field ids are looked up once, when the context is created.
+ *
+ * A context is only read while documents are scored, so it can be shared by
+ * the threads working on the same query.
+ */
+class QueryContext {
+ public:
+  /**
+   * The fields that the term weighting features score on their own, in the
+   * order of their features in each family, see `FXT_QUERY_DOC_FEATURES`.
+   */
+  static constexpr size_t num_fields = 5;
+  inline static const std::array<std::string, num_fields> fields = {
+      "body", "title", "heading", "inlink", "a"};
+
+  /**
+   * The fields of the tag count features. Only the first
+   * `num_tag_query_fields` of them count query terms.
+   */
+  static constexpr size_t num_tag_fields = 7;
+  static constexpr size_t num_tag_query_fields = 4;
+  inline static const std::array<std::string, num_tag_fields> tag_fields = {
+      "title", "heading", "mainbody", "inlink", "applet", "object", "embed"};
+
+  /**
+   * A unique query term.
+   */
+  struct QueryTerm {
+    uint64_t id = 0;
+    // Frequency in the query
+    int q_ft = 0;
+    bool oov = false;
+  };
+
+  /**
+   * Collection statistics of a term in the whole collection or in a field,
+   * and the parts of the scoring functions that only depend on them. Zero for
+   * OOV terms and fields that are not indexed.
+   */
+  struct TermStats {
+    uint64_t document_count = 0;
+    uint64_t term_count = 0;
+    double bm25_w_qt = 0.0;
+    double lm_coll_prob = 0.0;
+    double tfidf_w_qt = 0.0;
+    be_term be;
+    double dph = 0.0;
+    dfr_term dfr;
+  };
+
+ private:
+  const Lexicon *lexicon_;
+  const query_train *query_ = nullptr;
+
+  uint64_t coll_len_ = 0;
+  uint64_t num_docs_ = 0;
+  double avg_doc_len_ = 0.0;
+  std::array<int, num_fields> field_ids_;
+  std::array<int, num_tag_fields> tag_field_ids_;
+
+  std::vector<QueryTerm> terms_;
+  // Stats of `terms_[t]` are `stats_[t * (num_fields + 1)]` for the whole
+  // document, followed by one for each of `fields`.
+  std::vector<TermStats> stats_;
+
+  static int find_field(const FieldIdMap &field_ids, const std::string &name) {
+    auto it = field_ids.find(name);
+    // Fields missing from the map are not indexed, as with
+    // `FieldIdMap::operator[]`
+    return it == field_ids.end() ? 0 : it->second;
+  }
+
+  TermStats term_stats(uint64_t document_count, uint64_t term_count,
+                       int q_ft) const {
+    rank_bm25 bm25;
+    bm25.num_docs = num_docs_;
+
+    TermStats stats;
+    stats.document_count = document_count;
+    stats.term_count = term_count;
+    stats.bm25_w_qt = bm25.calculate_query_weight(q_ft, document_count);
+    if (coll_len_ > 0) {
+      stats.lm_coll_prob = calculate_lm_term(term_count, coll_len_);
+    }
+    stats.tfidf_w_qt = calculate_tfidf_term(term_count, num_docs_);
+    stats.be = calculate_be_term(term_count, num_docs_);
+    stats.dph = calculate_dph_term(term_count, num_docs_);
+    stats.dfr = calculate_dfr_term(term_count, num_docs_);
+    return stats;
+  }
+
+ public:
+  QueryContext(const Lexicon &lexicon, const FieldIdMap &field_ids)
+      : lexicon_(&lexicon) {
+    coll_len_ = lexicon.term_count();
+    num_docs_ = lexicon.document_count();
+    avg_doc_len_ = (double)coll_len_ / num_docs_;
+    for (size_t f = 0; f < num_fields; ++f) {
+      field_ids_[f] = find_field(field_ids, fields[f]);
+    }
+    for (size_t f = 0; f < num_tag_fields; ++f) {
+      tag_field_ids_[f] = find_field(field_ids, tag_fields[f]);
+    }
+  }
+
+  QueryContext(const Lexicon &lexicon, const FieldIdMap &field_ids,
+               const query_train &qry)
+      : QueryContext(lexicon, field_ids) {
+    set_query(qry);
+  }
+
+  /**
+   * Resolve the terms of `qry`, which must outlive its use in this context.
+   */
+  void set_query(const query_train &qry) {
+    query_ = &qry;
+    terms_.clear();
+    stats_.clear();
+
+    // In the order of `q_ft`, so that scores are summed in the same order as
+    // when iterating the query directly
+    for (auto &q : qry.q_ft) {
+      QueryTerm term;
+      term.id = q.first;
+      term.q_ft = q.second;
+      term.oov = q.first == lexicon_->oov_term();
+      terms_.push_back(term);
+
+      if (term.oov) {
+        stats_.resize(stats_.size() + num_fields + 1);
+        continue;
+      }
+      const auto &lex_term = (*lexicon_)[term.id];
+      stats_.push_back(term_stats(lex_term.document_count(),
+                                  lex_term.term_count(), term.q_ft));
+      for (size_t f = 0; f < num_fields; ++f) {
+        if (field_ids_[f] < 1) {
+          stats_.emplace_back();
+          continue;
+        }
+        stats_.push_back(
+            term_stats(lex_term.field_document_count(field_ids_[f]),
+                       lex_term.field_term_count(field_ids_[f]), term.q_ft));
+      }
+    }
+  }
+
+  const query_train &query() const { return *query_; }
+  const Lexicon &lexicon() const { return *lexicon_; }
+
+  // Number of terms in the collection
+  uint64_t collection_length() const { return coll_len_; }
+  // Number of documents in the collection
+  uint64_t document_count() const { return num_docs_; }
+  double avg_doc_len() const { return avg_doc_len_; }
+
+  /**
+   * The id of `fields[f]`, less than `1` if it is not indexed.
+   */
+  int field_id(size_t f) const { return field_ids_[f]; }
+
+  /**
+   * The id of `tag_fields[f]`, less than `1` if it is not indexed.
+   */
+  int tag_field_id(size_t f) const { return tag_field_ids_[f]; }
+
+  /**
+   * The unique query terms, OOV terms included.
+   */
+  const std::vector<QueryTerm> &terms() const { return terms_; }
+
+  /**
+   * The index of term `id` in `terms()`, or `terms().size()` if it is not a
+   * query term.
+   */
+  size_t term_index(uint64_t id) const {
+    size_t t = 0;
+    while (t < terms_.size() && terms_[t].id != id) {
+      ++t;
+    }
+    return t;
+  }
+
+  /**
+   * The collection statistics of `terms()[t]`.
+   */
+  const TermStats &stats(size_t t) const {
+    return stats_[t * (num_fields + 1)];
+  }
+
+  /**
+   * The statistics of `terms()[t]` in `fields[f]`.
+   */
+  const TermStats &field_stats(size_t t, size_t f) const {
+    return stats_[t * (num_fields + 1) + 1 + f];
+  }
+};
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "fxt/document_view.hpp"
+#include "fxt/query_context.hpp"
+
+/**
+ * The frequencies of the query terms of a `QueryContext` in one document, in
+ * the whole document and in each of `QueryContext::fields`, along with the
+ * lengths of the fields.
+ *
+ * The term weighting features all score the same (term, field) pairs, so
+ * rather than each of them looking up every term in every field again, the
+ * lookups are done once per document by `gather` and the features read the
+ * results from a flat array. The buffer is kept between documents.
+ *
+ * The pairs that the term weighting features score are also listed in
+ * `entries`, so that `FusedScorer` can score all of the families in one pass
+ * over them.
+ */
+class QueryTermFreqs {
+  static constexpr size_t stride = QueryContext::num_fields + 1;
+
+ public:
+  /**
+   * A query term in slot `slot` of the document, the whole document
+   * followed by `QueryContext::fields`, with its frequency and the length of
+   * the slot.
+   */
+  struct Entry {
+    uint32_t term;
+    uint32_t slot;
+    uint32_t tf;
+    uint32_t len;
+  };
+
+ private:
+  uint32_t length_ = 0;
+  std::array<uint32_t, QueryContext::num_fields> field_len_ = {};
+  // Frequencies of `ctx.terms()[t]` are `freqs_[t * stride]` in the whole
+  // document, followed by one for each field
+  std::vector<uint32_t> freqs_;
+  // The frequencies of all the query terms in each slot
+  std::array<uint64_t, stride> tf_sums_ = {};
+  std::vector<Entry> entries_;
+
+ public:
+  /**
+   * Look up the query terms of `ctx` in `doc`. The frequencies are the same as
+   * `DocumentView::freq` gives, for every term and field, indexed or not.
+   */
+  void gather(const QueryContext &ctx, const DocumentView &doc) {
+    std::array<size_t, QueryContext::num_fields> field_slots;
+    length_ = doc.length();
+    for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+      field_slots[f] = doc.field_slot(ctx.field_id(f));
+      field_len_[f] = doc.field_len(ctx.field_id(f));
+    }
+
+    const auto &terms = ctx.terms();
+    freqs_.resize(terms.size() * stride);
+    tf_sums_.fill(0);
+    entries_.clear();
+    uint32_t *out = freqs_.data();
+    for (uint32_t t = 0; t < terms.size(); ++t) {
+      size_t slot = doc.term_slot(terms[t].id);
+      const uint32_t *term_freqs = out;
+      *out++ = doc.slot_freq(slot);
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        *out++ = doc.slot_freq(field_slots[f], slot);
+      }
+      for (size_t s = 0; s < stride; ++s) {
+        tf_sums_[s] += term_freqs[s];
+      }
+
+      // The term weighting features skip the fields of a term that is not in
+      // the document, and fields that are not indexed or are empty
+      if (terms[t].oov || 0 == term_freqs[0]) {
+        continue;
+      }
+      entries_.push_back({t, 0, term_freqs[0], length_});
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        if (ctx.field_id(f) < 1 || 0 == field_len_[f] ||
+            0 == term_freqs[1 + f]) {
+          continue;
+        }
+        entries_.push_back(
+            {t, uint32_t(1 + f), term_freqs[1 + f], field_len_[f]});
+      }
+    }
+  }
+
+  uint32_t length() const { return length_; }
+
+  /**
+   * The length of `QueryContext::fields[f]` in the document.
+   */
+  uint32_t field_len(size_t f) const { return field_len_[f]; }
+
+  /**
+   * The frequency of `ctx.terms()[t]` in the document.
+   */
+  uint32_t freq(size_t t) const { return freqs_[t * stride]; }
+
+  /**
+   * The frequency of `ctx.terms()[t]` in `QueryContext::fields[f]`.
+   */
+  uint32_t field_freq(size_t t, size_t f) const {
+    return freqs_[t * stride + 1 + f];
+  }
+
+  /**
+   * The sum of the frequencies of all the query terms in the document, and in
+   * `QueryContext::fields[f]`.
+   */
+  uint64_t tf_sum() const { return tf_sums_[0]; }
+  uint64_t field_tf_sum(size_t f) const { return tf_sums_[1 + f]; }
+
+  /**
+   * The (term, slot) pairs that the term weighting features score, by term in
+   * the order of `ctx.terms()` and then by slot.
+   */
+  const std::vector<Entry> &entries() const { return entries_; }
+};
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "fxt/query_train_file.hpp"
+#include "fxt/span.hpp"
+
+/**
+ * The positions of the query terms in the current document, for the features
+ * that look at term positions: proximity, TP-score and SDM.
+ *
+ * Only query term positions are ever read, so rather than indexing every term
+ * of a document, its terms are scanned once against a small hash table of the
+ * query terms. The positions of each query term end up contiguous in a single
+ * buffer. The buffers are kept between documents, so once they have grown to
+ * the size of the largest document no more memory is allocated.
+ *
+ * Usage is `set_query` once per query, then `build` for each document.
+ */
+class QueryTermPositions {
+ public:
+  /**
+   * An occurrence of query term `term` at position `pos` of the document.
+   */
+  struct Hit {
+    uint32_t term;
+    uint32_t slot;
+    uint32_t pos;
+  };
+
+ private:
+  static constexpr uint32_t empty_slot = UINT32_MAX;
+
+  // Unique query terms, in order of first occurrence in the query
+  std::vector<uint32_t> terms_;
+  // Open addressing table of slots in `terms_`, with a power of two size
+  std::vector<uint32_t> table_;
+  uint32_t shift_ = 32;
+
+  std::vector<Hit> hits_;
+  // Positions of `terms_[s]` are `positions_[offsets_[s]..offsets_[s + 1])`
+  std::vector<uint32_t> positions_;
+  std::vector<uint32_t> offsets_;
+  // Scratch for filling `positions_`
+  std::vector<uint32_t> cursor_;
+
+  size_t bucket(uint32_t term) const {
+    // Fibonacci hashing, the high bits of the product are the best mixed
+    return uint32_t(term * 2654435769U) >> shift_;
+  }
+
+ public:
+  QueryTermPositions() = default;
+
+  explicit QueryTermPositions(const query_train &qry) { set_query(qry); }
+
+  /**
+   * Set the terms to look for. Repeated terms are kept once, OOV terms are
+   * kept as they are, since the document may have terms with id `0` too.
+   */
+  void set_query(const query_train &qry) {
+    terms_.clear();
+    for (auto tid : qry.tids) {
+      uint32_t term = tid;
+      bool seen = false;
+      for (auto t : terms_) {
+        seen = seen || t == term;
+      }
+      if (!seen) {
+        terms_.push_back(term);
+      }
+    }
+
+    // At most a quarter full, so that most lookups miss on the first probe
+    size_t size = 4;
+    shift_ = 30;
+    while (size < 4 * terms_.size()) {
+      size <<= 1;
+      --shift_;
+    }
+    table_.assign(size, empty_slot);
+    for (uint32_t s = 0; s < terms_.size(); ++s) {
+      size_t b = bucket(terms_[s]);
+      while (empty_slot != table_[b]) {
+        b = (b + 1) & (size - 1);
+      }
+      table_[b] = s;
+    }
+    hits_.clear();
+    positions_.clear();
+    offsets_.assign(terms_.size() + 1, 0);
+  }
+
+  /**
+   * The slot of `term`, or `size()` if it is not a query term.
+   */
+  size_t slot(uint32_t term) const {
+    if (terms_.empty()) {
+      return 0;
+    }
+    size_t mask = table_.size() - 1;
+    for (size_t b = bucket(term); empty_slot != table_[b];
+         b = (b + 1) & mask) {
+      if (terms_[table_[b]] == term) {
+        return table_[b];
+      }
+    }
+    return terms_.size();
+  }
+
+  /**
+   * Collect the query term positions of the document with `terms`.
+   */
+  void build(Span<uint32_t> terms) {
+    hits_.clear();
+    offsets_.assign(terms_.size() + 1, 0);
+    if (terms_.empty()) {
+      positions_.clear();
+      return;
+    }
+
+    size_t mask = table_.size() - 1;
+    for (uint32_t pos = 0; pos < terms.size(); ++pos) {
+      uint32_t term = terms[pos];
+      for (size_t b = bucket(term); empty_slot != table_[b];
+           b = (b + 1) & mask) {
+        uint32_t s = table_[b];
+        if (terms_[s] == term) {
+          hits_.push_back({term, s, pos});
+          ++offsets_[s + 1];
+          break;
+        }
+      }
+    }
+
+    // Counting sort of the hits by slot, they stay in position order within
+    // each slot
+    for (size_t s = 0; s < terms_.size(); ++s) {
+      offsets_[s + 1] += offsets_[s];
+    }
+    positions_.resize(hits_.size());
+    cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+    for (const auto &hit : hits_) {
+      positions_[cursor_[hit.slot]++] = hit.pos;
+    }
+  }
+
+  /**
+   * The number of unique query terms.
+   */
+  size_t size() const { return terms_.size(); }
+
+  /**
+   * The positions of `term` in the document in increasing order. Empty if
+   * `term` is not in the document, or not a query term.
+   */
+  Span<uint32_t> positions(uint32_t term) const {
+    size_t s = slot(term);
+    if (s == terms_.size()) {
+      return {};
+    }
+    return {positions_.data() + offsets_[s], offsets_[s + 1] - offsets_[s]};
+  }
+
+  /**
+   * Every query term occurrence in the document, in position order.
+   */
+  const std::vector<Hit> &hits() const { return hits_; }
+};
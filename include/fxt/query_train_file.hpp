@@ -9,6 +9,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -31,45 +32,15 @@ struct query_train {
 };
 
 class query_train_file {
-  const unsigned int fields = 2;
+  static const unsigned int fields = 2;
   std::vector<query_train> rows;
   std::ifstream &ifs;
   Lexicon &lexicon;
 
   void parse() {
-    std::vector<std::string> parts;
     std::string line;
     while (std::getline(ifs, line, '\n')) {
-      std::istringstream iss(line);
-      std::string str;
-      while (std::getline(iss, str, ';')) {
-        parts.push_back(str);
-      }
-      if (fields != parts.size()) {
-        std::ostringstream oss;
-        oss << "Required fields is " << fields << ", but got " << parts.size();
-        throw std::logic_error(oss.str());
-      }
-
-      query_train row;
-      row.id = parts[0];
-
-      // query terms
-      int count = 0;
-      iss.clear();
-      iss.str(parts[1]);
-      while (iss >> str) {
-        std::string stem = str;
-        uint64_t term_id = lexicon.term(
-            stem);  // `Index::term` takes stemmed version of a term
-        row.stems.push_back(stem);
-        row.tids.push_back(term_id);
-        row.pos.push_back(count++);
-        row.q_ft[term_id] += 1;
-      }
-
-      rows.push_back(row);
-      parts.clear();
+      rows.push_back(parse_line(line, lexicon));
     }
   }
 
@@ -79,5 +50,42 @@ class query_train_file {
     parse();
   }
 
+  /**
+   * Parse a single `<query id>;<query terms>` line.
+   */
+  static query_train parse_line(const std::string &line,
+                                const Lexicon &lexicon) {
+    std::vector<std::string> parts;
+    std::istringstream iss(line);
+    std::string str;
+    while (std::getline(iss, str, ';')) {
+      parts.push_back(str);
+    }
+    if (fields != parts.size()) {
+      std::ostringstream oss;
+      oss << "Required fields is " << fields << ", but got " << parts.size();
+      throw std::logic_error(oss.str());
+    }
+
+    query_train row;
+    row.id = parts[0];
+
+    // query terms
+    int count = 0;
+    iss.clear();
+    iss.str(parts[1]);
+    while (iss >> str) {
+      std::string stem = str;
+      uint64_t term_id =
+          lexicon.term(stem);  // `Index::term` takes stemmed version of a term
+      row.stems.push_back(stem);
+      row.tids.push_back(term_id);
+      row.pos.push_back(count++);
+      row.q_ft[term_id] += 1;
+    }
+
+    return row;
+  }
+
   std::vector<query_train> &get_queries() { return rows; }
 };
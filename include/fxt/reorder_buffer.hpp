@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+
+/**
+ * Write blocks of output in sequence order when they are produced out of
+ * order by multiple threads.
+ *
+ * Each block is keyed by its position in the sequence. A block is held back
+ * until every block before it has been written, so the final output is the
+ * same as if the blocks were written serially.
+ *
+ * With a `window`, a producer calls `wait` before it starts on a position,
+ * so that at most `window` positions from the next one to write are in
+ * flight and fewer than `window` blocks are ever held back. Positions must
+ * then be started in order, or the producer of the next block may wait on
+ * itself.
+ */
+class ReorderBuffer {
+  std::ostream &os_;
+  const size_t window_;
+  std::mutex mutex_;
+  std::condition_variable advanced_;
+  size_t next_ = 0;
+  std::map<size_t, std::string> pending_;
+
+ public:
+  /**
+   * Write the blocks to `os`, holding back any number of them if `window` is
+   * zero.
+   */
+  explicit ReorderBuffer(std::ostream &os, size_t window = 0)
+      : os_(os), window_(window) {}
+
+  /**
+   * Block until position `pos` is within the window of the next block to
+   * write.
+   */
+  void wait(size_t pos) {
+    if (0 == window_) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    advanced_.wait(lock, [&]() { return pos < next_ + window_; });
+  }
+
+  /**
+   * Submit the block at sequence position `pos`, then write any blocks that
+   * are now in order.
+   */
+  void write(size_t pos, std::string &&block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace(pos, std::move(block));
+
+    size_t first = next_;
+    auto it = pending_.begin();
+    while (it != pending_.end() && it->first == next_) {
+      os_ << it->second;
+      it = pending_.erase(it);
+      ++next_;
+    }
+    if (next_ != first) {
+      advanced_.notify_all();
+    }
+  }
+
+  /**
+   * Number of blocks waiting on an earlier block.
+   */
+  size_t pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+  }
+};
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
+#include "forward_index.hpp"
+#include "forward_index_reader.hpp"
+#include "index_codecs.hpp"
+
+/**
+ * A forward index that holds only a selected set of documents, typically the
+ * candidates of a run file.
+ *
+ * The cereal archive is streamed one `Document` at a time and only the
+ * selected documents are kept, so memory use depends on the size of the
+ * selection rather than the collection. Reading stops at the last selected
+ * document. Loaded documents are found through a sorted vector of docids,
+ * with `docs_[i]` holding document `docids_[i]`.
+ */
+class SelectiveForwardIndex : public ForwardIndexReader {
+  size_t size_ = 0;
+  std::vector<size_t> docids_;
+  std::vector<Document> docs_;
+  StreamCodecs codecs_;
+
+ public:
+  /**
+   * Load the documents `docids` from the cereal archive of a `ForwardIndex`
+   * in `is`, which are decoded with the codecs recorded in its header.
+   * Docids past the end of the archive are ignored. Documents with dense
+   * field frequencies are converted to sparse ones.
+   */
+  SelectiveForwardIndex(std::istream &is, std::vector<size_t> docids)
+      : codecs_(IndexCodecs::read_header(is)) {
+    std::sort(docids.begin(), docids.end());
+    docids.erase(std::unique(docids.begin(), docids.end()), docids.end());
+
+    cereal::BinaryInputArchive archive(is);
+    // Same layout as `std::vector<Document>`, see `IndexerInteractor`.
+    archive(size_);
+
+    docids_.reserve(docids.size());
+    docs_.reserve(docids.size());
+    Document doc;
+    auto next = docids.begin();
+    for (size_t i = 0; i < size_ && next != docids.end(); ++i) {
+      archive(doc);
+      if (i == *next) {
+        if (codecs_.names().dense_field_freqs) {
+          doc.sparsify_field_freqs(codecs_);
+        }
+        docids_.push_back(i);
+        docs_.push_back(std::move(doc));
+        doc = Document();
+        ++next;
+      }
+    }
+  }
+
+  /**
+   * Number of documents in the archive, including those that were not loaded.
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * Number of documents that were loaded.
+   */
+  size_t loaded() const { return docs_.size(); }
+
+  const StreamCodecs &codecs() const { return codecs_; }
+
+  bool contains(size_t docid) const {
+    return std::binary_search(docids_.begin(), docids_.end(), docid);
+  }
+
+  const Document &get(size_t docid, Document &) const {
+    auto it = std::lower_bound(docids_.begin(), docids_.end(), docid);
+    if (it == docids_.end() || *it != docid) {
+      throw std::out_of_range("document not loaded: " + std::to_string(docid));
+    }
+    return docs_[std::distance(docids_.begin(), it)];
+  }
+};
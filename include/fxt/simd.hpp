@@ -0,0 +1,242 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+/**
+ * The instruction sets that the batch scoring kernels are built for. The
+ * kernels are compiled for each of them whatever the build flags, and the
+ * level is picked at run time, so one binary makes the most of any x86-64 CPU.
+ * Other architectures only have the scalar kernels.
+ */
+enum class SimdLevel { scalar, avx2, avx512 };
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define FXT_SIMD_X86 1
+#endif
+
+inline const char *simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::avx2:
+      return "avx2";
+    case SimdLevel::avx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+/**
+ * Parse a level name as given by `simd_level_name`, returns false if `name`
+ * is not one.
+ */
+inline bool parse_simd_level(const std::string &name, SimdLevel &level) {
+  for (auto l : {SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512}) {
+    if (name == simd_level_name(l)) {
+      level = l;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * The best level that this CPU supports.
+ */
+inline SimdLevel detect_simd_level() {
+#ifdef FXT_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::avx2;
+  }
+#endif
+  return SimdLevel::scalar;
+}
+
+inline bool simd_supported(SimdLevel level) {
+  return level <= detect_simd_level();
+}
+
+/**
+ * Vectors of doubles and floats, and of the integers of the same width, as GCC
+ * and Clang vector extensions. Code written with them is compiled for the
+ * instruction set of the function it is inlined into, so one kernel serves
+ * every level.
+ */
+typedef double simd_f64x4 __attribute__((vector_size(32)));
+typedef int64_t simd_i64x4 __attribute__((vector_size(32)));
+typedef double simd_f64x8 __attribute__((vector_size(64)));
+typedef int64_t simd_i64x8 __attribute__((vector_size(64)));
+typedef float simd_f32x8 __attribute__((vector_size(32)));
+typedef int32_t simd_i32x8 __attribute__((vector_size(32)));
+typedef float simd_f32x16 __attribute__((vector_size(64)));
+typedef int32_t simd_i32x16 __attribute__((vector_size(64)));
+
+#define FXT_ALWAYS_INLINE inline __attribute__((always_inline))
+
+// The helpers take their vectors by reference. They are always inlined into
+// kernels built for the instruction set of the vectors, but passing them by
+// value would still warn of the ABI of calls made without it.
+
+template <typename V>
+struct simd_traits;
+
+template <>
+struct simd_traits<simd_f64x4> {
+  using scalar = double;
+  using mask = simd_i64x4;
+  static constexpr size_t width = 4;
+};
+
+template <>
+struct simd_traits<simd_f64x8> {
+  using scalar = double;
+  using mask = simd_i64x8;
+  static constexpr size_t width = 8;
+};
+
+template <>
+struct simd_traits<simd_f32x8> {
+  using scalar = float;
+  using mask = simd_i32x8;
+  static constexpr size_t width = 8;
+};
+
+template <>
+struct simd_traits<simd_f32x16> {
+  using scalar = float;
+  using mask = simd_i32x16;
+  static constexpr size_t width = 16;
+};
+
+/**
+ * The vectors of `T` of the AVX2 and AVX-512 kernels.
+ */
+template <typename T>
+struct simd_vectors;
+
+template <>
+struct simd_vectors<double> {
+  using avx2 = simd_f64x4;
+  using avx512 = simd_f64x8;
+};
+
+template <>
+struct simd_vectors<float> {
+  using avx2 = simd_f32x8;
+  using avx512 = simd_f32x16;
+};
+
+/**
+ * The layout of an IEEE 754 `T`, for taking it apart in `simd_log`.
+ */
+template <typename T>
+struct simd_float_bits;
+
+template <>
+struct simd_float_bits<double> {
+  static constexpr int mantissa_bits = 52;
+  static constexpr int64_t exponent_mask = 0x7ff;
+  static constexpr int64_t exponent_bias = 1023;
+  static constexpr int64_t mantissa_mask = 0x000fffffffffffffLL;
+  static constexpr int64_t one = 0x3ff0000000000000LL;
+  static constexpr double min = DBL_MIN;
+  // Subnormals are multiplied by `2^subnormal_shift`
+  static constexpr int64_t subnormal_shift = 54;
+  static constexpr double subnormal_scale = 18014398509481984.0;
+};
+
+template <>
+struct simd_float_bits<float> {
+  static constexpr int mantissa_bits = 23;
+  static constexpr int32_t exponent_mask = 0xff;
+  static constexpr int32_t exponent_bias = 127;
+  static constexpr int32_t mantissa_mask = 0x007fffff;
+  static constexpr int32_t one = 0x3f800000;
+  static constexpr float min = FLT_MIN;
+  static constexpr int32_t subnormal_shift = 25;
+  static constexpr float subnormal_scale = 33554432.0f;
+};
+
+template <typename V, typename T>
+FXT_ALWAYS_INLINE void simd_load(V &v, const T *p) {
+  __builtin_memcpy(&v, p, sizeof(v));
+}
+
+template <typename V, typename T>
+FXT_ALWAYS_INLINE void simd_store(T *p, const V &v) {
+  __builtin_memcpy(p, &v, sizeof(v));
+}
+
+/**
+ * Replace each lane of `x` by its natural logarithm.
+ *
+ * `x` is split into `2^e * m` with `m` in `[sqrt(1/2), sqrt(2))`, and
+ * `log(m) = 2 atanh(s)` with `s = (m - 1) / (m + 1)` is summed as a series,
+ * which for `|s| < 0.172` is exact to well below a double's precision after
+ * eleven terms. Results are within a few ulp of `std::log`, and zero,
+ * negative, infinite, NaN and subnormal lanes give what `std::log` does.
+ * Float lanes sum the same series, which is more than they need.
+ */
+template <typename V>
+FXT_ALWAYS_INLINE void simd_log(V &x) {
+  using T = typename simd_traits<V>::scalar;
+  using I = typename simd_traits<V>::mask;
+  using bits_of = simd_float_bits<T>;
+  const T ln2_hi = 6.93147180369123816490e-01;
+  const T ln2_lo = 1.90821492927058770002e-10;
+  const V zero = {};
+
+  // Subnormals are scaled into the normal range first
+  I sub = x < bits_of::min;
+  V xs = sub ? x * bits_of::subnormal_scale : x;
+  I bits = (I)xs;
+  I e = ((bits >> bits_of::mantissa_bits) & bits_of::exponent_mask) -
+        bits_of::exponent_bias + (sub & -bits_of::subnormal_shift);
+  V m = (V)((bits & bits_of::mantissa_mask) | bits_of::one);
+  I big = m > T(M_SQRT2);
+  m = big ? m * T(0.5) : m;
+  e = e - big;
+
+  V f = m - T(1.0);
+  V s = f / (f + T(2.0));
+  V z = s * s;
+  V p = zero + T(1.0 / 21);
+  p = p * z + T(1.0 / 19);
+  p = p * z + T(1.0 / 17);
+  p = p * z + T(1.0 / 15);
+  p = p * z + T(1.0 / 13);
+  p = p * z + T(1.0 / 11);
+  p = p * z + T(1.0 / 9);
+  p = p * z + T(1.0 / 7);
+  p = p * z + T(1.0 / 5);
+  p = p * z + T(1.0 / 3);
+  V log_m = T(2.0) * s + T(2.0) * s * z * p;
+
+  V k = __builtin_convertvector(e, V);
+  V r = k * ln2_hi + (log_m + k * ln2_lo);
+
+  r = x == T(0.0) ? zero - T(HUGE_VAL) : r;
+  r = x == T(HUGE_VAL) ? x : r;
+  // Negative and NaN lanes
+  x = x >= T(0.0) ? r : zero + T(NAN);
+}
+
+template <typename V>
+FXT_ALWAYS_INLINE void simd_log2(V &x) {
+  using T = typename simd_traits<V>::scalar;
+  simd_log(x);
+  x *= T(M_LOG2E);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * A read-only view over a contiguous array that is owned elsewhere. This is a
+ * stand-in for `std::span` which is not available in C++17.
+ */
+template <typename T>
+class Span {
+  const T *data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  Span() = default;
+  Span(const T *data, size_t size) : data_(data), size_(size) {}
+  Span(const std::vector<T> &v) : data_(v.data()), size_(v.size()) {}
+
+  const T *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return 0 == size_; }
+
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+
+  const T &operator[](size_t i) const { return data_[i]; }
+};
@@ -10,6 +10,8 @@
 #include <cstdint>
 #include <iostream>
 
+#include "feature_row.hpp"
+
 /*
  * Static document features.
  */
@@ -29,10 +31,30 @@ struct statdoc_entry {
   double frac_td_text = 0;
   uint8_t is_wikipedia = 0;
 
+  /**
+   * Copy the features to their columns of `row`.
+   */
+  void store(FeatureRow &row) const {
+    row[feature::len] = len;
+    row[feature::title_len] = title_len;
+    row[feature::visterm_len] = visterm_len;
+    row[feature::url_len] = url_len;
+    row[feature::url_depth] = url_depth;
+    row[feature::avg_term_len] = avg_term_len;
+    row[feature::entropy] = entropy;
+    row[feature::stop_cover] = stop_cover;
+    row[feature::frac_stop] = frac_stop;
+    row[feature::frac_anchor_text] = frac_anchor_text;
+    row[feature::frac_vis_text] = frac_vis_text;
+    row[feature::frac_table_text] = frac_table_text;
+    row[feature::frac_td_text] = frac_td_text;
+    row[feature::is_wikipedia] = is_wikipedia;
+  }
+
   friend std::ostream &operator<<(std::ostream &os, const statdoc_entry &de);
 };
 
-std::ostream &operator<<(std::ostream &os, const statdoc_entry &de) {
+inline std::ostream &operator<<(std::ostream &os, const statdoc_entry &de) {
   os << "," << de.len;
   os << "," << de.title_len;
   os << "," << de.visterm_len;
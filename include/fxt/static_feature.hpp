@@ -27,9 +27,8 @@ class StaticFeature {
                 const double ent, const double sc, const double fs,
                 const double fat, const double fvt, const double ftab,
                 const double ftd, const uint8_t wiki) {
-    // Avoid using a constructor for `statdoc_entry` becuase we have a crude
-    // code genreation process for statdoc_entry_flag.hpp and
-    // doc_entry_flag.hpp. See script/feat2struct.sh.
+    // Avoid using a constructor for `statdoc_entry` so that it stays an
+    // aggregate.
     dentry.len = l;
     dentry.title_len = tl;
     dentry.visterm_len = vtl;
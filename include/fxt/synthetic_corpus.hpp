@@ -0,0 +1,432 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fxt/field_id.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/inverted_index.hpp"
+#include "fxt/lexicon.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/static_feature.hpp"
+
+/**
+ * Draw ranks in `[1, n]` with probability proportional to `1 / rank^s`.
+ */
+class ZipfDistribution {
+  std::vector<double> cdf_;
+
+ public:
+  ZipfDistribution(size_t n, double s) {
+    cdf_.reserve(n);
+    double sum = 0.0;
+    for (size_t k = 1; k <= n; ++k) {
+      sum += 1.0 / std::pow(k, s);
+      cdf_.push_back(sum);
+    }
+    for (auto &c : cdf_) {
+      c /= sum;
+    }
+  }
+
+  template <typename Generator>
+  size_t operator()(Generator &gen) const {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+    return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1) + 1;
+  }
+};
+
+/**
+ * SplitMix64, a small and fast uniform random bit generator. Unlike the
+ * `std::` engines it is cheap to seed, so every document can have its own
+ * generator and be generated again, in any order, from its docid alone.
+ */
+class SplitMix64 {
+  uint64_t state_;
+
+ public:
+  using result_type = uint64_t;
+
+  explicit SplitMix64(uint64_t seed) : state_(seed) {}
+  SplitMix64(uint64_t seed, uint64_t stream)
+      : state_(seed ^ (stream * 0xd1342543de82ef95ULL)) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  result_type operator()() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+};
+
+enum class LengthDistribution { uniform, lognormal, fixed };
+
+struct SyntheticCorpusOptions {
+  size_t num_docs = 1000;
+  // Mean document length
+  size_t doc_len = 500;
+  // `uniform` lengths vary by half of `doc_len` either way, `lognormal`
+  // lengths have a shape of `doc_len_sigma`
+  LengthDistribution length_dist = LengthDistribution::uniform;
+  double doc_len_sigma = 0.5;
+  size_t vocab_size = 20000;
+  // Exponent of the Zipfian term distribution
+  double zipf = 1.0;
+  uint32_t seed = 42;
+
+  // Field structure, see `SyntheticDocuments::extents`
+  size_t title_len = 8;
+  size_t headings = 4;
+  size_t heading_len = 4;
+  size_t anchors = 8;
+  size_t anchor_len = 3;
+  size_t inlink_len = 16;
+};
+
+/**
+ * Generate the documents of a synthetic collection one at a time.
+ *
+ * Term `i` is named `t<i>` and has term id `i`, terms are drawn from a
+ * Zipfian distribution so that low ids are the most frequent. Each document
+ * draws from its own generator, seeded by the collection seed and the docid,
+ * so a document is the same however many times, and in whatever order, it is
+ * generated. This lets `generate_synthetic_index` make several passes over a
+ * collection that is too large to hold in memory.
+ */
+class SyntheticDocuments {
+  SyntheticCorpusOptions opts_;
+  ZipfDistribution zipf_;
+
+  // The most frequent terms play the part of stopwords in the static features
+  static constexpr size_t num_stopwords = 100;
+
+  // Documents longer than this would overflow the 16 bit field lengths
+  static constexpr size_t max_doc_len = UINT16_MAX;
+
+  // Separate streams, so that the terms of a document do not depend on how
+  // its static features are drawn
+  enum Stream : uint64_t { terms_stream, static_stream, query_stream };
+
+  SplitMix64 generator(Stream stream, uint64_t id) const {
+    return SplitMix64(opts_.seed + (uint64_t(stream) << 32), id);
+  }
+
+ public:
+  struct Extent {
+    int field_id;
+    size_t begin;
+    size_t end;
+  };
+  using FieldFreqs =
+      std::map<uint16_t, std::unordered_map<uint32_t, uint32_t>>;
+
+  FieldIdMap field_ids = {{"body", 1},   {"title", 2},    {"heading", 3},
+                          {"inlink", 4}, {"a", 5},        {"mainbody", 6},
+                          {"applet", 7}, {"object", 8},   {"embed", 9}};
+
+  explicit SyntheticDocuments(const SyntheticCorpusOptions &opts)
+      : opts_(opts), zipf_(opts.vocab_size, opts.zipf) {}
+
+  const SyntheticCorpusOptions &options() const { return opts_; }
+
+  size_t size() const { return opts_.num_docs; }
+
+  std::string term(size_t id) const { return "t" + std::to_string(id); }
+
+  std::string docno(size_t docid) const {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "SYN-%09zu", docid);
+    return buf;
+  }
+
+  /**
+   * The field extents of a document of `len` terms. `body` and `mainbody`
+   * cover the whole document, the first terms are the `title`, `headings`
+   * short `heading` extents and `anchors` `a` extents are spread over the
+   * rest, and the last terms are the `inlink` text.
+   */
+  std::vector<Extent> extents(size_t len) const {
+    std::vector<Extent> ext;
+    ext.push_back({field_ids.at("body"), 0, len});
+    ext.push_back({field_ids.at("mainbody"), 0, len});
+    ext.push_back(
+        {field_ids.at("title"), 0, std::min<size_t>(len, opts_.title_len)});
+    if (opts_.headings && opts_.heading_len) {
+      size_t step = len / opts_.headings + 1;
+      for (size_t begin = 2 * opts_.title_len;
+           begin + opts_.heading_len <= len; begin += step) {
+        ext.push_back({field_ids.at("heading"), begin,
+                       begin + opts_.heading_len});
+      }
+    }
+    if (opts_.anchors && opts_.anchor_len) {
+      size_t step = len / opts_.anchors + 1;
+      for (size_t begin = 5 * opts_.title_len;
+           begin + opts_.anchor_len <= len; begin += step) {
+        ext.push_back({field_ids.at("a"), begin, begin + opts_.anchor_len});
+      }
+    }
+    if (opts_.inlink_len && len >= opts_.inlink_len + opts_.title_len) {
+      ext.push_back({field_ids.at("inlink"), len - opts_.inlink_len, len});
+    }
+    return ext;
+  }
+
+  /**
+   * The term ids of document `docid`.
+   */
+  std::vector<uint32_t> terms(size_t docid) const {
+    auto gen = generator(terms_stream, docid);
+    double mean = std::max<size_t>(1, opts_.doc_len);
+    size_t len = opts_.doc_len;
+    switch (opts_.length_dist) {
+      case LengthDistribution::uniform: {
+        size_t min_len = std::max<size_t>(1, opts_.doc_len - opts_.doc_len / 2);
+        len = std::uniform_int_distribution<size_t>(
+            min_len, opts_.doc_len + opts_.doc_len / 2)(gen);
+        break;
+      }
+      case LengthDistribution::lognormal: {
+        // Choose the location so that the mean length is `doc_len`
+        double sigma = opts_.doc_len_sigma;
+        double mu = std::log(mean) - sigma * sigma / 2;
+        len = std::lround(std::lognormal_distribution<double>(mu, sigma)(gen));
+        break;
+      }
+      case LengthDistribution::fixed:
+        break;
+    }
+    len = std::min(std::max<size_t>(len, 1), max_doc_len);
+
+    std::vector<uint32_t> terms(len);
+    for (auto &t : terms) {
+      t = zipf_(gen);
+    }
+    return terms;
+  }
+
+  /**
+   * Build document `docid` from its `terms`. If `field_freqs` is given, the
+   * frequency of each term in each field is added to it.
+   */
+  Document document(size_t docid, const std::vector<uint32_t> &terms,
+                    FieldFreqs *field_freqs = nullptr) const {
+    std::vector<uint16_t> fields;
+    for (const auto &f : field_ids) {
+      fields.push_back(f.second);
+    }
+
+    Document doc(docid);
+    doc.set_terms(terms);
+    doc.set_fields(fields);
+    FieldFreqs freqs;
+    for (const auto &e : extents(terms.size())) {
+      uint16_t e_len = e.end - e.begin;
+      doc.set_field_len(e.field_id, doc.field_len(e.field_id) + e_len);
+      // Widened first, the square of a long field overflows an `int`
+      doc.set_field_len_sum_sqrs(
+          e.field_id,
+          doc.field_len_sum_sqrs(e.field_id) + uint32_t(e_len) * e_len);
+      if (doc.field_max_len(e.field_id) < e_len) {
+        doc.set_field_max_len(e.field_id, e_len);
+      }
+      if (doc.field_min_len(e.field_id) > e_len) {
+        doc.set_field_min_len(e.field_id, e_len);
+      }
+      doc.set_tag_count(e.field_id, doc.tag_count(e.field_id) + 1);
+      for (size_t i = e.begin; i < e.end; ++i) {
+        freqs[e.field_id][terms[i]] += 1;
+      }
+    }
+    for (const auto &ff : freqs) {
+      doc.set_field_freqs(ff.first, ff.second);
+    }
+    if (field_freqs) {
+      for (const auto &ff : freqs) {
+        auto &out = (*field_freqs)[ff.first];
+        for (const auto &f : ff.second) {
+          out[f.first] += f.second;
+        }
+      }
+    }
+    return doc;
+  }
+
+  /**
+   * The static document features of document `docid`, computed from its
+   * `terms` as in `generate_static_doc_features`. The URL features and
+   * `is_wikipedia` have no counterpart in the terms and are drawn at random.
+   */
+  StaticFeature static_feature(size_t docid,
+                               const std::vector<uint32_t> &terms) const {
+    auto gen = generator(static_stream, docid);
+    statdoc_entry s;
+    size_t len = terms.size();
+    s.len = len;
+    s.visterm_len = len;
+
+    std::unordered_map<uint32_t, uint32_t> counts;
+    size_t stop = 0;
+    double term_len = 0.0;
+    for (auto t : terms) {
+      counts[t] += 1;
+      stop += t <= num_stopwords;
+      term_len += 1 + std::to_string(t).size();
+    }
+    if (len) {
+      s.avg_term_len = term_len / len;
+      s.stop_cover = double(stop) / len;
+    }
+    if (len > stop) {
+      s.frac_stop = double(stop) / double(len - stop);
+    }
+    for (const auto &c : counts) {
+      double p = c.second / double(len);
+      s.entropy += p * std::log(p);
+    }
+
+    size_t anchor_len = 0;
+    for (const auto &e : extents(len)) {
+      if (e.field_id == field_ids.at("title")) {
+        s.title_len += e.end - e.begin;
+      } else if (e.field_id == field_ids.at("a")) {
+        anchor_len += e.end - e.begin;
+      }
+    }
+    if (len) {
+      s.frac_anchor_text = double(anchor_len) / len;
+    }
+    // About six bytes of markup and text per indexed term
+    s.frac_vis_text =
+        1.0 / std::uniform_real_distribution<double>(4.0, 8.0)(gen);
+    s.url_depth = std::uniform_int_distribution<uint16_t>(0, 6)(gen);
+    s.url_len = 12 + s.url_depth * 8 +
+                std::uniform_int_distribution<uint16_t>(0, 40)(gen);
+    s.is_wikipedia = std::bernoulli_distribution(0.02)(gen);
+    return StaticFeature(s);
+  }
+
+  /**
+   * Query number `i` as a line of the query file, `<id>;<terms>`. Terms are
+   * drawn from the same distribution as the documents, without repeats.
+   */
+  std::string query_line(size_t i, size_t len, uint32_t seed) const {
+    SplitMix64 gen(uint64_t(seed) + (uint64_t(query_stream) << 32), i);
+    len = std::min(len, opts_.vocab_size);
+
+    std::vector<size_t> tids;
+    while (tids.size() < len) {
+      size_t t = zipf_(gen);
+      if (std::find(tids.begin(), tids.end(), t) == tids.end()) {
+        tids.push_back(t);
+      }
+    }
+    std::string line = std::to_string(i + 1) + ";";
+    for (size_t j = 0; j < tids.size(); ++j) {
+      line += (j ? " " : "") + term(tids[j]);
+    }
+    return line;
+  }
+};
+
+/**
+ * A randomly generated collection with a consistent lexicon, forward index and
+ * inverted index, for benchmarks and tests that need more, or larger,
+ * documents than the test fixture has. The documents are those of
+ * `SyntheticDocuments`, and as in `indexer`, document `0` is an empty padding
+ * document.
+ */
+class SyntheticCorpus {
+  SyntheticDocuments generator_;
+
+ public:
+  FieldIdMap field_ids;
+  Lexicon lexicon;
+  ForwardIndex documents;
+  InvertedIndex inverted_index;
+
+  explicit SyntheticCorpus(const SyntheticCorpusOptions &opts)
+      : generator_(opts), field_ids(generator_.field_ids) {
+    std::vector<Counts> term_counts(opts.vocab_size + 1);
+    std::vector<std::map<uint64_t, Counts>> field_counts(opts.vocab_size + 1);
+    std::vector<std::vector<uint32_t>> post_docs(opts.vocab_size + 1);
+    std::vector<std::vector<uint32_t>> post_freqs(opts.vocab_size + 1);
+    uint64_t total_terms = 0;
+
+    documents.reserve(opts.num_docs + 1);
+    documents.emplace_back(0);
+    for (size_t docid = 1; docid <= opts.num_docs; ++docid) {
+      auto terms = generator_.terms(docid);
+      SyntheticDocuments::FieldFreqs field_freqs;
+      Document doc = generator_.document(docid, terms, &field_freqs);
+      for (const auto &ff : field_freqs) {
+        for (const auto &f : ff.second) {
+          auto &fc = field_counts[f.first][ff.first];
+          fc.document_count += 1;
+          fc.term_count += f.second;
+        }
+      }
+
+      for (uint32_t t : doc.unique_terms()) {
+        uint32_t f = doc.freq(t);
+        term_counts[t].document_count += 1;
+        term_counts[t].term_count += f;
+        post_docs[t].push_back(docid);
+        post_freqs[t].push_back(f);
+      }
+      total_terms += terms.size();
+
+      doc.compress();
+      documents.push_back(doc);
+    }
+
+    lexicon = Lexicon(Counts(opts.num_docs, total_terms));
+    inverted_index.resize(opts.vocab_size + 1);
+    PostingList pl_oov(Lexicon::oov_str, Lexicon::oov_id);
+    pl_oov.coding_off();
+    inverted_index[Lexicon::oov_id] = pl_oov;
+    for (size_t t = 1; t <= opts.vocab_size; ++t) {
+      std::string term = generator_.term(t);
+      FieldCounts fc;
+      for (const auto &f : field_ids) {
+        fc[f.second] = field_counts[t][f.second];
+      }
+      lexicon.push_back(term, term_counts[t], fc);
+
+      PostingList pl(term, term_counts[t].term_count);
+      pl.set(post_docs[t], post_freqs[t]);
+      inverted_index[t] = pl;
+    }
+  }
+
+  /**
+   * Generate `n` queries of `len` terms, see `SyntheticDocuments::query_line`.
+   */
+  std::vector<query_train> queries(size_t n, size_t len,
+                                   uint32_t seed = 7) const {
+    std::vector<query_train> qrys;
+    for (size_t i = 0; i < n; ++i) {
+      qrys.push_back(query_train_file::parse_line(
+          generator_.query_line(i, len, seed), lexicon));
+    }
+    return qrys;
+  }
+};
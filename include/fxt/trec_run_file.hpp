@@ -96,7 +96,7 @@ class trec_run_file {
       return {};
     }
 
-    return results[id];
+    return it->second;
   }
 
   std::vector<int> get_labels(std::string id) {
@@ -106,7 +106,7 @@ class trec_run_file {
       return {};
     }
 
-    return labels[id];
+    return it->second;
   }
 
   std::vector<double> get_scores(std::string id) {
@@ -116,6 +116,105 @@ class trec_run_file {
       return {};
     }
 
-    return scores[id];
+    return it->second;
+  }
+};
+
+/**
+ * The run lines of a single query.
+ */
+struct trec_run_group {
+  std::string id;
+  std::vector<std::string> docnos;
+  std::vector<int> labels;
+  std::vector<double> scores;
+  // Query terms from the fields after the run identifier, if any.
+  std::string query;
+
+  void clear() {
+    id.clear();
+    docnos.clear();
+    labels.clear();
+    scores.clear();
+    query.clear();
+  }
+};
+
+/**
+ * Read a TREC run one query at a time, so that only the current query is held
+ * in memory. The lines of a query must be consecutive, which is the case for
+ * the output of most retrieval systems.
+ *
+ * Lines may have extra fields after the run identifier, which are taken to be
+ * the query terms. The terms are read from the first line of each query.
+ */
+class trec_run_stream {
+  const unsigned int fields = 6;
+  std::istream &is;
+  std::vector<std::string> parts;
+  // The first line of the next query, which was read to find the end of the
+  // current one.
+  bool have_next = false;
+
+  bool read_line() {
+    std::string line;
+    while (std::getline(is, line, '\n')) {
+      parts.clear();
+      std::istringstream iss(line);
+      std::string str;
+      while (iss >> str) {
+        parts.push_back(str);
+      }
+      if (parts.empty()) {
+        continue;
+      }
+      if (parts.size() < fields) {
+        std::ostringstream oss;
+        oss << "Required fields is " << fields << ", but got " << parts.size();
+        throw std::logic_error(oss.str());
+      }
+      return true;
+    }
+    return false;
+  }
+
+ public:
+  trec_run_stream(std::istream &input) : is(input) {}
+
+  /**
+   * Read the lines of the next query into `group`. Returns `false` at the end
+   * of the input.
+   */
+  bool next(trec_run_group &group) {
+    group.clear();
+    if (!have_next && !read_line()) {
+      return false;
+    }
+
+    group.id = parts[0];
+    for (size_t i = fields; i < parts.size(); ++i) {
+      if (i > fields) {
+        group.query += " ";
+      }
+      group.query += parts[i];
+    }
+
+    do {
+      if (parts[0] != group.id) {
+        have_next = true;
+        return true;
+      }
+      int rel_label = 0;
+      // Only try to read class label if Q is missing
+      if (parts[1].c_str()[0] != 'Q') {
+        rel_label = std::stol(parts[1]);  // Relevance label is in Q0 field
+      }
+      group.docnos.push_back(parts[2]);
+      group.labels.push_back(rel_label);
+      group.scores.push_back(std::stod(parts[4]));
+    } while (read_line());
+
+    have_next = false;
+    return true;
   }
 };
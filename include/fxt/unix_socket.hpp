@@ -0,0 +1,176 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+/**
+ * A `std::streambuf` over a connected socket, so that requests can be read
+ * with `std::getline` and responses written with `operator<<`.
+ */
+class FdStreamBuf : public std::streambuf {
+  int fd_;
+  char in_[4096];
+  char out_[4096];
+
+ protected:
+  int_type underflow() override {
+    ssize_t n;
+    do {
+      n = ::read(fd_, in_, sizeof(in_));
+    } while (n < 0 && EINTR == errno);
+    if (n <= 0) {
+      return traits_type::eof();
+    }
+    setg(in_, in_, in_ + n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  int_type overflow(int_type ch) override {
+    if (sync() < 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  int sync() override {
+    const char *p = pbase();
+    while (p < pptr()) {
+      // `MSG_NOSIGNAL` so that a client that went away does not raise
+      // `SIGPIPE`.
+      ssize_t n = ::send(fd_, p, pptr() - p, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (EINTR == errno) {
+          continue;
+        }
+        return -1;
+      }
+      p += n;
+    }
+    setp(out_, out_ + sizeof(out_) - 1);
+    return 0;
+  }
+
+ public:
+  explicit FdStreamBuf(int fd) : fd_(fd) {
+    setg(in_, in_, in_);
+    setp(out_, out_ + sizeof(out_) - 1);
+  }
+
+  ~FdStreamBuf() { sync(); }
+
+  FdStreamBuf(const FdStreamBuf &) = delete;
+  FdStreamBuf &operator=(const FdStreamBuf &) = delete;
+};
+
+inline sockaddr_un unix_socket_address(const std::string &path) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error("Socket path too long: " + path);
+  }
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  return addr;
+}
+
+/**
+ * A listening Unix domain socket. A stale socket file at `path` is replaced,
+ * and the file is removed again when the server is destroyed.
+ *
+ * `accept` may be called from several threads at once.
+ */
+class UnixSocketServer {
+  std::string path_;
+  int fd_ = -1;
+
+  std::runtime_error error(const std::string &what) const {
+    return std::runtime_error(what + " " + path_ + ": " + std::strerror(errno));
+  }
+
+ public:
+  explicit UnixSocketServer(const std::string &path, int backlog = 64)
+      : path_(path) {
+    sockaddr_un addr = unix_socket_address(path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+      throw error("Could not create socket");
+    }
+    ::unlink(path_.c_str());
+    if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+      ::close(fd_);
+      throw error("Could not bind socket");
+    }
+    if (::listen(fd_, backlog) < 0) {
+      ::close(fd_);
+      ::unlink(path_.c_str());
+      throw error("Could not listen on socket");
+    }
+  }
+
+  ~UnixSocketServer() {
+    ::close(fd_);
+    ::unlink(path_.c_str());
+  }
+
+  UnixSocketServer(const UnixSocketServer &) = delete;
+  UnixSocketServer &operator=(const UnixSocketServer &) = delete;
+
+  const std::string &path() const { return path_; }
+
+  /**
+   * Wait for the next client. Returns the connected socket, or `-1` once the
+   * server has been shut down.
+   */
+  int accept() {
+    while (true) {
+      int client = ::accept(fd_, nullptr, nullptr);
+      if (client >= 0) {
+        return client;
+      }
+      if (EINTR != errno && ECONNABORTED != errno) {
+        return -1;
+      }
+    }
+  }
+
+  /**
+   * Stop accepting clients and wake every thread blocked in `accept`.
+   */
+  void shutdown() { ::shutdown(fd_, SHUT_RDWR); }
+};
+
+/**
+ * Connect to the Unix domain socket at `path`.
+ */
+inline int unix_socket_connect(const std::string &path) {
+  sockaddr_un addr = unix_socket_address(path);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Could not create socket: " +
+                             std::string(std::strerror(errno)));
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    ::close(fd);
+    throw std::runtime_error("Could not connect to " + path + ": " +
+                             std::strerror(errno));
+  }
+  return fd;
+}
@@ -26,11 +26,13 @@ awk 'BEGIN {
     print "static_doc_file = gov2.static"
     print
 }
-$1 ~ /bool/ {
-    printf "; Enable/disable feature %s\n", $2
-    printf "%s = 1\n", $2
+/^ +X\([a-z0-9_]+\)/ {
+    name = $0
+    sub(/^ +X\(/, "f_", name)
+    sub(/\).*/, "", name)
+    printf "; Enable/disable feature %s\n", name
+    printf "%s = 1\n", name
     print ""
 }
 END {
-}' $BASE/include/fxt/doc_entry_flag.hpp \
-   $BASE/include/fxt/statdoc_entry_flag.hpp
+}' $BASE/include/fxt/feature_row.hpp
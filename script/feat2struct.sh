@@ -1,48 +0,0 @@
-#!/bin/bash
-
-set -e
-
-SPATH="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
-BASE=$SPATH/..
-CLANGFMT=clang-format
-
-if [ ! $(which $CLANGFMT) ]; then
-    echo "error: $CLANGFMT not found" 1>&2
-    exit 1
-fi
-
-for f in $BASE/include/fxt/{doc_entry,statdoc_entry}.hpp; do
-header=$(basename ${f%.hpp})_flag
-awk '/^struct\s+(doc_entry|statdoc_entry)\s+{/ {
-    foo = 1
-    next
-} /^\s+(size_t|double|int|uint[[:digit:]]+_t)/ {
-    if (foo == 1) {
-        print $0
-    }
-} /^}/ {
-    if (foo == 1) {
-        foo = 0
-    }
-}' $f \
-    | awk -v type=$header 'BEGIN {
-print "/*"
-print " * Copyright " strftime("%Y") " The Fxt authors."
-print " *"
-print " * For the full copyright and license information, please view the LICENSE file"
-print " * that was distributed with this source code."
-print " */"
-print
-print "/*"
-print " * This file is automatically generated."
-print " */"
-print
-print "#pragma once"
-print
-print "struct " type " {"
-}
-{ print "bool f_" $2 " = false;"}
-END {
-print "};"
-}' | $CLANGFMT -style=file > $BASE/include/fxt/${header}.hpp
-done
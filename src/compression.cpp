@@ -5,7 +5,20 @@
  * that was distributed with this source code.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include "fxt/document_blob.hpp"
+#include "fxt/document_view.hpp"
 #include "fxt/forward_index.hpp"
+#include "fxt/index_codecs.hpp"
 #include "fxt/inverted_index.hpp"
 
 #include "FastPFor/headers/codecfactory.h"
@@ -13,14 +26,244 @@
 
 using namespace FastPForLib;
 namespace {
-IntegerCODEC &document_codec = *CODECFactory::getFromName("streamvbyte");
-IntegerCODEC &posting_codec = *CODECFactory::getFromName("simdfastpfor256");
+bool is_codec(const std::string &name) {
+  auto names = CODECFactory::allNames();
+  return names.end() != std::find(names.begin(), names.end(), name);
+}
+
+// FastPFor shares one instance of each codec between every thread of the
+// process. Codecs such as `simdfastpfor256` keep scratch buffers inside the
+// instance, so they are only used under the lock of their instance. Posting
+// lists are only coded once per query, so a lock is cheaper than a codec per
+// thread.
+std::mutex &codec_mutex(const IntegerCODEC *codec) {
+  static std::mutex mutexes_lock;
+  static std::map<const IntegerCODEC *, std::unique_ptr<std::mutex>> mutexes;
+  std::lock_guard<std::mutex> lock(mutexes_lock);
+  auto &m = mutexes[codec];
+  if (!m) {
+    m.reset(new std::mutex());
+  }
+  return *m;
+}
+
+std::unique_lock<std::mutex> guard(std::mutex *lock) {
+  if (lock) {
+    return std::unique_lock<std::mutex>(*lock);
+  }
+  return std::unique_lock<std::mutex>();
+}
+
+// Encode the sparse field frequencies `ff` of an uncompressed document into
+// `out`, see `Document`.
+void encode_field_freqs(const StreamCodecs &codecs,
+                        const std::vector<uint32_t> &ff,
+                        std::vector<uint32_t> &out) {
+  size_t n = ff.size() / 2;
+  out.clear();
+  if (0 == n) {
+    return;
+  }
+  std::vector<uint32_t> idx(ff.begin(), ff.begin() + n);
+  Delta::deltaSIMD(idx.data(), idx.size());
+  std::vector<uint32_t> buffer;
+  codecs.encode(IndexStream::field_freqs, idx.data(), n, buffer);
+  out.push_back(n);
+  out.push_back(buffer.size());
+  out.insert(out.end(), buffer.begin(), buffer.end());
+  codecs.encode(IndexStream::field_freqs, ff.data() + n, n, buffer);
+  out.insert(out.end(), buffer.begin(), buffer.end());
+}
+
+// Decode the compressed sparse field frequencies `ff` into the indexes of
+// their terms and their frequencies.
+void decode_field_freqs(const StreamCodecs &codecs, Span<uint32_t> ff,
+                        std::vector<uint32_t> &idx,
+                        std::vector<uint32_t> &freqs) {
+  if (ff.size() < 2) {
+    idx.clear();
+    freqs.clear();
+    return;
+  }
+  size_t n = ff[0];
+  size_t idx_len = ff[1];
+  const uint32_t *in = ff.data() + 2;
+  idx.resize(n);
+  idx.resize(codecs.decode(IndexStream::field_freqs, in, idx_len, idx.data(),
+                           n));
+  Delta::inverseDeltaSIMD(idx.data(), idx.size());
+  freqs.resize(n);
+  freqs.resize(codecs.decode(IndexStream::field_freqs, in + idx_len,
+                             ff.size() - 2 - idx_len, freqs.data(), n));
+}
 };  // namespace
 
+std::vector<std::string> codec_names() { return CODECFactory::allNames(); }
+
+bool is_stateless_codec(const std::string &name) {
+  static const std::set<std::string> stateless = {
+      "copy",        "varint",        "vbyte",        "maskedvbyte",
+      "streamvbyte", "varintgb",      "binarypacking", "simdbinarypacking"};
+  return stateless.count(name);
+}
+
+StreamCodecs::StreamCodecs(const IndexCodecs &names) : names_(names) {
+  for (size_t s = 0; s < num_index_streams; ++s) {
+    const std::string &name = names.names[s];
+    if (!is_codec(name)) {
+      throw std::invalid_argument("unknown codec: " + name);
+    }
+    codecs_[s].codec = CODECFactory::getFromName(name).get();
+    if (!is_stateless_codec(name)) {
+      codecs_[s].lock = &codec_mutex(codecs_[s].codec);
+    }
+  }
+}
+
+void StreamCodecs::encode(IndexStream s, const uint32_t *in, size_t n,
+                          std::vector<uint32_t> &out) const {
+  const Codec &c = codecs_[size_t(s)];
+  out.resize(2 * n + 1024);
+  size_t compressedsize = out.size();
+  auto lock = guard(c.lock);
+  c.codec->encodeArray(in, n, out.data(), compressedsize);
+  out.resize(compressedsize);
+}
+
+size_t StreamCodecs::decode(IndexStream s, const uint32_t *in, size_t len,
+                            uint32_t *out, size_t n) const {
+  const Codec &c = codecs_[size_t(s)];
+  size_t recoveredsize = n;
+  auto lock = guard(c.lock);
+  c.codec->decodeArray(in, len, out, recoveredsize);
+  return recoveredsize;
+}
+
+const StreamCodecs &StreamCodecs::defaults() {
+  static const StreamCodecs codecs;
+  return codecs;
+}
+
+/**
+ * Try a codec on a sample of a stream, see `IndexCodecs`.
+ */
+CodecTrial trial_codec(const std::string &name,
+                       const std::vector<std::vector<uint32_t>> &sample,
+                       size_t repeats) {
+  using clock = std::chrono::steady_clock;
+  CodecTrial trial;
+  trial.name = name;
+  if (!is_codec(name)) {
+    return trial;
+  }
+  IntegerCODEC &codec = *CODECFactory::getFromName(name);
+
+  std::vector<std::vector<uint32_t>> encoded(sample.size());
+  size_t max_len = 0;
+  try {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      encoded[i].resize(2 * sample[i].size() + 1024);
+      size_t compressedsize = encoded[i].size();
+      codec.encodeArray(sample[i].data(), sample[i].size(), encoded[i].data(),
+                        compressedsize);
+      encoded[i].resize(compressedsize);
+      trial.words += compressedsize;
+      max_len = std::max(max_len, sample[i].size());
+    }
+    std::vector<uint32_t> out(max_len + 1024);
+    for (size_t i = 0; i < sample.size(); ++i) {
+      size_t recoveredsize = out.size();
+      codec.decodeArray(encoded[i].data(), encoded[i].size(), out.data(),
+                        recoveredsize);
+      if (recoveredsize != sample[i].size() ||
+          !std::equal(sample[i].begin(), sample[i].end(), out.begin())) {
+        return trial;
+      }
+    }
+
+    double best = std::numeric_limits<double>::max();
+    for (size_t r = 0; r < repeats; ++r) {
+      auto start = clock::now();
+      for (size_t i = 0; i < sample.size(); ++i) {
+        size_t recoveredsize = out.size();
+        codec.decodeArray(encoded[i].data(), encoded[i].size(), out.data(),
+                          recoveredsize);
+      }
+      std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+    trial.decode_ns = best;
+  } catch (const std::exception &) {
+    // FastPFor codecs throw for inputs they can not code
+    return trial;
+  }
+  trial.ok = true;
+  return trial;
+}
+
+/**
+ * Add the streams of an uncompressed document, as `Document::compress` would
+ * encode them.
+ */
+void CodecSample::add(Document doc) {
+  if (doc.terms().empty()) {
+    return;
+  }
+  doc.remap_local();
+  std::vector<uint32_t> unique_terms = doc.unique_terms();
+  Delta::deltaSIMD(unique_terms.data(), unique_terms.size());
+  add(IndexStream::unique_terms, std::move(unique_terms));
+  add(IndexStream::terms, doc.terms());
+  add(IndexStream::freqs, doc.freqs());
+  for (const auto &ff : doc.field_freqs()) {
+    size_t n = ff.size() / 2;
+    std::vector<uint32_t> idx(ff.begin(), ff.begin() + n);
+    Delta::deltaSIMD(idx.data(), idx.size());
+    add(IndexStream::field_freqs, std::move(idx));
+    add(IndexStream::field_freqs, {ff.begin() + n, ff.end()});
+  }
+}
+
+/**
+ * Add the streams of a posting list, as `PostingList::encode` would encode
+ * them.
+ */
+void CodecSample::add(std::vector<uint32_t> docs,
+                      const std::vector<uint32_t> &freqs) {
+  Delta::deltaSIMD(docs.data(), docs.size());
+  add(IndexStream::posting_docs, std::move(docs));
+  add(IndexStream::posting_freqs, freqs);
+}
+
+/**
+ * Try every candidate codec on each sampled stream, see `IndexCodecs`.
+ */
+IndexCodecs choose_codecs(const CodecSample &sample, double size_target) {
+  IndexCodecs codecs;
+  for (size_t s = 0; s < num_index_streams; ++s) {
+    const auto &arrays = sample.streams[s];
+    if (arrays.empty()) {
+      continue;
+    }
+    bool posting = s >= size_t(IndexStream::posting_docs);
+    std::vector<CodecTrial> trials;
+    for (const auto &name : codec_names()) {
+      if (posting || is_stateless_codec(name)) {
+        trials.push_back(trial_codec(name, arrays));
+      }
+    }
+    std::string best = choose_codec(trials, size_target);
+    if (!best.empty()) {
+      codecs.names[s] = best;
+    }
+  }
+  return codecs;
+}
+
 /**
  * Compress document representation.
  */
-void Document::compress() {
+void Document::compress(const StreamCodecs &codecs) {
   m_num_terms = m_terms.size();
   if (0 == m_num_terms) {
     return;
@@ -28,90 +271,213 @@ void Document::compress() {
 
   remap_local();
 
-  {
-    std::vector<uint32_t> buffer(m_num_terms * 2 + 1024);
-    size_t compressedsize = m_unique_terms.size();
-    Delta::deltaSIMD(m_unique_terms.data(), m_unique_terms.size());
-    document_codec.encodeArray(m_unique_terms.data(), m_unique_terms.size(),
-                               buffer.data(), compressedsize);
-    buffer.resize(compressedsize);
-    m_unique_terms = buffer;
-  }
-  {
-    std::vector<uint32_t> buffer(m_num_terms);
-    size_t compressedsize = m_terms.size();
-    document_codec.encodeArray(m_terms.data(), m_terms.size(), buffer.data(),
-                               compressedsize);
-    buffer.resize(compressedsize);
-    m_terms = buffer;
-  }
-  {
-    std::vector<uint32_t> buffer(m_num_terms);
-    size_t compressedsize = m_unique_terms.size();
-    document_codec.encodeArray(m_freqs.data(), m_freqs.size(), buffer.data(),
-                               compressedsize);
-    buffer.resize(compressedsize);
-    m_freqs = buffer;
-  }
-  {
-    for (auto &&ff : m_field_freqs) {
-      std::vector<uint32_t> buffer(m_num_terms);
-      size_t compressedsize = ff.size();
-      document_codec.encodeArray(ff.data(), ff.size(), buffer.data(),
-                                 compressedsize);
-      buffer.resize(compressedsize);
-      ff = buffer;
-    }
+  std::vector<uint32_t> buffer;
+  Delta::deltaSIMD(m_unique_terms.data(), m_unique_terms.size());
+  codecs.encode(IndexStream::unique_terms, m_unique_terms.data(),
+                m_unique_terms.size(), buffer);
+  m_unique_terms = buffer;
+  codecs.encode(IndexStream::terms, m_terms.data(), m_terms.size(), buffer);
+  m_terms = buffer;
+  codecs.encode(IndexStream::freqs, m_freqs.data(), m_freqs.size(), buffer);
+  m_freqs = buffer;
+  for (auto &&ff : m_field_freqs) {
+    encode_field_freqs(codecs, ff, buffer);
+    ff = buffer;
   }
 }
 
 /**
  * Decompress document representation.
  */
-void Document::decompress() {
+void Document::decompress(const StreamCodecs &codecs) {
   if (0 == m_num_terms) {
     return;
   }
 
   {
     std::vector<uint32_t> terms(m_num_terms);
-    size_t recoveredsize = terms.size();
-    document_codec.decodeArray(m_unique_terms.data(), m_unique_terms.size(),
-                               terms.data(), recoveredsize);
-    terms.resize(recoveredsize);
+    terms.resize(codecs.decode(IndexStream::unique_terms,
+                               m_unique_terms.data(), m_unique_terms.size(),
+                               terms.data(), terms.size()));
     Delta::inverseDeltaSIMD(terms.data(), terms.size());
     m_unique_terms = terms;
   }
   {
     std::vector<uint32_t> terms(m_num_terms);
-    size_t recoveredsize = terms.size();
-    document_codec.decodeArray(m_terms.data(), m_terms.size(), terms.data(),
-                               recoveredsize);
-    terms.resize(recoveredsize);
+    terms.resize(codecs.decode(IndexStream::terms, m_terms.data(),
+                               m_terms.size(), terms.data(), terms.size()));
     m_terms = terms;
   }
   {
     std::vector<uint32_t> freqs(m_num_terms);
-    size_t recoveredsize = freqs.size();
-    document_codec.decodeArray(m_freqs.data(), m_freqs.size(), freqs.data(),
-                               recoveredsize);
-    freqs.resize(recoveredsize);
+    freqs.resize(codecs.decode(IndexStream::freqs, m_freqs.data(),
+                               m_freqs.size(), freqs.data(), freqs.size()));
     m_freqs = freqs;
   }
   {
+    std::vector<uint32_t> idx;
+    std::vector<uint32_t> freqs;
     for (auto &&ff : m_field_freqs) {
-      std::vector<uint32_t> freqs(m_num_terms);
-      size_t recoveredsize = freqs.size();
-      document_codec.decodeArray(ff.data(), ff.size(), freqs.data(),
-                                 recoveredsize);
-      freqs.resize(recoveredsize);
-      ff = freqs;
+      decode_field_freqs(codecs, ff, idx, freqs);
+      ff = idx;
+      ff.insert(ff.end(), freqs.begin(), freqs.end());
     }
   }
 
   remap_global();
 }
 
+/**
+ * Decode the dense field frequencies of a document, one for every unique
+ * term, and store the ones that are not zero in the sparse layout.
+ */
+void Document::sparsify_field_freqs(const StreamCodecs &codecs) {
+  std::vector<uint32_t> dense;
+  std::vector<uint32_t> sparse;
+  for (auto &&ff : m_field_freqs) {
+    if (0 == m_num_terms) {
+      dense = ff;
+    } else {
+      dense.resize(m_num_terms);
+      dense.resize(codecs.decode(IndexStream::field_freqs, ff.data(),
+                                 ff.size(), dense.data(), dense.size()));
+    }
+    sparse.clear();
+    for (size_t i = 0; i < dense.size(); ++i) {
+      if (0 != dense[i]) {
+        sparse.push_back(i);
+      }
+    }
+    size_t n = sparse.size();
+    for (size_t i = 0; i < n; ++i) {
+      sparse.push_back(dense[sparse[i]]);
+    }
+    if (0 == m_num_terms) {
+      ff = sparse;
+    } else {
+      encode_field_freqs(codecs, sparse, ff);
+    }
+  }
+}
+
+/**
+ * Decode the streams of a document that the plan of the view asks for into
+ * its scratch buffers.
+ */
+void DocumentView::decode(const Document &doc, const StreamCodecs &codecs) {
+  id_ = doc.id();
+  fields_ = doc.fields();
+  doc_slots_ = &doc.m_slots;
+
+  decode_streams(codecs, doc.m_num_terms, doc.m_unique_terms, doc.m_terms,
+                 doc.m_freqs);
+  field_terms_.resize(doc.m_field_freqs.size());
+  field_tfs_.resize(doc.m_field_freqs.size());
+  for (size_t i = 0; i < field_terms_.size(); ++i) {
+    if (plan_.has_field(fields_[i])) {
+      decode_field(codecs, doc.m_num_terms, i, doc.m_field_freqs[i]);
+    } else {
+      field_terms_[i].clear();
+      field_tfs_[i].clear();
+    }
+  }
+  remap_terms(doc.m_num_terms);
+}
+
+/**
+ * Decode a document blob into the scratch buffers of the view. The field
+ * slots of the blob are indexed into `blob_slots_`, which also reuses its
+ * buffers.
+ */
+void DocumentView::decode(const DocumentBlob &blob, size_t docid,
+                          const StreamCodecs &codecs) {
+  id_ = docid;
+  fields_ = blob.fields();
+  doc_slots_ = nullptr;
+  blob_slots_.assign(fields_.data(), fields_.size());
+  for (const auto &f : blob.field_stats()) {
+    blob_slots_.set_stats(f.field_id, f.stats());
+  }
+
+  decode_streams(codecs, blob.num_terms(), blob.unique_terms(), blob.terms(),
+                 blob.freqs());
+  auto lens = blob.field_freqs_len();
+  const uint32_t *ff = blob.field_freqs();
+  field_terms_.resize(lens.size());
+  field_tfs_.resize(lens.size());
+  for (size_t i = 0; i < lens.size(); ++i) {
+    if (plan_.has_field(fields_[i])) {
+      decode_field(codecs, blob.num_terms(), i, {ff, lens[i]});
+    } else {
+      field_terms_[i].clear();
+      field_tfs_[i].clear();
+    }
+    ff += lens[i];
+  }
+  remap_terms(blob.num_terms());
+}
+
+void DocumentView::decode_streams(const StreamCodecs &codecs,
+                                  size_t num_terms,
+                                  Span<uint32_t> unique_terms,
+                                  Span<uint32_t> terms, Span<uint32_t> freqs) {
+  terms_.clear();
+  freqs_.clear();
+  if (0 == num_terms) {
+    // Not compressed, see `Document::decompress`.
+    length_ = terms.size();
+    unique_terms_.assign(unique_terms.begin(), unique_terms.end());
+    if (plan_.terms) {
+      terms_.assign(terms.begin(), terms.end());
+    }
+    if (plan_.freqs) {
+      freqs_.assign(freqs.begin(), freqs.end());
+    }
+    return;
+  }
+
+  length_ = num_terms;
+  unique_terms_.resize(num_terms);
+  unique_terms_.resize(codecs.decode(
+      IndexStream::unique_terms, unique_terms.data(), unique_terms.size(),
+      unique_terms_.data(), unique_terms_.size()));
+  Delta::inverseDeltaSIMD(unique_terms_.data(), unique_terms_.size());
+  if (plan_.terms) {
+    terms_.resize(num_terms);
+    terms_.resize(codecs.decode(IndexStream::terms, terms.data(),
+                                terms.size(), terms_.data(), terms_.size()));
+  }
+  if (plan_.freqs) {
+    freqs_.resize(num_terms);
+    freqs_.resize(codecs.decode(IndexStream::freqs, freqs.data(),
+                                freqs.size(), freqs_.data(), freqs_.size()));
+  }
+}
+
+void DocumentView::decode_field(const StreamCodecs &codecs, size_t num_terms,
+                                size_t slot, Span<uint32_t> ff) {
+  if (0 == num_terms) {
+    size_t n = ff.size() / 2;
+    field_terms_[slot].assign(ff.begin(), ff.begin() + n);
+    field_tfs_[slot].assign(ff.begin() + n, ff.end());
+    return;
+  }
+  decode_field_freqs(codecs, ff, field_terms_[slot], field_tfs_[slot]);
+}
+
+/**
+ * Map the local term ids back into the global corpus space, see
+ * `Document::remap_global`.
+ */
+void DocumentView::remap_terms(size_t num_terms) {
+  if (0 == num_terms) {
+    return;
+  }
+  for (auto &t : terms_) {
+    t = unique_terms_[t];
+  }
+}
+
 /**
  * Compress posting list representation.
  */
@@ -120,21 +486,11 @@ void PostingList::encode(std::vector<uint32_t> &doc,
   assert(doc.size() == frequency.size());
 
   length_ = doc.size();
-  docs_.clear();
-  freqs_.clear();
-  docs_.resize(length_ * 2);
-  freqs_.resize(length_ * 2);
-
-  size_t docs_size = docs_.size();
   Delta::deltaSIMD(doc.data(), doc.size());
-  posting_codec.encodeArray(doc.data(), doc.size(), docs_.data(), docs_size);
-  docs_.resize(docs_size);
+  codecs().encode(IndexStream::posting_docs, doc.data(), doc.size(), docs_);
   docs_.shrink_to_fit();
-
-  size_t freqs_size = freqs_.size();
-  posting_codec.encodeArray(frequency.data(), frequency.size(), freqs_.data(),
-                            freqs_size);
-  freqs_.resize(freqs_size);
+  codecs().encode(IndexStream::posting_freqs, frequency.data(),
+                  frequency.size(), freqs_);
   freqs_.shrink_to_fit();
 }
 
@@ -143,15 +499,13 @@ void PostingList::encode(std::vector<uint32_t> &doc,
  */
 void PostingList::decode(std::vector<uint32_t> &doc,
                          std::vector<uint32_t> &frequency) {
-  size_t doc_size = length_;
-  doc.resize(doc_size);
-  posting_codec.decodeArray(docs_.data(), docs_.size(), doc.data(), doc_size);
-  doc.resize(doc_size);
+  doc.resize(length_);
+  doc.resize(codecs().decode(IndexStream::posting_docs, docs_.data(),
+                             docs_.size(), doc.data(), doc.size()));
   Delta::inverseDeltaSIMD(doc.data(), doc.size());
 
-  size_t frequency_size = length_;
-  frequency.resize(frequency_size);
-  posting_codec.decodeArray(freqs_.data(), freqs_.size(), frequency.data(),
-                            frequency_size);
-  frequency.resize(frequency_size);
+  frequency.resize(length_);
+  frequency.resize(codecs().decode(IndexStream::posting_freqs,
+                                   freqs_.data(), freqs_.size(),
+                                   frequency.data(), frequency.size()));
 }
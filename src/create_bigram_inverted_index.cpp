@@ -64,7 +64,6 @@ int main(int argc, char *argv[]) {
   //!< prepare the output file
 
   std::ofstream os(output_file, std::ios::binary);
-  cereal::BinaryOutputArchive archive(os);
 
   InvertedIndex inv_idx;
 
@@ -191,7 +190,7 @@ int main(int argc, char *argv[]) {
     }
     w_scanner.set_wsize(w_size);
   }
-  archive(inv_idx);
+  write_inverted_index(os, inv_idx);
   return 0;
 }
 
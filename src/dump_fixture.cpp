@@ -132,10 +132,16 @@ int main(int argc, char** argv) {
 
   std::cerr << "Loading " << fwdpath << "..." << std::endl;
   auto start = clock::now();
-  std::ifstream ifs_fwd(fwdpath);
+  std::ifstream ifs_fwd(fwdpath, std::ios::binary);
+  StreamCodecs codecs(IndexCodecs::read_header(ifs_fwd));
   cereal::BinaryInputArchive iarchive_fwd(ifs_fwd);
   ForwardIndex fwd_idx;
   iarchive_fwd(fwd_idx);
+  if (codecs.names().dense_field_freqs) {
+    for (auto &doc : fwd_idx) {
+      doc.sparsify_field_freqs(codecs);
+    }
+  }
 
   auto stop = clock::now();
   auto load_time =
@@ -158,10 +164,9 @@ int main(int argc, char** argv) {
 
   std::cerr << "Loading " << invpath << "..." << std::endl;
   start = clock::now();
-  std::ifstream invidx_f(invpath);
-  cereal::BinaryInputArchive iarchive_inv(invidx_f);
+  std::ifstream invidx_f(invpath, std::ios::binary);
   InvertedIndex inv_idx;
-  iarchive_inv(inv_idx);
+  read_inverted_index(invidx_f, inv_idx);
 
   stop = clock::now();
   load_time =
@@ -183,7 +188,7 @@ int main(int argc, char** argv) {
   std::cout << "ForwardIndex stub_forward_index() {" << std::endl;
   std::cout << "ForwardIndex forward_index;" << std::endl;
   for (size_t i = 0; i < fwd_idx.size(); ++i) {
-    fwd_idx[i].decompress();
+    fwd_idx[i].decompress(codecs);
     dump_doc(fwd_idx[i], i);
   }
   std::cout << "return forward_index;" << std::endl;
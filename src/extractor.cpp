@@ -5,34 +5,126 @@
  * that was distributed with this source code.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "CLI/CLI.hpp"
 #include "cereal/archives/binary.hpp"
+#include "cereal/types/map.hpp"
 #include "indri/QueryEnvironment.hpp"
 
-#include "fxt/doc_entry.hpp"
-#include "fxt/doc_entry_flag.hpp"
+#include "fxt/arena_forward_index.hpp"
+#include "fxt/batch_scorer.hpp"
+#include "fxt/docno_store.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/extract_profile.hpp"
+#include "fxt/extract_stats.hpp"
 #include "fxt/statdoc_entry.hpp"
-#include "fxt/statdoc_entry_flag.hpp"
 
 #include "fxt/feature_extractor.hpp"
 #include "fxt/feature_presenter.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/feature_writer.hpp"
 #include "fxt/features/features.hpp"
 #include "fxt/field_id.hpp"
+#include "fxt/fork_join_pool.hpp"
 #include "fxt/forward_index.hpp"
+#include "fxt/forward_index_reader.hpp"
 #include "fxt/inverted_index.hpp"
+#include "fxt/latency_stats.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/mapped_forward_index.hpp"
 #include "fxt/query_environment_adapter.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_positions.hpp"
 #include "fxt/query_train_file.hpp"
+#include "fxt/reorder_buffer.hpp"
+#include "fxt/selective_forward_index.hpp"
+#include "fxt/simd.hpp"
 #include "fxt/static_feature.hpp"
 #include "fxt/trec_run_file.hpp"
+#include "fxt/unix_socket.hpp"
+
+/*
+ * Per-thread extraction state. The indexes and the `QueryContext` of the
+ * current query are shared read-only between threads, but the feature classes
+ * keep scratch state between documents and query contexts, so each thread
+ * gets its own.
+ */
+struct ExtractorWorker {
+  FeatureExtractor fe;
+  // SDM requires different data structures than the other features, therefore
+  // it is currently setup here.
+  //
+  // FIXME: Move this to a logical place.
+  Sdm sdm;
+  DocSdmFeature f_sdm;
+  // Scratch buffers for fetching and decoding the current document, and for
+  // the positions of the current query's terms in it.
+  Document doc;
+  DocumentView doc_view;
+  QueryTermPositions positions;
+  // The features of the current document, and with `--float` the same
+  // rounded to single precision for the output
+  FeatureRow row;
+  FloatFeatureRow float_row;
+  // The documents of the current batch, with `--batch`. Each has its own
+  // scratch `Document`, since readers that fill the scratch document leave
+  // the view pointing into it.
+  std::vector<Document> batch_docs;
+  std::vector<DocumentView> batch_views;
+  std::vector<FeatureRow> batch_rows;
+  // Stage timings of the current query, null unless profiling.
+  std::unique_ptr<ExtractProfile> profile;
+
+  ExtractorWorker(const FeatureFlags &feature_flags, bool profiling)
+      : fe(feature_flags), f_sdm(sdm) {
+    if (profiling) {
+      profile.reset(new ExtractProfile());
+      fe.set_profile(profile.get());
+    }
+  }
+};
+
+/**
+ * A worker for each document thread of a query, and the threads that run them,
+ * which are started once and reused for every query.
+ */
+struct WorkerSet {
+  std::vector<std::unique_ptr<ExtractorWorker>> workers;
+  std::unique_ptr<ForkJoinPool> pool;
+};
+
+// A query is only split between document threads when each chunk has at least
+// this many candidates.
+static const size_t doc_chunk_min_len = 64;
+// Chunks per document thread, so that a thread that finishes early can pick up
+// more work.
+static const size_t doc_chunks_per_thread = 4;
+
+/**
+ * The candidate documents of one query, in run order.
+ */
+struct Candidates {
+  std::vector<std::string> docnos;
+  std::vector<int> labels;
+  std::vector<double> stage0_scores;
+  std::vector<docid_t> docids;
+};
 
 /*
  * Perform feature extraction.
@@ -43,25 +135,44 @@ int main(int argc, char **argv) {
   std::string output_file;
 
   std::string indri_index;
+  std::string docno_file;
+  std::string field_id_file;
   std::string fwd_index_file;
   std::string inv_index_file;
   std::string lexicon_file;
   std::string static_doc_file;
+  size_t threads = 1;
+  size_t doc_threads = 1;
+  bool selective_load = false;
+  std::string serve_socket;
+  bool stream = false;
+  bool inline_query = false;
+  bool async_output = false;
+  std::string profile_file;
+  std::string stats_file;
+  bool batch = false;
+  std::string simd;
+  bool single_precision = false;
+  bool binary = false;
 
   CLI::App app;
   app.add_option("query_file", query_file, "Query file")
-      ->required()
       ->check(CLI::ExistingFile);
   app.add_option("trec_file", trec_file, "TREC run file")
-      ->required()
       ->check(CLI::ExistingFile);
-  app.add_option("output_file", output_file, "Output file")->required();
+  app.add_option("output_file", output_file, "Output file");
 
-  app.add_option("--indri_index", indri_index, "Path to an Indri index")
-      ->required()
+  app.add_option("--indri_index", indri_index,
+                 "Path to an Indri index, not needed with --docnos and "
+                 "--field_ids")
       ->check(CLI::ExistingDirectory);
+  app.add_option("--docnos", docno_file, "Path to a docno store file")
+      ->check(CLI::ExistingFile);
+  app.add_option("--field_ids", field_id_file, "Path to a field id file")
+      ->check(CLI::ExistingFile);
   app.add_option("--forward_index", fwd_index_file,
-                 "Path to a forward index file")
+                 "Path to a forward index file, either a cereal archive or a "
+                 "mapped forward index")
       ->required()
       ->check(CLI::ExistingFile);
   app.add_option("--inverted_index", inv_index_file,
@@ -75,462 +186,164 @@ int main(int argc, char **argv) {
                  "Path to a static document feature file")
       ->required()
       ->check(CLI::ExistingFile);
-
-  /* The following flags for enabling features is automatically generated. */
-  struct doc_entry_flag query_doc_flags;
-  struct statdoc_entry_flag static_doc_flags;
-  app.add_flag("--f_stage0_score", query_doc_flags.f_stage0_score,
-               "Enable feature f_stage0_score")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire", query_doc_flags.f_bm25_atire,
-               "Enable feature f_bm25_atire")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire_body", query_doc_flags.f_bm25_atire_body,
-               "Enable feature f_bm25_atire_body")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire_title", query_doc_flags.f_bm25_atire_title,
-               "Enable feature f_bm25_atire_title")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire_heading", query_doc_flags.f_bm25_atire_heading,
-               "Enable feature f_bm25_atire_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire_inlink", query_doc_flags.f_bm25_atire_inlink,
-               "Enable feature f_bm25_atire_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_atire_a", query_doc_flags.f_bm25_atire_a,
-               "Enable feature f_bm25_atire_a")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3", query_doc_flags.f_bm25_trec3,
-               "Enable feature f_bm25_trec3")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_body", query_doc_flags.f_bm25_trec3_body,
-               "Enable feature f_bm25_trec3_body")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_title", query_doc_flags.f_bm25_trec3_title,
-               "Enable feature f_bm25_trec3_title")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_heading", query_doc_flags.f_bm25_trec3_heading,
-               "Enable feature f_bm25_trec3_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_inlink", query_doc_flags.f_bm25_trec3_inlink,
-               "Enable feature f_bm25_trec3_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_a", query_doc_flags.f_bm25_trec3_a,
-               "Enable feature f_bm25_trec3_a")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax", query_doc_flags.f_bm25_trec3_kmax,
-               "Enable feature f_bm25_trec3_kmax")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax_body",
-               query_doc_flags.f_bm25_trec3_kmax_body,
-               "Enable feature f_bm25_trec3_kmax_body")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax_title",
-               query_doc_flags.f_bm25_trec3_kmax_title,
-               "Enable feature f_bm25_trec3_kmax_title")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax_heading",
-               query_doc_flags.f_bm25_trec3_kmax_heading,
-               "Enable feature f_bm25_trec3_kmax_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax_inlink",
-               query_doc_flags.f_bm25_trec3_kmax_inlink,
-               "Enable feature f_bm25_trec3_kmax_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_trec3_kmax_a", query_doc_flags.f_bm25_trec3_kmax_a,
-               "Enable feature f_bm25_trec3_kmax_a")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500", query_doc_flags.f_lm_dir_2500,
-               "Enable feature f_lm_dir_2500")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500_body", query_doc_flags.f_lm_dir_2500_body,
-               "Enable feature f_lm_dir_2500_body")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500_title", query_doc_flags.f_lm_dir_2500_title,
-               "Enable feature f_lm_dir_2500_title")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500_heading", query_doc_flags.f_lm_dir_2500_heading,
-               "Enable feature f_lm_dir_2500_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500_inlink", query_doc_flags.f_lm_dir_2500_inlink,
-               "Enable feature f_lm_dir_2500_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_2500_a", query_doc_flags.f_lm_dir_2500_a,
-               "Enable feature f_lm_dir_2500_a")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500", query_doc_flags.f_lm_dir_1500,
-               "Enable feature f_lm_dir_1500")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500_body", query_doc_flags.f_lm_dir_1500_body,
-               "Enable feature f_lm_dir_1500_body")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500_title", query_doc_flags.f_lm_dir_1500_title,
-               "Enable feature f_lm_dir_1500_title")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500_heading", query_doc_flags.f_lm_dir_1500_heading,
-               "Enable feature f_lm_dir_1500_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500_inlink", query_doc_flags.f_lm_dir_1500_inlink,
-               "Enable feature f_lm_dir_1500_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1500_a", query_doc_flags.f_lm_dir_1500_a,
-               "Enable feature f_lm_dir_1500_a")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000", query_doc_flags.f_lm_dir_1000,
-               "Enable feature f_lm_dir_1000")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000_body", query_doc_flags.f_lm_dir_1000_body,
-               "Enable feature f_lm_dir_1000_body")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000_title", query_doc_flags.f_lm_dir_1000_title,
-               "Enable feature f_lm_dir_1000_title")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000_heading", query_doc_flags.f_lm_dir_1000_heading,
-               "Enable feature f_lm_dir_1000_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000_inlink", query_doc_flags.f_lm_dir_1000_inlink,
-               "Enable feature f_lm_dir_1000_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_lm_dir_1000_a", query_doc_flags.f_lm_dir_1000_a,
-               "Enable feature f_lm_dir_1000_a")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf", query_doc_flags.f_tfidf, "Enable feature f_tfidf")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf_body", query_doc_flags.f_tfidf_body,
-               "Enable feature f_tfidf_body")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf_title", query_doc_flags.f_tfidf_title,
-               "Enable feature f_tfidf_title")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf_heading", query_doc_flags.f_tfidf_heading,
-               "Enable feature f_tfidf_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf_inlink", query_doc_flags.f_tfidf_inlink,
-               "Enable feature f_tfidf_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_tfidf_a", query_doc_flags.f_tfidf_a,
-               "Enable feature f_tfidf_a")
-      ->group("Query-document features");
-  app.add_flag("--f_prob", query_doc_flags.f_prob, "Enable feature f_prob")
-      ->group("Query-document features");
-  app.add_flag("--f_prob_body", query_doc_flags.f_prob_body,
-               "Enable feature f_prob_body")
-      ->group("Query-document features");
-  app.add_flag("--f_prob_title", query_doc_flags.f_prob_title,
-               "Enable feature f_prob_title")
-      ->group("Query-document features");
-  app.add_flag("--f_prob_heading", query_doc_flags.f_prob_heading,
-               "Enable feature f_prob_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_prob_inlink", query_doc_flags.f_prob_inlink,
-               "Enable feature f_prob_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_prob_a", query_doc_flags.f_prob_a,
-               "Enable feature f_prob_a")
-      ->group("Query-document features");
-  app.add_flag("--f_be", query_doc_flags.f_be, "Enable feature f_be")
-      ->group("Query-document features");
-  app.add_flag("--f_be_body", query_doc_flags.f_be_body,
-               "Enable feature f_be_body")
-      ->group("Query-document features");
-  app.add_flag("--f_be_title", query_doc_flags.f_be_title,
-               "Enable feature f_be_title")
-      ->group("Query-document features");
-  app.add_flag("--f_be_heading", query_doc_flags.f_be_heading,
-               "Enable feature f_be_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_be_inlink", query_doc_flags.f_be_inlink,
-               "Enable feature f_be_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_be_a", query_doc_flags.f_be_a, "Enable feature f_be_a")
-      ->group("Query-document features");
-  app.add_flag("--f_dph", query_doc_flags.f_dph, "Enable feature f_dph")
-      ->group("Query-document features");
-  app.add_flag("--f_dph_body", query_doc_flags.f_dph_body,
-               "Enable feature f_dph_body")
-      ->group("Query-document features");
-  app.add_flag("--f_dph_title", query_doc_flags.f_dph_title,
-               "Enable feature f_dph_title")
-      ->group("Query-document features");
-  app.add_flag("--f_dph_heading", query_doc_flags.f_dph_heading,
-               "Enable feature f_dph_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_dph_inlink", query_doc_flags.f_dph_inlink,
-               "Enable feature f_dph_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_dph_a", query_doc_flags.f_dph_a, "Enable feature f_dph_a")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr", query_doc_flags.f_dfr, "Enable feature f_dfr")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr_body", query_doc_flags.f_dfr_body,
-               "Enable feature f_dfr_body")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr_title", query_doc_flags.f_dfr_title,
-               "Enable feature f_dfr_title")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr_heading", query_doc_flags.f_dfr_heading,
-               "Enable feature f_dfr_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr_inlink", query_doc_flags.f_dfr_inlink,
-               "Enable feature f_dfr_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_dfr_a", query_doc_flags.f_dfr_a, "Enable feature f_dfr_a")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len", query_doc_flags.f_stream_len,
-               "Enable feature f_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len_body", query_doc_flags.f_stream_len_body,
-               "Enable feature f_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len_title", query_doc_flags.f_stream_len_title,
-               "Enable feature f_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len_heading", query_doc_flags.f_stream_len_heading,
-               "Enable feature f_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len_inlink", query_doc_flags.f_stream_len_inlink,
-               "Enable feature f_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_stream_len_a", query_doc_flags.f_stream_len_a,
-               "Enable feature f_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len", query_doc_flags.f_sum_stream_len,
-               "Enable feature f_sum_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len_body", query_doc_flags.f_sum_stream_len_body,
-               "Enable feature f_sum_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len_title",
-               query_doc_flags.f_sum_stream_len_title,
-               "Enable feature f_sum_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len_heading",
-               query_doc_flags.f_sum_stream_len_heading,
-               "Enable feature f_sum_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len_inlink",
-               query_doc_flags.f_sum_stream_len_inlink,
-               "Enable feature f_sum_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_sum_stream_len_a", query_doc_flags.f_sum_stream_len_a,
-               "Enable feature f_sum_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len", query_doc_flags.f_min_stream_len,
-               "Enable feature f_min_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len_body", query_doc_flags.f_min_stream_len_body,
-               "Enable feature f_min_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len_title",
-               query_doc_flags.f_min_stream_len_title,
-               "Enable feature f_min_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len_heading",
-               query_doc_flags.f_min_stream_len_heading,
-               "Enable feature f_min_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len_inlink",
-               query_doc_flags.f_min_stream_len_inlink,
-               "Enable feature f_min_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_min_stream_len_a", query_doc_flags.f_min_stream_len_a,
-               "Enable feature f_min_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len", query_doc_flags.f_max_stream_len,
-               "Enable feature f_max_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len_body", query_doc_flags.f_max_stream_len_body,
-               "Enable feature f_max_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len_title",
-               query_doc_flags.f_max_stream_len_title,
-               "Enable feature f_max_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len_heading",
-               query_doc_flags.f_max_stream_len_heading,
-               "Enable feature f_max_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len_inlink",
-               query_doc_flags.f_max_stream_len_inlink,
-               "Enable feature f_max_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_max_stream_len_a", query_doc_flags.f_max_stream_len_a,
-               "Enable feature f_max_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len", query_doc_flags.f_mean_stream_len,
-               "Enable feature f_mean_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len_body",
-               query_doc_flags.f_mean_stream_len_body,
-               "Enable feature f_mean_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len_title",
-               query_doc_flags.f_mean_stream_len_title,
-               "Enable feature f_mean_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len_heading",
-               query_doc_flags.f_mean_stream_len_heading,
-               "Enable feature f_mean_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len_inlink",
-               query_doc_flags.f_mean_stream_len_inlink,
-               "Enable feature f_mean_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_mean_stream_len_a", query_doc_flags.f_mean_stream_len_a,
-               "Enable feature f_mean_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len", query_doc_flags.f_variance_stream_len,
-               "Enable feature f_variance_stream_len")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len_body",
-               query_doc_flags.f_variance_stream_len_body,
-               "Enable feature f_variance_stream_len_body")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len_title",
-               query_doc_flags.f_variance_stream_len_title,
-               "Enable feature f_variance_stream_len_title")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len_heading",
-               query_doc_flags.f_variance_stream_len_heading,
-               "Enable feature f_variance_stream_len_heading")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len_inlink",
-               query_doc_flags.f_variance_stream_len_inlink,
-               "Enable feature f_variance_stream_len_inlink")
-      ->group("Query-document features");
-  app.add_flag("--f_variance_stream_len_a",
-               query_doc_flags.f_variance_stream_len_a,
-               "Enable feature f_variance_stream_len_a")
-      ->group("Query-document features");
-  app.add_flag("--f_tpscore", query_doc_flags.f_tpscore,
-               "Enable feature f_tpscore")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_bigram_u8", query_doc_flags.f_bm25_bigram_u8,
-               "Enable feature f_bm25_bigram_u8")
-      ->group("Query-document features");
-  app.add_flag("--f_bm25_tp_dist_w100", query_doc_flags.f_bm25_tp_dist_w100,
-               "Enable feature f_bm25_tp_dist_w100")
-      ->group("Query-document features");
-  app.add_flag("--f_sdm", query_doc_flags.f_sdm, "Enable feature f_sdm")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_title_qry_count", query_doc_flags.f_tag_title_qry_count,
-               "Enable feature f_tag_title_qry_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_heading_qry_count",
-               query_doc_flags.f_tag_heading_qry_count,
-               "Enable feature f_tag_heading_qry_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_mainbody_qry_count",
-               query_doc_flags.f_tag_mainbody_qry_count,
-               "Enable feature f_tag_mainbody_qry_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_inlink_qry_count",
-               query_doc_flags.f_tag_inlink_qry_count,
-               "Enable feature f_tag_inlink_qry_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_title_count", query_doc_flags.f_tag_title_count,
-               "Enable feature f_tag_title_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_heading_count", query_doc_flags.f_tag_heading_count,
-               "Enable feature f_tag_heading_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_inlink_count", query_doc_flags.f_tag_inlink_count,
-               "Enable feature f_tag_inlink_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_applet_count", query_doc_flags.f_tag_applet_count,
-               "Enable feature f_tag_applet_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_object_count", query_doc_flags.f_tag_object_count,
-               "Enable feature f_tag_object_count")
-      ->group("Query-document features");
-  app.add_flag("--f_tag_embed_count", query_doc_flags.f_tag_embed_count,
-               "Enable feature f_tag_embed_count")
-      ->group("Query-document features");
-  app.add_flag("--f_len", static_doc_flags.f_len, "Enable feature f_len")
-      ->group("Static document features");
-  app.add_flag("--f_title_len", static_doc_flags.f_title_len,
-               "Enable feature f_title_len")
-      ->group("Static document features");
-  app.add_flag("--f_visterm_len", static_doc_flags.f_visterm_len,
-               "Enable feature f_visterm_len")
-      ->group("Static document features");
-  app.add_flag("--f_url_len", static_doc_flags.f_url_len,
-               "Enable feature f_url_len")
-      ->group("Static document features");
-  app.add_flag("--f_url_depth", static_doc_flags.f_url_depth,
-               "Enable feature f_url_depth")
-      ->group("Static document features");
-  app.add_flag("--f_avg_term_len", static_doc_flags.f_avg_term_len,
-               "Enable feature f_avg_term_len")
-      ->group("Static document features");
-  app.add_flag("--f_entropy", static_doc_flags.f_entropy,
-               "Enable feature f_entropy")
-      ->group("Static document features");
-  app.add_flag("--f_stop_cover", static_doc_flags.f_stop_cover,
-               "Enable feature f_stop_cover")
-      ->group("Static document features");
-  app.add_flag("--f_frac_stop", static_doc_flags.f_frac_stop,
-               "Enable feature f_frac_stop")
-      ->group("Static document features");
-  app.add_flag("--f_frac_anchor_text", static_doc_flags.f_frac_anchor_text,
-               "Enable feature f_frac_anchor_text")
-      ->group("Static document features");
-  app.add_flag("--f_frac_vis_text", static_doc_flags.f_frac_vis_text,
-               "Enable feature f_frac_vis_text")
-      ->group("Static document features");
-  app.add_flag("--f_frac_table_text", static_doc_flags.f_frac_table_text,
-               "Enable feature f_frac_table_text")
-      ->group("Static document features");
-  app.add_flag("--f_frac_td_text", static_doc_flags.f_frac_td_text,
-               "Enable feature f_frac_td_text")
-      ->group("Static document features");
-  app.add_flag("--f_is_wikipedia", static_doc_flags.f_is_wikipedia,
-               "Enable feature f_is_wikipedia")
-      ->group("Static document features");
+  app.add_option("--threads", threads,
+                 "Number of queries to extract in parallel (0 for all cores)");
+  app.add_option("--doc_threads", doc_threads,
+                 "Number of threads to split the candidates of each query "
+                 "between (0 for all cores)");
+  app.add_flag("--selective_load", selective_load,
+               "Only load the forward index documents that the run file and "
+               "SDM need");
+  app.add_option("--serve", serve_socket,
+                 "Keep the indexes loaded and serve requests on this Unix "
+                 "domain socket instead of extracting a run file");
+  app.add_flag("--stream", stream,
+               "Read the run from stdin one query at a time and write the "
+               "features of each query to stdout as soon as it is done");
+  app.add_flag("--inline_query", inline_query,
+               "With --stream, read the query terms from the fields after the "
+               "run identifier instead of the query file");
+  app.add_flag("--async_output", async_output,
+               "Write the output from a background thread");
+  app.add_option("--profile", profile_file,
+                 "Time each feature family and extraction stage, and write a "
+                 "JSON report to this file at exit");
+  app.add_option("--stats", stats_file,
+                 "Write load times, throughput and peak memory as JSON to this "
+                 "file at exit");
+  app.add_flag("--batch", batch,
+               "Score BM25, LM, TF-IDF, BE, DPH and DFR for blocks of "
+               "candidates at a time with SIMD kernels");
+  app.add_option("--simd", simd,
+                 "Kernels for --batch: scalar, avx2 or avx512, the best that "
+                 "the CPU supports by default");
+  app.add_flag("--float", single_precision,
+               "Score the --batch families in single precision, and write "
+               "the features rounded to floats");
+  app.add_flag("--binary", binary,
+               "Write the rows as binary records with float32 features "
+               "instead of CSV");
+
+  /* A flag enabling each feature, named after it by `feature::name`. */
+  FeatureFlags feature_flags = {};
+  for (size_t id = 0; id < feature::count; ++id) {
+    std::string flag = std::string("f_") + feature::name(feature::Id(id));
+    app.add_flag("--" + flag, feature_flags[id], "Enable feature " + flag)
+        ->group(id < feature::first_static ? "Query-document features"
+                                           : "Static document features");
+  }
 
   app.set_config("-c,--config", "", "Read configuration from file", false);
   CLI11_PARSE(app, argc, argv);
+  // The output columns, in the order of the feature ids
+  const std::vector<feature::Id> columns = enabled_features(feature_flags);
+
+  if (stream) {
+    if (!inline_query && query_file.empty()) {
+      return app.exit(CLI::RequiredError("query_file"));
+    }
+  } else if (serve_socket.empty() &&
+             (query_file.empty() || trec_file.empty() || output_file.empty())) {
+    return app.exit(
+        CLI::RequiredError("query_file, trec_file and output_file"));
+  }
+  if (indri_index.empty() && (docno_file.empty() || field_id_file.empty())) {
+    return app.exit(
+        CLI::RequiredError("--indri_index or --docnos and --field_ids"));
+  }
+  if (binary && !serve_socket.empty()) {
+    std::cerr << "--binary can not be used with --serve" << std::endl;
+    return 1;
+  }
+  if ((stream || !serve_socket.empty()) && selective_load) {
+    std::cerr << "--selective_load needs a run file and can not be used with "
+                 "--serve or --stream"
+              << std::endl;
+    return 1;
+  }
+
+  SimdLevel simd_level = detect_simd_level();
+  if (!simd.empty()) {
+    if (!parse_simd_level(simd, simd_level)) {
+      std::cerr << "--simd must be one of scalar, avx2 or avx512" << std::endl;
+      return 1;
+    }
+    if (!simd_supported(simd_level)) {
+      std::cerr << "This CPU does not support --simd " << simd << std::endl;
+      return 1;
+    }
+  }
 
-  std::ofstream outfile(output_file, std::ofstream::out);
-  outfile << std::fixed << std::setprecision(5);
+  if (0 == threads) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (0 == doc_threads) {
+    doc_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  auto out_mode = std::ofstream::out;
+  if (binary) {
+    out_mode |= std::ofstream::binary;
+  }
+  std::ofstream outfile(output_file, out_mode);
 
   query_environment indri_env;
   query_environment_adapter qry_env(&indri_env);
-  qry_env.add_index(indri_index);
-
   indri::collection::Repository repo;
-  repo.openRead(indri_index);
-  auto index = (*repo.indexes())[0];
+  indri::index::Index *index = nullptr;
+  if (!indri_index.empty()) {
+    qry_env.add_index(indri_index);
+    repo.openRead(indri_index);
+    index = (*repo.indexes())[0];
+  }
 
   using clock = std::chrono::high_resolution_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+  ExtractStats stats;
 
-  // load fwd_idx
-  std::cerr << "Loading " << fwd_index_file << "..." << std::endl;
-  auto start = clock::now();
-  std::ifstream ifs_fwd(fwd_index_file);
-  cereal::BinaryInputArchive iarchive_fwd(ifs_fwd);
-  ForwardIndex fwd_idx;
-  iarchive_fwd(fwd_idx);
+  // load docno store, docnos are resolved in Indri otherwise
+  std::unique_ptr<DocnoStore> docno_store;
+  if (!docno_file.empty()) {
+    std::cerr << "Loading " << docno_file << "..." << std::endl;
+    auto start = clock::now();
+    std::ifstream ifs_docno(docno_file, std::ios::binary);
+    cereal::BinaryInputArchive iarchive_docno(ifs_docno);
+    docno_store.reset(new DocnoStore());
+    iarchive_docno(*docno_store);
+
+    auto load_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        clock::now() - start);
+    std::cerr << "Loaded " << docno_file << " in " << load_time.count()
+              << " ms" << std::endl;
+    stats.add_load("docnos", ms(clock::now() - start).count());
+  }
 
-  auto stop = clock::now();
-  auto load_time =
-      std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-  std::cerr << "Loaded " << fwd_index_file << " in " << load_time.count()
-            << " ms" << std::endl;
+  // The Indri query environment is not safe to use from multiple threads.
+  std::mutex indri_mutex;
+
+  // Look up the docids of `docnos`. Docnos that are not in the index are
+  // skipped, so there may be fewer docids than docnos.
+  auto lookup_docids = [&](const std::vector<std::string> &docnos) {
+    if (docno_store) {
+      return docno_store->docids<docid_t>(docnos);
+    }
+    std::lock_guard<std::mutex> lock(indri_mutex);
+    return qry_env.document_ids_from_metadata("docno", docnos);
+  };
 
   // load inv_idx
   std::cerr << "Loading " << inv_index_file << "..." << std::endl;
-  start = clock::now();
-  std::ifstream ifs_inv(inv_index_file);
-  cereal::BinaryInputArchive iarchive_inv(ifs_inv);
+  auto start = clock::now();
+  std::ifstream ifs_inv(inv_index_file, std::ios::binary);
   InvertedIndex inv_idx;
-  iarchive_inv(inv_idx);
+  read_inverted_index(ifs_inv, inv_idx);
 
-  stop = clock::now();
-  load_time =
+  auto stop = clock::now();
+  auto load_time =
       std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
   std::cerr << "Loaded " << inv_index_file << " in " << load_time.count()
             << " ms" << std::endl;
+  stats.add_load("inverted_index", ms(stop - start).count());
 
   // load lexicon
   std::cerr << "Loading " << lexicon_file << "..." << std::endl;
@@ -545,6 +358,7 @@ int main(int argc, char **argv) {
       std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
   std::cerr << "Loaded " << lexicon_file << " in " << load_time.count() << " ms"
             << std::endl;
+  stats.add_load("lexicon", ms(stop - start).count());
 
   // load static doc list
   std::cerr << "Loading " << static_doc_file << "..." << std::endl;
@@ -559,93 +373,561 @@ int main(int argc, char **argv) {
       std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
   std::cerr << "Loaded " << static_doc_file << " in " << load_time.count()
             << " ms" << std::endl;
+  stats.add_load("static_doc", ms(stop - start).count());
 
-  // load query file
-  std::ifstream ifs(query_file);
-  if (!ifs.is_open()) {
-    std::cerr << "Could not open file: " << query_file << std::endl;
-    exit(EXIT_FAILURE);
+  // load query file, queries are sent with each request in server mode
+  std::ifstream ifs;
+  start = clock::now();
+  if (serve_socket.empty() && !inline_query) {
+    ifs.open(query_file);
+    if (!ifs.is_open()) {
+      std::cerr << "Could not open file: " << query_file << std::endl;
+      exit(EXIT_FAILURE);
+    }
   }
   query_train_file qtfile(ifs, lexicon);
   ifs.close();
   ifs.clear();
+  stats.add_load("queries", ms(clock::now() - start).count());
 
-  // load trec run file
-  ifs.open(trec_file);
+  // load trec run file, it is read while extracting in streaming mode
   trec_run_file trec_run(ifs);
-  trec_run.parse();
-  ifs.close();
-  ifs.clear();
+  if (serve_socket.empty() && !stream) {
+    start = clock::now();
+    ifs.open(trec_file);
+    trec_run.parse();
+    ifs.close();
+    ifs.clear();
+    stats.add_load("run", ms(clock::now() - start).count());
+  }
+
+  // Docids of every candidate in the run, and of the documents that SDM scans
+  // to count the collection frequency of the query bigrams.
+  auto selected_docids = [&](std::vector<query_train> &queries) {
+    std::vector<size_t> docids;
+    Sdm sdm;
+    for (auto &qry : queries) {
+      for (auto docid : lookup_docids(trec_run.get_result(qry.id))) {
+        docids.push_back(docid);
+      }
+      if (feature_flags[feature::sdm]) {
+        auto bigram_docids = sdm.bigram_postings(
+            sdm.bigrams(qry), sdm.unigram_postings(qry, inv_idx));
+        for (auto &bd : bigram_docids) {
+          docids.insert(docids.end(), bd.begin(), bd.end());
+        }
+      }
+    }
+    return docids;
+  };
 
+  // load fwd_idx
+  std::cerr << "Loading " << fwd_index_file << "..." << std::endl;
+  start = clock::now();
+  std::unique_ptr<ForwardIndexReader> fwd_reader;
+  if (MappedForwardIndex::is_mapped(fwd_index_file)) {
+    fwd_reader.reset(new MappedForwardIndex(fwd_index_file));
+  } else if (selective_load) {
+    std::ifstream ifs_fwd(fwd_index_file);
+    auto selective = new SelectiveForwardIndex(
+        ifs_fwd, selected_docids(qtfile.get_queries()));
+    fwd_reader.reset(selective);
+    std::cerr << "Selected " << selective->loaded() << " of "
+              << selective->size() << " documents" << std::endl;
+  } else {
+    std::ifstream ifs_fwd(fwd_index_file, std::ios::binary | std::ios::ate);
+    size_t archive_len = ifs_fwd ? size_t(ifs_fwd.tellg()) : 0;
+    ifs_fwd.seekg(0);
+    fwd_reader.reset(new ArenaForwardIndex(ifs_fwd, archive_len));
+  }
+
+  stop = clock::now();
+  load_time =
+      std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+  std::cerr << "Loaded " << fwd_index_file << " in " << load_time.count()
+            << " ms" << std::endl;
+  stats.add_load("forward_index", ms(stop - start).count());
+
+  // Fields missing from the index get id `0`, as in Indri.
+  FieldIdMap index_field_ids;
+  if (!field_id_file.empty()) {
+    std::ifstream ifs_fields(field_id_file, std::ios::binary);
+    cereal::BinaryInputArchive iarchive_fields(ifs_fields);
+    iarchive_fields(index_field_ids);
+  }
   FieldIdMap field_id_map;
   const std::vector<std::string> idx_fields = {
       "title", "heading", "mainbody", "inlink", "applet", "object", "embed"};
   for (const std::string &field_str : idx_fields) {
-    int field_id = index->field(field_str);
+    int field_id = 0;
+    if (field_id_file.empty()) {
+      field_id = index->field(field_str);
+    } else if (index_field_ids.count(field_str)) {
+      field_id = index_field_ids[field_str];
+    }
     field_id_map.insert(std::make_pair(field_str, field_id));
   }
 
-  FeatureExtractor fe(lexicon, field_id_map, query_doc_flags, static_doc_flags);
-
-  // SDM requires different data structures than the other features, therefore
-  // it is currently setup here.
-  //
-  // FIXME: Move this to a logical place.
-  Sdm sdm;
-  DocSdmFeature f_sdm(sdm);
-
-  auto queries = qtfile.get_queries();
-  for (auto &qry : queries) {
-    std::vector<double> stage0_scores = trec_run.get_scores(qry.id);
-    std::vector<int> docno_labels = trec_run.get_labels(qry.id);
-    std::vector<std::string> docnos = trec_run.get_result(qry.id);
-    std::vector<docid_t> docids =
-        qry_env.document_ids_from_metadata("docno", docnos);
+  std::mutex log_mutex;
+
+  // A server extracts queries until it is stopped, so only the totals of its
+  // profile are kept.
+  ProfileReport profile_report(serve_socket.empty());
+  auto extract_start = clock::now();
+  // Write the profile and stats reports, if requested, before exiting.
+  auto write_reports = [&]() {
+    if (!profile_file.empty()) {
+      std::ofstream os(profile_file);
+      profile_report.write_json(os);
+      if (!os) {
+        std::cerr << "Could not write profile to " << profile_file
+                  << std::endl;
+      }
+    }
+    if (!stats_file.empty()) {
+      std::ofstream os(stats_file);
+      stats.write_json(os, ms(clock::now() - extract_start).count(), threads,
+                       doc_threads);
+      if (!os) {
+        std::cerr << "Could not write stats to " << stats_file << std::endl;
+      }
+    }
+  };
+
+  // Extract the features of a candidate document that has been decoded into
+  // `doc_idx` into `row`, and write them to `out`. Unless `batch_slot` is
+  // `no_batch`, the term weighting features have already been scored by
+  // `FeatureExtractor::extract_batch`, as document `batch_slot` of the batch.
+  const size_t no_batch = SIZE_MAX;
+  auto finish_document = [&](ExtractorWorker &worker, const QueryContext &ctx,
+                             const DocumentView &doc_idx, FeatureRow &row,
+                             size_t batch_slot, docid_t docid,
+                             const std::string &docno, int label,
+                             double stage0_score, FeatureBuffer &out) {
+    ExtractProfile *profile = worker.profile.get();
+
+    // Proximity, TP-score and SDM share the query term positions
+    if (worker.fe.needs_positions() || feature_flags[feature::sdm]) {
+      ProfileTimer timer(profile, ProfileStage::positions);
+      worker.positions.build(doc_idx.terms());
+    }
 
-    auto start = clock::now();
+    // set original run score as a feature for training
+    row[feature::stage0_score] = stage0_score;
 
-    for (size_t i = 0; i < docids.size(); ++i) {
-      auto const docid = docids[i];
-      auto const docno = docnos[i];
-      auto const label = docno_labels[i];
+    // query-document features
+    if (no_batch == batch_slot) {
+      worker.fe.extract(ctx, row, doc_idx, worker.positions);
+    } else {
+      worker.fe.extract_batched(ctx, batch_slot, row, doc_idx,
+                                worker.positions);
+    }
 
-      auto doc_idx = fwd_idx[docid];
-      doc_idx.decompress();
+    // SDM
+    // FIXME: Move this to a logical place.
+    if (feature_flags[feature::sdm]) {
+      ProfileTimer timer(profile, ProfileStage::sdm);
+      worker.f_sdm.compute(ctx, row, doc_idx, *fwd_reader, inv_idx,
+                           worker.positions);
+    }
 
-      doc_entry doc_entry;
-      statdoc_entry statdoc_entry;
+    // static document features
+    statdoc_list[docid].dentry.store(row);
 
-      auto terms = doc_idx.terms();
-      std::unordered_map<uint32_t, std::vector<uint32_t>> positions;
-      for (size_t i = 0; i < terms.size(); i++) {
-        positions[terms[i]].push_back(i);
+    ProfileTimer timer(profile, ProfileStage::output);
+    auto write_row = [&](const auto &presenter) {
+      if (binary) {
+        write_binary_row(out, label, ctx.query().id, docno, presenter);
+      } else {
+        out << label << "," << ctx.query().id << "," << docno << presenter
+            << '\n';
       }
+    };
+    if (single_precision) {
+      std::copy(row.begin(), row.end(), worker.float_row.begin());
+      write_row(FloatFeaturePresenter(worker.float_row, columns));
+    } else {
+      write_row(FeaturePresenter(row, columns));
+    }
+  };
+
+  // Extract the features of candidates `[begin, end)` of `cands` and write
+  // their rows to `out`. With `--batch` the documents are decoded
+  // `ScoreBatch::width` at a time and their term weighting features are
+  // scored together.
+  auto extract_documents = [&](ExtractorWorker &worker,
+                               const QueryContext &ctx,
+                               const Candidates &cands, size_t begin,
+                               size_t end, FeatureBuffer &out) {
+    ExtractProfile *profile = worker.profile.get();
+    // Only decode the streams of each document that the features read
+    DecodePlan plan = worker.fe.decode_plan(ctx);
+    plan.terms = plan.terms || feature_flags[feature::sdm];
+    worker.doc_view.set_plan(plan);
+    for (auto &view : worker.batch_views) {
+      view.set_plan(plan);
+    }
+    if (!batch) {
+      for (size_t i = begin; i < end; ++i) {
+        {
+          ProfileTimer timer(profile, ProfileStage::decode);
+          fwd_reader->decode(cands.docids[i], worker.doc_view, worker.doc);
+        }
+        worker.row.fill(0.0);
+        finish_document(worker, ctx, worker.doc_view, worker.row, no_batch,
+                        cands.docids[i], cands.docnos[i], cands.labels[i],
+                        cands.stage0_scores[i], out);
+      }
+      return;
+    }
 
-      // set original run score as a feature for training
-      doc_entry.stage0_score = stage0_scores[i];
-
-      // query-document features
-      fe.extract(qry, doc_entry, doc_idx, positions);
-
-      // SDM
-      // FIXME: Move this to a logical place.
-      if (query_doc_flags.f_sdm) {
-        f_sdm.compute(qry, doc_entry, doc_idx, lexicon, fwd_idx, inv_idx);
+    for (size_t first = begin; first < end; first += ScoreBatch::width) {
+      size_t n = std::min(ScoreBatch::width, end - first);
+      for (size_t j = 0; j < n; ++j) {
+        ProfileTimer timer(profile, ProfileStage::decode);
+        fwd_reader->decode(cands.docids[first + j], worker.batch_views[j],
+                           worker.batch_docs[j]);
+        worker.batch_rows[j].fill(0.0);
+      }
+      worker.fe.extract_batch(ctx, worker.batch_rows.data(),
+                              worker.batch_views.data(), n);
+      for (size_t j = 0; j < n; ++j) {
+        size_t i = first + j;
+        finish_document(worker, ctx, worker.batch_views[j],
+                        worker.batch_rows[j], j, cands.docids[i],
+                        cands.docnos[i], cands.labels[i],
+                        cands.stage0_scores[i], out);
       }
+    }
+  };
+
+  auto resolve_docids = [&](Candidates &cands) {
+    cands.docids = lookup_docids(cands.docnos);
+  };
+
+  // The candidates of `qry` in the run file.
+  auto run_candidates = [&](const query_train &qry) {
+    Candidates cands;
+    cands.stage0_scores = trec_run.get_scores(qry.id);
+    cands.labels = trec_run.get_labels(qry.id);
+    cands.docnos = trec_run.get_result(qry.id);
+    resolve_docids(cands);
+    return cands;
+  };
+
+  // Extract the features of every candidate of `qry` and write the rows to
+  // `out` in run order. With more than one worker in `workers` the candidates
+  // are split into chunks that the workers claim in turn, each chunk is
+  // formatted into its own buffer, and the buffers are written in order once
+  // all the workers are done.
+  auto extract_query = [&](WorkerSet &worker_set, query_train &qry,
+                           const Candidates &cands, FeatureBuffer &out) {
+    auto &workers = worker_set.workers;
+    const auto &docids = cands.docids;
 
-      // static document features
-      statdoc_entry = statdoc_list[docid].dentry;
+    auto start = clock::now();
+    size_t out_begin = out.size();
+    QueryContext ctx(lexicon, field_id_map, qry);
+    // The SDM postings are fetched once and shared by the document threads
+    std::shared_ptr<const SdmContext> sdm_ctx;
+    if (feature_flags[feature::sdm]) {
+      sdm_ctx = workers[0]->f_sdm.make_context(qry, inv_idx);
+    }
+    for (auto &worker : workers) {
+      worker->positions.set_query(qry);
+      if (sdm_ctx) {
+        worker->f_sdm.set_query(qry, sdm_ctx);
+      }
+      if (worker->profile) {
+        worker->profile->clear();
+      }
+    }
 
-      FeaturePresenter presenter(doc_entry, query_doc_flags, statdoc_entry,
-                                 static_doc_flags);
-      outfile << label << "," << qry.id << "," << docno << presenter
-              << std::endl;
+    size_t num_chunks = std::min(workers.size() * doc_chunks_per_thread,
+                                 docids.size() / doc_chunk_min_len);
+    if (num_chunks < 2) {
+      extract_documents(*workers[0], ctx, cands, 0, docids.size(), out);
+    } else {
+      std::vector<FeatureBuffer> chunk_rows(num_chunks);
+      std::atomic<size_t> next_chunk(0);
+      auto run_chunks = [&](ExtractorWorker &worker) {
+        for (size_t c = next_chunk++; c < num_chunks; c = next_chunk++) {
+          size_t begin = c * docids.size() / num_chunks;
+          size_t end = (c + 1) * docids.size() / num_chunks;
+          extract_documents(worker, ctx, cands, begin, end, chunk_rows[c]);
+        }
+      };
+
+      worker_set.pool->run([&](size_t t) { run_chunks(*workers[t]); });
+      for (auto &rows : chunk_rows) {
+        out.append(rows);
+      }
     }
+
     auto stop = clock::now();
+    stats.add_query(docids.size(), out.size() - out_begin);
+    if (!profile_file.empty()) {
+      ExtractProfile profile;
+      for (auto &worker : workers) {
+        profile.merge(*worker->profile);
+      }
+      profile_report.add_query(
+          qry.id, docids.size(),
+          std::chrono::duration<double, std::milli>(stop - start).count(),
+          profile);
+    }
     auto load_time =
         std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+    std::lock_guard<std::mutex> lock(log_mutex);
     std::cerr << "qid: " << qry.id << ", " << docids.size() << " docs in "
               << load_time.count() << " ms" << std::endl;
+  };
+
+  // Feature state for each of the document threads working on one query.
+  auto make_workers = [&]() {
+    WorkerSet set;
+    auto &workers = set.workers;
+    for (size_t i = 0; i < doc_threads; ++i) {
+      workers.emplace_back(
+          new ExtractorWorker(feature_flags, !profile_file.empty()));
+      if (batch) {
+        workers.back()->fe.set_simd_level(simd_level);
+        workers.back()->fe.set_single_precision(single_precision);
+        workers.back()->batch_docs.resize(ScoreBatch::width);
+        workers.back()->batch_views.resize(ScoreBatch::width);
+        workers.back()->batch_rows.resize(ScoreBatch::width);
+      }
+    }
+    set.pool.reset(new ForkJoinPool(doc_threads));
+    return set;
+  };
+
+  // Serve the requests of one client until it disconnects. A request is a
+  // query line in the query file format, followed by one candidate per line as
+  // `<docno> [<stage0 score> [<label>]]`, and ends with an empty line. The
+  // response is the feature rows in candidate order followed by an empty line,
+  // or a line starting with `error:` and an empty line.
+  auto serve_connection = [&](WorkerSet &workers, int fd,
+                              LatencyStats &latency) {
+    FdStreamBuf buf(fd);
+    std::iostream io(&buf);
+    io << std::fixed << std::setprecision(5);
+
+    FeatureBuffer rows;
+    std::string line;
+    while (std::getline(io, line)) {
+      if (line.empty()) {
+        continue;
+      }
+      if ("#stats" == line) {
+        io << latency.summary() << "\n\n" << std::flush;
+        continue;
+      }
+
+      auto start = clock::now();
+      std::string error;
+      query_train qry;
+      try {
+        qry = query_train_file::parse_line(line, lexicon);
+      } catch (const std::exception &e) {
+        error = e.what();
+      }
+
+      Candidates cands;
+      while (std::getline(io, line) && !line.empty()) {
+        std::istringstream iss(line);
+        std::string docno;
+        double stage0_score = 0.0;
+        int label = 0;
+        iss >> docno >> stage0_score >> label;
+        cands.docnos.push_back(docno);
+        cands.stage0_scores.push_back(stage0_score);
+        cands.labels.push_back(label);
+      }
+
+      if (error.empty()) {
+        resolve_docids(cands);
+        if (cands.docids.size() != cands.docnos.size()) {
+          error = "unknown docno in request for query " + qry.id;
+        }
+      }
+      if (error.empty()) {
+        try {
+          rows.clear();
+          extract_query(workers, qry, cands, rows);
+          io << rows;
+        } catch (const std::exception &e) {
+          error = e.what();
+        }
+      }
+      if (!error.empty()) {
+        io << "error: " << error << "\n";
+      }
+      io << "\n" << std::flush;
+
+      latency.record(
+          std::chrono::duration<double, std::milli>(clock::now() - start)
+              .count());
+    }
+  };
+
+  // Server mode. Each of the `threads` handlers serves one client at a time,
+  // so up to `threads` requests are extracted concurrently while the indexes
+  // stay loaded. SIGINT and SIGTERM stop the server.
+  if (!serve_socket.empty()) {
+    // Block the signals in every thread, they are handled by `sigwait` below.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    UnixSocketServer server(serve_socket);
+    LatencyStats latency;
+    bool stopping = false;
+    std::mutex clients_mutex;
+    std::set<int> clients;
+    std::cerr << "Serving on " << server.path() << " with " << threads
+              << " threads" << std::endl;
+
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+      pool.emplace_back([&]() {
+        WorkerSet workers = make_workers();
+        for (int fd = server.accept(); fd >= 0; fd = server.accept()) {
+          {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            if (stopping) {
+              ::shutdown(fd, SHUT_RDWR);
+            }
+            clients.insert(fd);
+          }
+          serve_connection(workers, fd, latency);
+          {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            clients.erase(fd);
+          }
+          ::close(fd);
+        }
+      });
+    }
+
+    int sig;
+    sigwait(&signals, &sig);
+    std::cerr << "Stopping server" << std::endl;
+    server.shutdown();
+    {
+      // Wake handlers that are waiting on an idle client.
+      std::lock_guard<std::mutex> lock(clients_mutex);
+      stopping = true;
+      for (int fd : clients) {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (auto &th : pool) {
+      th.join();
+    }
+    std::cerr << latency.summary() << std::endl;
+    write_reports();
+    return 0;
+  }
+
+  auto &queries = qtfile.get_queries();
+
+  // Streaming mode. Queries are extracted in run order as they are read from
+  // stdin, and the rows of each query are flushed to stdout before the next
+  // query is read, so only one query is held in memory at a time.
+  if (stream) {
+    std::ios::sync_with_stdio(false);
+    FeatureWriter writer(std::cout, async_output);
+    std::ostream out(&writer);
+
+    std::unordered_map<std::string, query_train *> query_ids;
+    for (auto &qry : queries) {
+      query_ids.emplace(qry.id, &qry);
+    }
+
+    WorkerSet workers = make_workers();
+    trec_run_stream run(std::cin);
+    trec_run_group group;
+    Candidates cands;
+    FeatureBuffer rows;
+    while (run.next(group)) {
+      query_train inline_qry;
+      query_train *qry = nullptr;
+      if (inline_query) {
+        inline_qry =
+            query_train_file::parse_line(group.id + ";" + group.query, lexicon);
+        qry = &inline_qry;
+      } else {
+        auto it = query_ids.find(group.id);
+        if (it == query_ids.end()) {
+          std::cerr << "qid: " << group.id << " is not in " << query_file
+                    << ", skipped" << std::endl;
+          continue;
+        }
+        qry = it->second;
+      }
+
+      std::swap(cands.docnos, group.docnos);
+      std::swap(cands.labels, group.labels);
+      std::swap(cands.stage0_scores, group.scores);
+      resolve_docids(cands);
+      rows.clear();
+      extract_query(workers, *qry, cands, rows);
+      out << rows;
+      out.flush();
+    }
+    write_reports();
+    return 0;
   }
+
+  // Rows are formatted into a `FeatureBuffer` per query and written through a
+  // `FeatureWriter`, rather than formatting each value with `outfile`.
+  FeatureWriter writer(outfile, async_output);
+  std::ostream out(&writer);
+
+  if (threads <= 1) {
+    WorkerSet workers = make_workers();
+    FeatureBuffer rows;
+    for (auto &qry : queries) {
+      rows.clear();
+      extract_query(workers, qry, run_candidates(qry), rows);
+      out << rows;
+      out.flush();
+    }
+    write_reports();
+    return 0;
+  }
+
+  // Query-parallel extraction. Queries are handed out in order to whichever
+  // worker is free, since the number of candidates per query varies a lot.
+  // The rows for each query are formatted into a private buffer and written
+  // in query file order, so the output is identical to a serial run. A worker
+  // only starts a query within `threads` of the next one to write, so a slow
+  // query holds back at most a query's rows for each other worker.
+  std::cerr << "Extracting with " << threads << " threads" << std::endl;
+  std::atomic<size_t> next_query(0);
+  ReorderBuffer reorder(out, threads);
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; ++t) {
+    pool.emplace_back([&]() {
+      WorkerSet workers = make_workers();
+      for (size_t pos = next_query++; pos < queries.size();
+           pos = next_query++) {
+        reorder.wait(pos);
+        FeatureBuffer rows;
+        extract_query(workers, queries[pos], run_candidates(queries[pos]),
+                      rows);
+        reorder.write(pos, rows.release());
+      }
+    });
+  }
+  for (auto &th : pool) {
+    th.join();
+  }
+  writer.close();
+  write_reports();
+
   return 0;
 }
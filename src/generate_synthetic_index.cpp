@@ -0,0 +1,407 @@
+/*
+ * Copyright 2020 The Fxt authors.
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this source code.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CLI/CLI.hpp"
+#include "cereal/archives/binary.hpp"
+#include "cereal/types/map.hpp"
+
+#include "fxt/doc_lens.hpp"
+#include "fxt/docno_store.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/index_codecs.hpp"
+#include "fxt/inverted_index.hpp"
+#include "fxt/lexicon.hpp"
+#include "fxt/mapped_forward_index.hpp"
+#include "fxt/static_feature.hpp"
+#include "fxt/synthetic_corpus.hpp"
+#include "fxt/util.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Write a Fxt index of a `SyntheticDocuments` collection, with the same files
+ * as `indexer` and `generate_static_doc_features`, and a matching query file
+ * and labelled run.
+ *
+ * Only one document is held in memory at a time. Vectors are written as
+ * cereal would write them, a length followed by the elements, so that they
+ * can be streamed. The inverted index is built in blocks of term ids that fit
+ * in `postings_memory`, and the documents are generated again for each
+ * block.
+ */
+class SyntheticIndexWriter {
+  const std::string sep = "/";  // assume unix like filesystem
+  const std::string lexicon_file = "lexicon";
+  const std::string doclen_file = "doclen";
+  const std::string fwdidx_file = "forward_index";
+  const std::string fwdidx_mmap_file = "forward_index.mmap";
+  const std::string invidx_file = "inverted_index";
+  const std::string static_doc_file = "static_doc";
+  const std::string docno_file = "docnos";
+  const std::string field_id_file = "field_ids";
+  const std::string query_file = "queries";
+  const std::string run_file = "run";
+
+  struct Candidate {
+    double score;
+    uint32_t docid;
+    bool operator>(const Candidate &other) const {
+      return score > other.score ||
+             (score == other.score && docid < other.docid);
+    }
+  };
+  // Min heap of the best candidates of a query
+  using Candidates = std::priority_queue<Candidate, std::vector<Candidate>,
+                                         std::greater<Candidate>>;
+
+  const SyntheticDocuments &docs;
+  std::string outpath;
+  // The codecs that documents and posting lists are compressed with
+  std::shared_ptr<const StreamCodecs> codecs;
+  size_t num_fields;
+  std::vector<Counts> term_counts;
+  // `field_counts[t * num_fields + f - 1]` are the counts of term `t` in field
+  // id `f`
+  std::vector<Counts> field_counts;
+  uint64_t total_terms = 0;
+
+  std::string path(const std::string &file) const {
+    return outpath + sep + file;
+  }
+
+ public:
+  SyntheticIndexWriter(const SyntheticDocuments &d, const std::string &p,
+                       std::shared_ptr<const StreamCodecs> c)
+      : docs(d),
+        outpath(p),
+        codecs(std::move(c)),
+        num_fields(d.field_ids.size()),
+        term_counts(d.options().vocab_size + 1),
+        field_counts((d.options().vocab_size + 1) * num_fields) {}
+
+  // Write the forward index, document lengths, static document features and
+  // docnos, while counting the terms for the lexicon. The `num_queries`
+  // queries of `query_len` terms are written with a run of the `run_depth`
+  // documents that match the most query terms.
+  void documents(size_t num_queries, size_t query_len, uint32_t query_seed,
+                 size_t run_depth) {
+    std::ofstream fwd_os(path(fwdidx_file), std::ios::binary);
+    codecs->names().write_header(fwd_os);
+    cereal::BinaryOutputArchive fwd_archive(fwd_os);
+    std::ofstream len_os(path(doclen_file), std::ios::binary);
+    cereal::BinaryOutputArchive len_archive(len_os);
+    std::ofstream stat_os(path(static_doc_file), std::ios::binary);
+    cereal::BinaryOutputArchive stat_archive(stat_os);
+    MappedForwardIndexWriter mapped(path(fwdidx_mmap_file), docs.size() + 1,
+                                    codecs->names());
+
+    // `query_terms[t]` are the queries that contain term `t`
+    std::unordered_map<uint32_t, std::vector<uint32_t>> query_terms;
+    std::vector<std::string> query_lines;
+    {
+      std::ofstream os(path(query_file));
+      for (size_t i = 0; i < num_queries; ++i) {
+        query_lines.push_back(docs.query_line(i, query_len, query_seed));
+        os << query_lines.back() << "\n";
+        std::istringstream iss(query_lines.back().substr(
+            query_lines.back().find(';') + 1));
+        std::string term;
+        while (iss >> term) {
+          query_terms[std::stoul(term.substr(1))].push_back(i);
+        }
+      }
+    }
+    std::vector<Candidates> candidates(num_queries);
+    std::vector<double> scores(num_queries);
+    std::vector<uint32_t> scored;
+
+    // Padding document zero, as in `indexer`
+    size_t len = docs.size() + 1;
+    Document zero(0);
+    fwd_archive(len, zero);
+    mapped.add(zero);
+    len_archive(len, size_t(0));
+    stat_archive(len, StaticFeature());
+
+    std::vector<std::pair<std::string, uint32_t>> docnos;
+    docnos.reserve(docs.size());
+    ProgressPresenter pp(docs.size(), 1, 10000, "documents: ");
+    for (size_t docid = 1; docid <= docs.size(); ++docid) {
+      auto terms = docs.terms(docid);
+      SyntheticDocuments::FieldFreqs field_freqs;
+      Document doc = docs.document(docid, terms, &field_freqs);
+
+      for (const auto &ff : field_freqs) {
+        for (const auto &f : ff.second) {
+          auto &fc = field_counts[f.first * num_fields + ff.first - 1];
+          fc.document_count += 1;
+          fc.term_count += f.second;
+        }
+      }
+      for (uint32_t t : doc.unique_terms()) {
+        uint32_t f = doc.freq(t);
+        term_counts[t].document_count += 1;
+        term_counts[t].term_count += f;
+
+        auto it = query_terms.find(t);
+        if (it == query_terms.end()) {
+          continue;
+        }
+        // Saturating term frequency, a BM25 without the IDF which is not
+        // known yet
+        double norm = 1.2 * terms.size() / docs.options().doc_len;
+        for (auto q : it->second) {
+          if (0.0 == scores[q]) {
+            scored.push_back(q);
+          }
+          scores[q] += 1.0 + f / (f + norm);
+        }
+      }
+      for (auto q : scored) {
+        candidates[q].push({scores[q], uint32_t(docid)});
+        if (candidates[q].size() > run_depth) {
+          candidates[q].pop();
+        }
+        scores[q] = 0.0;
+      }
+      scored.clear();
+      total_terms += terms.size();
+
+      stat_archive(docs.static_feature(docid, terms));
+      len_archive(terms.size());
+      doc.compress(*codecs);
+      fwd_archive(doc);
+      mapped.add(doc);
+      docnos.emplace_back(docs.docno(docid), docid);
+      pp.progress();
+    }
+    mapped.finish();
+
+    {
+      std::ofstream os(path(docno_file), std::ios::binary);
+      cereal::BinaryOutputArchive archive(os);
+      DocnoStore store(std::move(docnos));
+      archive(store);
+    }
+    {
+      std::ofstream os(path(field_id_file), std::ios::binary);
+      cereal::BinaryOutputArchive archive(os);
+      archive(docs.field_ids);
+    }
+
+    // Labels go in the iteration column, as `script/label.awk` writes them.
+    // The higher a document is ranked, the more likely it is relevant.
+    std::ofstream os(path(run_file));
+    os << std::fixed << std::setprecision(6);
+    for (size_t q = 0; q < num_queries; ++q) {
+      std::vector<Candidate> ranked;
+      while (!candidates[q].empty()) {
+        ranked.push_back(candidates[q].top());
+        candidates[q].pop();
+      }
+      std::reverse(ranked.begin(), ranked.end());
+      SplitMix64 gen(query_seed, q);
+      std::string qid = query_lines[q].substr(0, query_lines[q].find(';'));
+      for (size_t r = 0; r < ranked.size(); ++r) {
+        double p = 0.5 / (1.0 + r / 10.0);
+        int label = std::bernoulli_distribution(p)(gen);
+        os << qid << " " << label << " " << docs.docno(ranked[r].docid)
+           << " " << r + 1 << " " << ranked[r].score << " synthetic\n";
+      }
+    }
+  }
+
+  // Write the lexicon from the counts of `documents`.
+  void lexicon() {
+    std::ofstream os(path(lexicon_file), std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+
+    Lexicon lexicon(Counts(docs.size(), total_terms));
+    for (size_t t = 1; t < term_counts.size(); ++t) {
+      FieldCounts fc;
+      for (const auto &f : docs.field_ids) {
+        fc[f.second] = field_counts[t * num_fields + f.second - 1];
+      }
+      lexicon.push_back(docs.term(t), term_counts[t], fc);
+    }
+    archive(lexicon);
+  }
+
+  // Write the inverted index in blocks of terms whose postings fit in
+  // `memory` bytes, generating the documents again for each block.
+  void inverted_index(size_t memory) {
+    std::ofstream os(path(invidx_file), std::ios::binary);
+    codecs->names().write_header(os);
+    cereal::BinaryOutputArchive archive(os);
+
+    size_t len = term_counts.size();
+    PostingList pl_oov(Lexicon::oov_str, Lexicon::oov_id);
+    pl_oov.coding_off();
+    archive(len, pl_oov);
+
+    size_t begin = 1;
+    while (begin < term_counts.size()) {
+      // A document and frequency for each posting
+      size_t end = begin;
+      size_t block_memory = 0;
+      do {
+        block_memory += term_counts[end].document_count * 8;
+        ++end;
+      } while (end < term_counts.size() &&
+               block_memory + term_counts[end].document_count * 8 <= memory);
+
+      std::vector<std::vector<uint32_t>> post_docs(end - begin);
+      std::vector<std::vector<uint32_t>> post_freqs(end - begin);
+      for (size_t t = begin; t < end; ++t) {
+        post_docs[t - begin].reserve(term_counts[t].document_count);
+        post_freqs[t - begin].reserve(term_counts[t].document_count);
+      }
+
+      std::ostringstream oss;
+      oss << "inverted index, terms " << begin << "-" << end - 1 << ": ";
+      ProgressPresenter pp(docs.size(), 1, 10000, oss.str());
+      for (size_t docid = 1; docid <= docs.size(); ++docid) {
+        auto terms = docs.terms(docid);
+        std::sort(terms.begin(), terms.end());
+        for (size_t i = 0; i < terms.size();) {
+          size_t j = i;
+          while (j < terms.size() && terms[j] == terms[i]) {
+            ++j;
+          }
+          if (terms[i] >= begin && terms[i] < end) {
+            post_docs[terms[i] - begin].push_back(docid);
+            post_freqs[terms[i] - begin].push_back(j - i);
+          }
+          i = j;
+        }
+        pp.progress();
+      }
+
+      for (size_t t = begin; t < end; ++t) {
+        PostingList pl(docs.term(t), term_counts[t].term_count, codecs);
+        pl.set(post_docs[t - begin], post_freqs[t - begin]);
+        archive(pl);
+      }
+      begin = end;
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+  std::string index_path;
+  SyntheticCorpusOptions opts;
+  std::string length_dist = "uniform";
+  size_t num_queries = 50;
+  size_t query_len = 3;
+  uint32_t query_seed = 7;
+  size_t run_depth = 100;
+  size_t postings_memory = 1024;
+  std::vector<std::string> codec_args;
+
+  CLI::App app{"Generate a synthetic Fxt index."};
+  app.add_option("index", index_path, "Output directory")->required();
+  app.add_option("--docs", opts.num_docs, "Number of documents (1000)");
+  app.add_option("--vocab", opts.vocab_size, "Vocabulary size (20000)");
+  app.add_option("--zipf", opts.zipf,
+                 "Exponent of the Zipfian term distribution (1.0)");
+  app.add_option("--doc_len", opts.doc_len, "Mean document length (500)");
+  app.add_option("--length_dist", length_dist,
+                 "Document length distribution: uniform (the default), "
+                 "lognormal or fixed");
+  app.add_option("--doc_len_sigma", opts.doc_len_sigma,
+                 "Shape of the lognormal length distribution (0.5)");
+  app.add_option("--title_len", opts.title_len, "Terms in the title (8)");
+  app.add_option("--headings", opts.headings, "Headings per document (4)");
+  app.add_option("--heading_len", opts.heading_len,
+                 "Terms in a heading (4)");
+  app.add_option("--anchors", opts.anchors, "Anchors per document (8)");
+  app.add_option("--anchor_len", opts.anchor_len, "Terms in an anchor (3)");
+  app.add_option("--inlink_len", opts.inlink_len,
+                 "Terms of inlink text (16)");
+  app.add_option("--seed", opts.seed, "Collection seed (42)");
+  app.add_option("--queries", num_queries, "Number of queries (50)");
+  app.add_option("--query_len", query_len, "Terms per query (3)");
+  app.add_option("--query_seed", query_seed, "Query seed (7)");
+  app.add_option("--run_depth", run_depth,
+                 "Documents per query in the run (100)");
+  app.add_option("--postings_memory", postings_memory,
+                 "Memory for postings while building the inverted index, in "
+                 "MB (1024)");
+  app.add_option("--codec", codec_args,
+                 "Codec of an index stream, as <stream>=<codec>, see "
+                 "`indexer`");
+  CLI11_PARSE(app, argc, argv);
+
+  std::shared_ptr<const StreamCodecs> codecs;
+  try {
+    IndexCodecs names;
+    for (const auto &arg : codec_args) {
+      names.set(arg);
+    }
+    codecs = std::make_shared<const StreamCodecs>(names);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "error " << e.what() << std::endl;
+    return 1;
+  }
+
+  if ("uniform" == length_dist) {
+    opts.length_dist = LengthDistribution::uniform;
+  } else if ("lognormal" == length_dist) {
+    opts.length_dist = LengthDistribution::lognormal;
+  } else if ("fixed" == length_dist) {
+    opts.length_dist = LengthDistribution::fixed;
+  } else {
+    std::cerr << "error unknown length distribution: " << length_dist
+              << std::endl;
+    return 1;
+  }
+  if (0 == opts.num_docs || 0 == opts.vocab_size || 0 == opts.doc_len) {
+    std::cerr << "error --docs, --vocab and --doc_len must be positive"
+              << std::endl;
+    return 1;
+  }
+  if (opts.num_docs >= UINT32_MAX) {
+    std::cerr << "error docids are 32 bit" << std::endl;
+    return 1;
+  }
+
+  if (fs::exists(index_path)) {
+    std::cerr << "error index path exists" << std::endl;
+    return 1;
+  }
+
+  if (!fs::create_directory(index_path)) {
+    std::cerr << "error creating directory" << std::endl;
+    return 1;
+  }
+
+  // 1. Forward index, document lengths, static features, docnos, field ids,
+  //    queries and run
+  // 2. Lexicon
+  // 3. Inverted index
+  SyntheticDocuments docs(opts);
+  SyntheticIndexWriter writer(docs, index_path, codecs);
+  writer.documents(num_queries, query_len, query_seed, run_depth);
+  writer.lexicon();
+  writer.inverted_index(postings_memory << 20);
+
+  return 0;
+}
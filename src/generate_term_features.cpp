@@ -49,9 +49,8 @@ int main(int argc, char **argv) {
     auto start = clock::now();
 
     // load inv_idx
-    std::ifstream ifs_inv(inverted_index_file);
-    cereal::BinaryInputArchive iarchive_inv(ifs_inv);
-    iarchive_inv(inv_idx);
+    std::ifstream ifs_inv(inverted_index_file, std::ios::binary);
+    read_inverted_index(ifs_inv, inv_idx);
 
     auto stop = clock::now();
     auto load_time =
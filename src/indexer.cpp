@@ -5,21 +5,31 @@
  * that was distributed with this source code.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <utility>
 
+#include "CLI/CLI.hpp"
 #include "cereal/archives/binary.hpp"
+#include "cereal/types/map.hpp"
+#include "indri/CompressedCollection.hpp"
 #include "indri/QueryEnvironment.hpp"
 #include "indri/Repository.hpp"
 
 #include "fxt/doc_lens.hpp"
+#include "fxt/docno_store.hpp"
+#include "fxt/field_id.hpp"
 #include "fxt/field_map.hpp"
 #include "fxt/forward_index.hpp"
 #include "fxt/forward_index_interactor.hpp"
+#include "fxt/index_codecs.hpp"
 #include "fxt/inverted_index.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/mapped_forward_index.hpp"
 #include "fxt/util.hpp"
 
 namespace fs = std::filesystem;
@@ -51,14 +61,71 @@ class IndexerInteractor {
   const std::string lexicon_file = "lexicon";
   const std::string doclen_file = "doclen";
   const std::string fwdidx_file = "forward_index";
+  const std::string fwdidx_mmap_file = "forward_index.mmap";
   const std::string invidx_file = "inverted_index";
-  const IndriIndexAdapter &indri;
+  const std::string docno_file = "docnos";
+  const std::string field_id_file = "field_ids";
+  IndriIndexAdapter &indri;
   std::string outpath;
+  // The codecs that documents and posting lists are compressed with
+  std::shared_ptr<const StreamCodecs> codecs =
+      std::make_shared<const StreamCodecs>();
+
+  // Build the uncompressed document `docid` from its Indri term list.
+  Document document(size_t docid, indri::index::TermList *list,
+                    FieldMap &fields) {
+    ForwardIndexInteractor interactor;
+    auto &doc_terms = list->terms();
+    auto &doc_fields = list->fields();
+    Document document(docid);
+
+    std::vector<uint32_t> terms(doc_terms.begin(), doc_terms.end());
+    document.set_terms(terms);
+
+    std::unordered_map<uint16_t, std::vector<indri::index::FieldExtent>>
+        fid_extentlist;
+    for (auto &f : doc_fields) {
+      if (fields.get().find(indri.index->field(f.id)) != fields.get().end()) {
+        fid_extentlist[f.id].push_back(f);
+      }
+    }
+
+    std::vector<uint16_t> fv;
+    for (auto &f : fields.get()) {
+      fv.push_back(f.second);
+    }
+    document.set_fields(fv);
+
+    std::unordered_map<size_t, std::unordered_map<uint32_t, uint32_t>>
+        field_freqs;
+    for (const auto &curr : fid_extentlist) {
+      for (const auto &f : curr.second) {
+        auto d_len = f.end - f.begin;
+        interactor.process_field_len(document, f.id, d_len);
+        interactor.process_field_len_sum_sqrs(document, f.id, d_len);
+        interactor.process_field_max_len(document, f.id, d_len);
+        interactor.process_field_min_len(document, f.id, d_len);
+        document.set_tag_count(f.id, document.tag_count(f.id) + 1);
+
+        for (size_t i = f.begin; i < f.end; ++i) {
+          field_freqs[f.id][doc_terms[i]] += 1;
+        }
+      }
+    }
+    for (auto &&freq : field_freqs) {
+      document.set_field_freqs(freq.first, freq.second);
+    }
+    return document;
+  }
 
  public:
-  IndexerInteractor(const IndriIndexAdapter &index, const std::string path)
+  IndexerInteractor(IndriIndexAdapter &index, const std::string path)
       : indri(index), outpath(path) {}
 
+  void set_codecs(std::shared_ptr<const StreamCodecs> c) {
+    codecs = std::move(c);
+  }
+
   // Build the lexicon and serialize to file.
   void lexicon() {
     std::string outfile =
@@ -128,13 +195,72 @@ class IndexerInteractor {
     archive(doc_lens);
   }
 
+  // Sample the streams of about `num_docs` documents and `num_terms` posting
+  // lists, spread evenly over the collection, to choose their codecs.
+  CodecSample sample(size_t num_docs, size_t num_terms) {
+    CodecSample sample;
+    FieldMap fields;
+    fields.insert(*indri.index, _fields);
+
+    size_t step = std::max<size_t>(
+        1, indri.index->documentCount() / std::max<size_t>(1, num_docs));
+    ProgressPresenter pp(indri.index->documentCount(),
+                         indri.index->documentBase(), 10000,
+                         "codec sample, documents: ");
+    indri::index::TermListFileIterator *iter =
+        indri.index->termListFileIterator();
+    iter->startIteration();
+    for (size_t docid = 1; !iter->finished(); ++docid) {
+      if (0 == (docid - 1) % step) {
+        sample.add(document(docid, iter->currentEntry(), fields));
+      }
+      pp.progress();
+      iter->nextEntry();
+    }
+    delete iter;
+
+    step = std::max<size_t>(
+        1, indri.index->uniqueTermCount() / std::max<size_t>(1, num_terms));
+    ProgressPresenter pp_terms(indri.index->uniqueTermCount(), 1, 10000,
+                               "codec sample, posting lists: ");
+    indri::index::DocListFileIterator *list_iter =
+        indri.index->docListFileIterator();
+    list_iter->startIteration();
+    for (size_t n = 0; !list_iter->finished(); ++n) {
+      if (0 == n % step) {
+        indri::index::DocListFileIterator::DocListData *entry =
+            list_iter->currentEntry();
+        std::vector<uint32_t> docs;
+        std::vector<uint32_t> freqs;
+        entry->iterator->startIteration();
+        while (!entry->iterator->finished()) {
+          indri::index::DocListIterator::DocumentData *doc =
+              entry->iterator->currentEntry();
+          docs.push_back(doc->document);
+          freqs.push_back(doc->positions.size());
+          entry->iterator->nextEntry();
+        }
+        sample.add(std::move(docs), freqs);
+      }
+      pp_terms.progress();
+      list_iter->nextEntry();
+    }
+    delete list_iter;
+    return sample;
+  }
+
   // Construct a document forward index with positional and field information.
+  // The documents are written both as a cereal archive and as a mapped forward
+  // index, see `MappedForwardIndex`. Both record the codecs of the documents.
   void forward_index() {
     std::string outfile = outpath + std::string(sep) + std::string(fwdidx_file);
     std::ofstream os(outfile, std::ios::binary);
+    codecs->names().write_header(os);
     cereal::BinaryOutputArchive archive(os);
+    MappedForwardIndexWriter mapped(
+        outpath + std::string(sep) + std::string(fwdidx_mmap_file),
+        indri.index->documentCount() + 1, codecs->names());
 
-    ForwardIndexInteractor interactor;
     FieldMap fields;
     fields.insert(*indri.index, _fields);
 
@@ -149,6 +275,7 @@ class IndexerInteractor {
 
       archive(len);
       archive(zero);
+      mapped.add(zero);
     }
 
     ProgressPresenter pp(indri.index->documentCount(),
@@ -159,64 +286,63 @@ class IndexerInteractor {
     iter->startIteration();
 
     while (!iter->finished()) {
-      indri::index::TermList *list = iter->currentEntry();
-      auto &doc_terms = list->terms();
-      auto &doc_fields = list->fields();
-      Document document(docid++);
-
-      std::vector<uint32_t> terms(doc_terms.begin(), doc_terms.end());
-      document.set_terms(terms);
-
-      std::unordered_map<uint16_t, std::vector<indri::index::FieldExtent>>
-          fid_extentlist;
-      for (auto &f : doc_fields) {
-        if (fields.get().find(indri.index->field(f.id)) != fields.get().end()) {
-          fid_extentlist[f.id].push_back(f);
-        }
-      }
-
-      std::vector<uint16_t> fv;
-      for (auto &f : fields.get()) {
-        fv.push_back(f.second);
-      }
-      document.set_fields(fv);
-
-      std::unordered_map<size_t, std::unordered_map<uint32_t, uint32_t>>
-          field_freqs;
-      for (const auto &curr : fid_extentlist) {
-        for (const auto &f : curr.second) {
-          auto d_len = f.end - f.begin;
-          interactor.process_field_len(document, f.id, d_len);
-          interactor.process_field_len_sum_sqrs(document, f.id, d_len);
-          interactor.process_field_max_len(document, f.id, d_len);
-          interactor.process_field_min_len(document, f.id, d_len);
-          document.set_tag_count(f.id, document.tag_count(f.id) + 1);
-
-          for (size_t i = f.begin; i < f.end; ++i) {
-            field_freqs[f.id][doc_terms[i]] += 1;
-          }
-        }
-      }
-      for (auto &&freq : field_freqs) {
-        for (auto &&f : freq.second) {
-          document.set_freq(freq.first, f.first, f.second);
-        }
-      }
-
-      document.compress();
+      Document document = this->document(docid++, iter->currentEntry(), fields);
+      document.compress(*codecs);
       archive(document);
+      mapped.add(document);
       pp.progress();
       iter->nextEntry();
     }
 
     delete iter;
+    mapped.finish();
+  }
+
+  // Map the document names to docids, so that the extractor can resolve the
+  // docnos of a run without the Indri metadata index.
+  void docnos() {
+    std::string outfile = outpath + std::string(sep) + std::string(docno_file);
+    std::ofstream os(outfile, std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+
+    indri::collection::CompressedCollection *collection =
+        indri.repo.collection();
+    size_t base = indri.index->documentBase();
+    size_t total = indri.index->documentCount();
+    ProgressPresenter pp(total, base, 10000, "docnos: ");
+
+    std::vector<std::pair<std::string, uint32_t>> docnos;
+    docnos.reserve(total);
+    for (size_t docid = base; docid < base + total; ++docid) {
+      docnos.emplace_back(collection->retrieveMetadatum(docid, "docno"),
+                          docid);
+      pp.progress();
+    }
+
+    DocnoStore store(std::move(docnos));
+    archive(store);
+  }
+
+  // Serialize the ids of all the fields in the Indri index.
+  void field_ids() {
+    std::string outfile =
+        outpath + std::string(sep) + std::string(field_id_file);
+    std::ofstream os(outfile, std::ios::binary);
+    cereal::BinaryOutputArchive archive(os);
+
+    FieldIdMap field_ids;
+    int id = 1;
+    while ("" != indri.index->field(id)) {
+      field_ids[indri.index->field(id)] = id;
+      ++id;
+    }
+    archive(field_ids);
   }
 
   // Build an inverted index with compression and serialize to file.
   void inverted_index() {
     std::string outfile = outpath + std::string(sep) + std::string(invidx_file);
     std::ofstream os(outfile, std::ios::binary);
-    cereal::BinaryOutputArchive writer(os);
     ProgressPresenter pp(indri.index->uniqueTermCount(), 1, 10000,
                          "inverted index: ");
 
@@ -246,7 +372,7 @@ class IndexerInteractor {
       entry->iterator->startIteration();
       indri::index::TermData *termData = entry->termData;
 
-      PostingList pl(termData->term, termData->corpus.totalCount);
+      PostingList pl(termData->term, termData->corpus.totalCount, codecs);
       std::vector<uint32_t> docs;
       std::vector<uint32_t> freqs;
 
@@ -265,18 +391,55 @@ class IndexerInteractor {
     }
     delete iter;
 
-    writer(inverted_index);
+    write_inverted_index(os, inverted_index, *codecs);
   }
 };
 
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cerr << "usage: " << argv[0] << " <indri_index> <index>" << std::endl;
+  std::string indri_path;
+  std::string index_path;
+  std::vector<std::string> codec_args;
+  bool auto_codec = false;
+  double size_target = 1.1;
+  size_t sample_docs = 10000;
+  size_t sample_terms = 10000;
+
+  CLI::App app{"Convert an Indri index to a Fxt index."};
+  app.add_option("indri_index", indri_path, "Indri index")->required();
+  app.add_option("index", index_path, "Output directory")->required();
+  app.add_option("--codec", codec_args,
+                 "Codec of an index stream, as <stream>=<codec>, where the "
+                 "streams are unique_terms, terms, freqs, field_freqs, "
+                 "posting_docs and posting_freqs. Document streams only "
+                 "take codecs that keep no scratch state");
+  app.add_flag("--auto_codec,--auto-codec", auto_codec,
+               "Choose the fastest decoding codec of each stream whose size "
+               "is within --size_target of the smallest, on a sample of the "
+               "collection");
+  app.add_option("--size_target", size_target,
+                 "Size allowed for --auto_codec, relative to the smallest "
+                 "codec (1.1)");
+  app.add_option("--sample_docs", sample_docs,
+                 "Documents sampled by --auto_codec (10000)");
+  app.add_option("--sample_terms", sample_terms,
+                 "Posting lists sampled by --auto_codec (10000)");
+  CLI11_PARSE(app, argc, argv);
+
+  IndexCodecs codecs;
+  try {
+    for (const auto &arg : codec_args) {
+      codecs.set(arg);
+    }
+    // Throws for a codec FastPFor does not have
+    StreamCodecs{codecs};
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "error " << e.what() << std::endl;
+    return 1;
+  }
+  if (size_target < 1.0) {
+    std::cerr << "error --size_target must be at least 1" << std::endl;
     return 1;
   }
-
-  std::string indri_path = argv[1];
-  std::string index_path = argv[2];
 
   if (fs::exists(index_path)) {
     std::cerr << "error index path exists" << std::endl;
@@ -291,15 +454,29 @@ int main(int argc, char **argv) {
   IndriIndexAdapter indri;
   indri.open(indri_path);
 
+  // 0. Choose codecs
   // 1. Build lexicon
   // 2. Document lengths
   // 3. Forward index
   // 4. Inverted index
+  // 5. Docnos and field ids
   IndexerInteractor indexer(indri, index_path);
+  if (auto_codec) {
+    codecs = choose_codecs(indexer.sample(sample_docs, sample_terms),
+                           size_target);
+  }
+  indexer.set_codecs(std::make_shared<const StreamCodecs>(codecs));
+  for (size_t s = 0; s < num_index_streams; ++s) {
+    std::cerr << index_stream_name(IndexStream(s)) << " codec: "
+              << codecs.names[s] << std::endl;
+  }
+
   indexer.lexicon();
   indexer.document_length();
   indexer.forward_index();
   indexer.inverted_index();
+  indexer.docnos();
+  indexer.field_ids();
 
   return 0;
 }
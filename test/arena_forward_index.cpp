@@ -0,0 +1,143 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
+#include "fxt/arena_forward_index.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+static SyntheticCorpusOptions small_corpus() {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 20;
+  opts.doc_len = 50;
+  opts.vocab_size = 40;
+  return opts;
+}
+
+static void require_same_view(const DocumentView &expected,
+                              const DocumentView &view,
+                              const FieldIdMap &field_ids) {
+  REQUIRE(expected.id() == view.id());
+  REQUIRE(expected.length() == view.length());
+  REQUIRE(std::vector<uint32_t>(expected.terms().begin(),
+                                expected.terms().end()) ==
+          std::vector<uint32_t>(view.terms().begin(), view.terms().end()));
+  REQUIRE(std::vector<uint16_t>(expected.fields().begin(),
+                                expected.fields().end()) ==
+          std::vector<uint16_t>(view.fields().begin(), view.fields().end()));
+  for (uint32_t t : expected.unique_terms()) {
+    REQUIRE(expected.freq(t) == view.freq(t));
+    for (const auto &f : field_ids) {
+      REQUIRE(expected.freq(f.second, t) == view.freq(f.second, t));
+    }
+  }
+  for (const auto &f : field_ids) {
+    REQUIRE(expected.field_slot(f.second) == view.field_slot(f.second));
+    REQUIRE(expected.tag_count(f.second) == view.tag_count(f.second));
+    REQUIRE(expected.field_len(f.second) == view.field_len(f.second));
+    REQUIRE(expected.field_min_len(f.second) == view.field_min_len(f.second));
+    REQUIRE(expected.field_max_len(f.second) == view.field_max_len(f.second));
+    REQUIRE(expected.field_len_sum_sqrs(f.second) ==
+            view.field_len_sum_sqrs(f.second));
+  }
+}
+
+TEST_CASE("arena documents decode like the documents they were built from") {
+  SyntheticCorpus corpus(small_corpus());
+  ArenaForwardIndex arena(corpus.documents);
+  Document scratch;
+  DocumentView expected;
+  DocumentView view;
+
+  REQUIRE(corpus.documents.size() == arena.size());
+  REQUIRE(0 == arena.bytes() % sizeof(uint64_t));
+  for (size_t docid = 0; docid < arena.size(); ++docid) {
+    expected.decode(corpus.documents[docid]);
+    arena.decode(docid, view, scratch);
+    require_same_view(expected, view, corpus.field_ids);
+
+    const Document &doc = arena.get(docid, scratch);
+    REQUIRE(docid == doc.id());
+    REQUIRE(corpus.documents[docid].terms() == doc.terms());
+    REQUIRE(corpus.documents[docid].field_freqs() == doc.field_freqs());
+  }
+  REQUIRE_THROWS_AS(arena.get(arena.size(), scratch), std::out_of_range);
+  REQUIRE_THROWS_AS(arena.decode(arena.size(), view, scratch),
+                    std::out_of_range);
+}
+
+TEST_CASE("arena forward index loads a cereal archive") {
+  ForwardIndex fwdidx = {Document(0), Document(1)};
+  fwdidx[1].set_terms({3, 1, 3});
+  fwdidx[1].set_fields({2, 4});
+  fwdidx[1].set_freq(4, 3, 2);
+  fwdidx[1].set_field_len(4, 2);
+  fwdidx[1].set_tag_count(9, 1);
+  std::stringstream ss;
+  IndexCodecs().write_header(ss);
+  {
+    cereal::BinaryOutputArchive archive(ss);
+    archive(fwdidx);
+  }
+
+  ArenaForwardIndex arena(ss, ss.str().size());
+  Document scratch;
+  DocumentView view;
+  arena.decode(1, view, scratch);
+
+  REQUIRE(2 == arena.size());
+  REQUIRE(1 == view.id());
+  REQUIRE(3 == view.length());
+  REQUIRE(2 == view.freq(3));
+  REQUIRE(2 == view.freq(4, 3));
+  REQUIRE(0 == view.freq(2, 3));
+  REQUIRE(2 == view.field_len(4));
+  REQUIRE(1 == view.tag_count(9));
+  REQUIRE(0 == view.field_len(2));
+}
+
+TEST_CASE("arena converts an archive with dense field frequencies") {
+  // Written before the codec header, with a frequency for every unique term
+  std::stringstream ss;
+  {
+    cereal::BinaryOutputArchive archive(ss);
+    archive(size_t(2));
+    archive(Document(0));
+    archive(size_t(1), std::vector<uint16_t>{4}, size_t(0),
+            std::vector<uint32_t>{3, 1, 3}, std::vector<uint32_t>{1, 3},
+            std::vector<uint32_t>{1, 2},
+            std::vector<std::vector<uint32_t>>{{0, 2}},
+            std::map<uint16_t, Field>());
+  }
+
+  ArenaForwardIndex arena(ss);
+  Document scratch;
+  DocumentView view;
+  arena.decode(1, view, scratch);
+
+  REQUIRE(2 == view.freq(4, 3));
+  REQUIRE(0 == view.freq(4, 1));
+  REQUIRE(std::vector<uint32_t>({1, 2}) ==
+          arena.get(1, scratch).field_freqs()[0]);
+}
+
+TEST_CASE("views decoded from one arena stay independent") {
+  SyntheticCorpus corpus(small_corpus());
+  ArenaForwardIndex arena(corpus.documents);
+  Document scratch;
+  std::vector<DocumentView> views(3);
+  for (size_t i = 0; i < views.size(); ++i) {
+    arena.decode(i + 1, views[i], scratch);
+  }
+
+  DocumentView expected;
+  for (size_t i = 0; i < views.size(); ++i) {
+    expected.decode(corpus.documents[i + 1]);
+    require_same_view(expected, views[i], corpus.field_ids);
+  }
+}
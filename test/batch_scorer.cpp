@@ -0,0 +1,187 @@
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "fxt/batch_scorer.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/simd.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+#include "fxt/features/features.hpp"
+
+#include "fixture/term_weighting_families.hpp"
+
+namespace {
+
+/**
+ * Score every document of a synthetic corpus one at a time with the feature
+ * classes and in batches of `T` with `scorer`, and call
+ * `check(expected, actual)` for each score.
+ */
+template <typename T = double>
+void compare_batches(const BatchScorer &scorer,
+                     std::function<void(double, double)> check) {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 50;
+  opts.doc_len = 60;
+  opts.vocab_size = 100;
+  SyntheticCorpus corpus(opts);
+  // Unindexed fields are skipped
+  FieldIdMap field_ids = corpus.field_ids;
+  field_ids.erase("a");
+  query_train qry = query_train_file::parse_line(
+      "1;t1 t2 t3 t2 t7 t40 t99 not-a-term", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, field_ids, qry);
+
+  std::vector<QueryTermFreqs> freqs(opts.num_docs);
+  for (size_t d = 0; d < opts.num_docs; ++d) {
+    DocumentView doc;
+    doc.decode(corpus.documents[d + 1]);
+    freqs[d].gather(ctx, doc);
+  }
+
+  BasicScoreBatch<T> batch;
+  BasicBatchScores<T> scores;
+  for (const auto &family : fixture::term_weighting_families()) {
+    if (!family.batched()) {
+      continue;
+    }
+    // The last batch is not full
+    for (size_t first = 0; first < opts.num_docs;
+         first += ScoreBatch::width) {
+      size_t n = std::min(ScoreBatch::width, opts.num_docs - first);
+      batch.load(ctx, &freqs[first], n);
+      REQUIRE(n == batch.size());
+      scorer.score(ctx, batch, family.batch_family(), scores);
+      for (size_t j = 0; j < n; ++j) {
+        FeatureRow row = {};
+        family.compute(ctx, row, freqs[first + j], all_members);
+        for (size_t s = 0; s < ScoreBatch::slots; ++s) {
+          check(row[family.first + s], scores.score[s][j]);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST_CASE("simd log matches std::log") {
+  std::vector<double> xs = {1.0,
+                            2.0,
+                            0.5,
+                            M_SQRT2,
+                            1.0 + 1e-12,
+                            1.0 - 1e-12,
+                            3.0e-5,
+                            2500.0,
+                            1.0e300,
+                            std::numeric_limits<double>::denorm_min(),
+                            std::numeric_limits<double>::max()};
+  for (double x = 1e-3; x < 1e6; x *= 1.37) {
+    xs.push_back(x);
+  }
+  for (double x : xs) {
+    simd_f64x4 v = {x, x, x, x};
+    simd_log(v);
+    double expected = std::log(x);
+    REQUIRE(v[0] == Approx(expected).epsilon(1e-15).margin(1e-15));
+    REQUIRE(v[3] == v[0]);
+  }
+
+  simd_f64x4 v = {0.0, -1.0, HUGE_VAL, NAN};
+  simd_log(v);
+  REQUIRE(-HUGE_VAL == v[0]);
+  REQUIRE(std::isnan(v[1]));
+  REQUIRE(HUGE_VAL == v[2]);
+  REQUIRE(std::isnan(v[3]));
+}
+
+TEST_CASE("simd log of floats matches std::log") {
+  std::vector<float> xs = {1.0f,
+                           2.0f,
+                           0.5f,
+                           3.0e-5f,
+                           2500.0f,
+                           std::numeric_limits<float>::min(),
+                           std::numeric_limits<float>::denorm_min(),
+                           std::numeric_limits<float>::max()};
+  for (float x = 1e-3f; x < 1e6f; x *= 1.37f) {
+    xs.push_back(x);
+  }
+  for (float x : xs) {
+    simd_f32x8 v = {x, x, x, x, x, x, x, x};
+    simd_log(v);
+    float expected = std::log(x);
+    REQUIRE(v[0] == Approx(expected).epsilon(1e-6).margin(1e-6));
+    REQUIRE(v[7] == v[0]);
+  }
+
+  simd_f32x8 v = {0.0f, -1.0f, HUGE_VALF, NAN, 1.0f, 1.0f, 1.0f, 1.0f};
+  simd_log(v);
+  REQUIRE(-HUGE_VALF == v[0]);
+  REQUIRE(std::isnan(v[1]));
+  REQUIRE(HUGE_VALF == v[2]);
+  REQUIRE(std::isnan(v[3]));
+  REQUIRE(0.0f == v[4]);
+}
+
+TEST_CASE("simd levels") {
+  SimdLevel level = SimdLevel::scalar;
+  REQUIRE(parse_simd_level("avx2", level));
+  REQUIRE(SimdLevel::avx2 == level);
+  REQUIRE_FALSE(parse_simd_level("sse", level));
+  REQUIRE(SimdLevel::avx2 == level);
+  REQUIRE(simd_supported(SimdLevel::scalar));
+  REQUIRE(simd_supported(detect_simd_level()));
+
+  // Levels the CPU lacks fall back to the best one it has
+  BatchScorer scorer(SimdLevel::avx512);
+  REQUIRE(simd_supported(scorer.level()));
+}
+
+TEST_CASE("scalar batch scores match the feature classes") {
+  BatchScorer scorer(SimdLevel::scalar);
+  compare_batches(scorer, [](double expected, double actual) {
+    REQUIRE(expected == actual);
+  });
+}
+
+TEST_CASE("vector batch scores are within tolerance") {
+  for (auto level : {SimdLevel::avx2, SimdLevel::avx512}) {
+    if (!simd_supported(level)) {
+      continue;
+    }
+    INFO(simd_level_name(level));
+    BatchScorer scorer(level);
+    REQUIRE(level == scorer.level());
+    compare_batches(scorer, [](double expected, double actual) {
+      double scale = std::max(1.0, std::abs(expected));
+      REQUIRE(std::abs(expected - actual) <=
+              BatchScorer::tolerance * scale);
+    });
+  }
+}
+
+TEST_CASE("single precision batch scores are within float tolerance") {
+  for (auto level : {SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512}) {
+    if (!simd_supported(level)) {
+      continue;
+    }
+    INFO(simd_level_name(level));
+    BatchScorer scorer(level);
+    compare_batches<float>(scorer, [](double expected, double actual) {
+      double scale = std::max(1.0, std::abs(expected));
+      REQUIRE(std::abs(expected - actual) <=
+              BatchScorer::float_tolerance * scale);
+    });
+  }
+}
@@ -0,0 +1,72 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
+#include "fxt/docno_store.hpp"
+
+static DocnoStore make_store(size_t n) {
+  std::vector<std::pair<std::string, uint32_t>> docnos;
+  for (size_t i = 1; i <= n; ++i) {
+    docnos.emplace_back("clueweb09-en0000-" + std::to_string(i), i);
+  }
+  // The indexer adds documents in docid order, not docno order
+  std::swap(docnos.front(), docnos.back());
+  return DocnoStore(docnos);
+}
+
+TEST_CASE("docno store finds every docno") {
+  DocnoStore store = make_store(1000);
+  REQUIRE(1000 == store.size());
+
+  uint32_t docid = 0;
+  for (size_t i = 1; i <= 1000; ++i) {
+    REQUIRE(store.find("clueweb09-en0000-" + std::to_string(i), docid));
+    REQUIRE(i == docid);
+  }
+  REQUIRE_FALSE(store.find("clueweb09-en0000-0", docid));
+  REQUIRE_FALSE(store.find("clueweb09-en0000-1001", docid));
+  REQUIRE_FALSE(store.find("", docid));
+}
+
+TEST_CASE("docno store resolves docnos in order and skips missing ones") {
+  DocnoStore store = make_store(10);
+
+  auto docids = store.docids<int>(
+      {"clueweb09-en0000-7", "missing", "clueweb09-en0000-2",
+       "clueweb09-en0000-7"});
+
+  REQUIRE(std::vector<int>({7, 2, 7}) == docids);
+}
+
+TEST_CASE("empty docno store") {
+  DocnoStore store;
+  uint32_t docid = 0;
+
+  REQUIRE(0 == store.size());
+  REQUIRE_FALSE(store.find("doc-1", docid));
+  REQUIRE(store.docids<int>({"doc-1"}).empty());
+}
+
+TEST_CASE("docno store serialization") {
+  DocnoStore store = make_store(100);
+  std::stringstream ss;
+  {
+    cereal::BinaryOutputArchive archive(ss);
+    archive(store);
+  }
+  DocnoStore loaded;
+  {
+    cereal::BinaryInputArchive archive(ss);
+    archive(loaded);
+  }
+
+  REQUIRE(100 == loaded.size());
+  uint32_t docid = 0;
+  REQUIRE(loaded.find("clueweb09-en0000-42", docid));
+  REQUIRE(42 == docid);
+}
@@ -0,0 +1,93 @@
+#include "catch2/catch.hpp"
+
+#include <vector>
+
+#include "fxt/document_view.hpp"
+#include "fxt/forward_index.hpp"
+
+static Document compressed_doc(size_t id, const std::vector<uint32_t> &terms) {
+  Document doc(id);
+  doc.set_terms(terms);
+  doc.set_fields({2});
+  doc.set_freq(2, terms[0], 1);
+  doc.set_field_len(2, 1);
+  doc.compress();
+  return doc;
+}
+
+TEST_CASE("view of a compressed document matches decompress") {
+  Document doc = compressed_doc(3, {1, 5, 7, 7, 1, 1, 1});
+  Document copy = doc;
+  copy.decompress();
+  DocumentView view;
+
+  view.decode(doc);
+
+  REQUIRE(3 == view.id());
+  REQUIRE(copy.length() == view.length());
+  REQUIRE(copy.terms() == std::vector<uint32_t>(view.terms().begin(),
+                                                view.terms().end()));
+  REQUIRE(copy.unique_terms() ==
+          std::vector<uint32_t>(view.unique_terms().begin(),
+                                view.unique_terms().end()));
+  REQUIRE(4 == view.freq(1));
+  REQUIRE(2 == view.freq(7));
+  REQUIRE(0 == view.freq(42));
+  REQUIRE(1 == view.freq(2, 1));
+  REQUIRE(0 == view.freq(2, 7));
+  REQUIRE(1 == view.field_len(2));
+}
+
+TEST_CASE("view is reused between documents") {
+  Document long_doc = compressed_doc(1, {1, 2, 3, 4, 5, 6, 7, 8});
+  Document short_doc = compressed_doc(2, {9, 9});
+  DocumentView view;
+
+  view.decode(long_doc);
+  view.decode(short_doc);
+
+  REQUIRE(2 == view.id());
+  REQUIRE(2 == view.length());
+  REQUIRE(9 == view.terms()[0]);
+  REQUIRE(9 == view.terms()[1]);
+  REQUIRE(2 == view.freq(9));
+  REQUIRE(0 == view.freq(10));
+}
+
+TEST_CASE("view of an uncompressed document") {
+  Document doc(4);
+  doc.set_terms({10, 20, 10});
+  DocumentView view;
+
+  view.decode(doc);
+
+  REQUIRE(3 == view.length());
+  REQUIRE(20 == view.terms()[1]);
+  REQUIRE(2 == view.freq(10));
+}
+
+TEST_CASE("view only decodes the streams of its plan") {
+  Document doc = compressed_doc(5, {1, 5, 7, 7, 1});
+  DocumentView view;
+  DecodePlan plan;
+  plan.terms = false;
+  plan.all_fields = false;
+  view.set_plan(plan);
+
+  view.decode(doc);
+
+  REQUIRE(5 == view.length());
+  REQUIRE(view.terms().empty());
+  REQUIRE(3 == view.unique_terms().size());
+  REQUIRE(2 == view.freq(7));
+  REQUIRE(0 == view.freq(2, 1));
+  REQUIRE(1 == view.field_len(2));
+
+  plan.freqs = false;
+  plan.add_field(2);
+  view.set_plan(plan);
+  view.decode(doc);
+
+  REQUIRE(0 == view.freq(7));
+  REQUIRE(1 == view.freq(2, 1));
+}
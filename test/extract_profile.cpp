@@ -0,0 +1,85 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "fxt/extract_profile.hpp"
+
+TEST_CASE("profile timer records into a profile") {
+  ExtractProfile profile;
+  {
+    ProfileTimer timer(&profile, ProfileStage::sdm);
+  }
+  {
+    ProfileTimer timer(&profile, ProfileStage::sdm);
+  }
+
+  REQUIRE(2 == profile.calls(ProfileStage::sdm));
+  REQUIRE(0 == profile.calls(ProfileStage::bm25_atire));
+}
+
+TEST_CASE("profile timer without a profile") {
+  ProfileTimer timer(nullptr, ProfileStage::sdm);
+}
+
+TEST_CASE("profiles merge and clear") {
+  ExtractProfile a;
+  ExtractProfile b;
+  a.add(ProfileStage::decode, 100);
+  b.add(ProfileStage::decode, 50);
+  b.add(ProfileStage::output, 10);
+
+  a.merge(b);
+  REQUIRE(150 == a.ns(ProfileStage::decode));
+  REQUIRE(2 == a.calls(ProfileStage::decode));
+  REQUIRE(10 == a.ns(ProfileStage::output));
+
+  a.clear();
+  REQUIRE(0 == a.ns(ProfileStage::decode));
+  REQUIRE(0 == a.calls(ProfileStage::output));
+}
+
+TEST_CASE("profile report json") {
+  ExtractProfile profile;
+  profile.add(ProfileStage::bm25_atire, 1000000);
+  profile.add(ProfileStage::bm25_atire, 1000000);
+  ProfileReport report;
+  report.add_query("51", 2, 5.0, profile);
+  report.add_query("q\"2", 2, 3.0, profile);
+
+  std::ostringstream oss;
+  report.write_json(oss);
+  std::string json = oss.str();
+
+  REQUIRE(std::string::npos !=
+          json.find("{\"queries\": 2, \"docs\": 4, \"ms\": 8.000,"));
+  REQUIRE(std::string::npos !=
+          json.find("\"stages\": {\"bm25_atire\": {\"calls\": 4, \"ms\": "
+                    "4.000, \"docs_per_sec\": 1000.000}}"));
+  REQUIRE(std::string::npos !=
+          json.find("{\"id\": \"51\", \"docs\": 2, \"ms\": 5.000, "
+                    "\"stages\": {\"bm25_atire\": {\"calls\": 2, \"ms\": "
+                    "2.000}}}"));
+  REQUIRE(std::string::npos != json.find("\"id\": \"q\\\"2\""));
+  REQUIRE(std::string::npos == json.find("sdm"));
+}
+
+TEST_CASE("profile report without the per query breakdown") {
+  ExtractProfile profile;
+  profile.add(ProfileStage::bm25_atire, 1000000);
+  ProfileReport report(false);
+  for (int i = 0; i < 3; ++i) {
+    report.add_query("1", 1, 2.0, profile);
+  }
+
+  std::ostringstream oss;
+  report.write_json(oss);
+  std::string json = oss.str();
+
+  REQUIRE(std::string::npos !=
+          json.find("{\"queries\": 3, \"docs\": 3, \"ms\": 6.000,"));
+  REQUIRE(std::string::npos !=
+          json.find("\"stages\": {\"bm25_atire\": {\"calls\": 3, \"ms\": "
+                    "3.000, \"docs_per_sec\": 1000.000}}}\n"));
+  REQUIRE(std::string::npos == json.find("per_query"));
+}
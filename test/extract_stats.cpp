@@ -0,0 +1,47 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "fxt/extract_stats.hpp"
+
+TEST_CASE("extract stats count queries") {
+  ExtractStats stats;
+  stats.add_query(100, 2000);
+  stats.add_query(50, 1000);
+
+  REQUIRE(2 == stats.queries());
+  REQUIRE(150 == stats.docs());
+  REQUIRE(3000 == stats.output_bytes());
+  REQUIRE(ExtractStats::peak_rss_kb() > 0);
+}
+
+TEST_CASE("extract stats json") {
+  ExtractStats stats;
+  stats.add_load("lexicon", 12.5);
+  stats.add_load("forward_index", 100.0);
+  stats.add_query(100, 2000);
+  stats.add_query(100, 2000);
+
+  std::ostringstream oss;
+  oss << 1.5;
+  stats.write_json(oss, 500.0, 2, 1);
+  std::string json = oss.str().substr(3);
+
+  REQUIRE(0 ==
+          json.find("{\"schema\": 1, \"threads\": 2, \"doc_threads\": 1,"));
+  REQUIRE(json.find("\"load_ms\": {\"lexicon\": 12.500, "
+                    "\"forward_index\": 100.000}") != std::string::npos);
+  REQUIRE(json.find("\"queries\": 2, \"docs\": 200, \"extract_ms\": 500.000") !=
+          std::string::npos);
+  REQUIRE(json.find("\"queries_per_sec\": 4.000, \"docs_per_sec\": 400.000") !=
+          std::string::npos);
+  REQUIRE(json.find("\"output_bytes\": 4000, "
+                    "\"output_bytes_per_sec\": 8000.000") != std::string::npos);
+  REQUIRE(json.find("\"peak_rss_kb\": ") != std::string::npos);
+
+  // The stream format is restored
+  oss.str("");
+  oss << 1.5;
+  REQUIRE("1.5" == oss.str());
+}
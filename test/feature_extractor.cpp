@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "fxt/document_view.hpp"
+#include "fxt/feature_extractor.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/mapped_forward_index.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_positions.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/simd.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+namespace {
+
+/**
+ * `flags` with every member of each family that has one enabled, which the
+ * extractor used to compute whichever member was enabled.
+ */
+FeatureFlags whole_families(const FeatureFlags &flags) {
+  FeatureFlags whole = flags;
+  for (feature::Id first :
+       {feature::bm25_atire, feature::bm25_trec3, feature::bm25_trec3_kmax,
+        feature::lm_dir_2500, feature::lm_dir_1500, feature::lm_dir_1000,
+        feature::tfidf, feature::prob, feature::be, feature::dph, feature::dfr,
+        feature::stream_len, feature::sum_stream_len, feature::min_stream_len,
+        feature::max_stream_len, feature::mean_stream_len,
+        feature::variance_stream_len}) {
+    if (family_mask(flags, first).any()) {
+      std::fill_n(whole.begin() + first, feature::family_size, true);
+    }
+  }
+  if (flags[feature::bm25_bigram_u8] || flags[feature::bm25_tp_dist_w100]) {
+    whole[feature::bm25_bigram_u8] = true;
+    whole[feature::bm25_tp_dist_w100] = true;
+  }
+  // The query term counts are only extracted along with a tag count
+  const size_t end = feature::tag_embed_count + 1;
+  if (std::any_of(flags.begin() + feature::tag_title_count,
+                  flags.begin() + end, [](bool f) { return f; })) {
+    std::fill(whole.begin() + feature::tag_title_qry_count, whole.begin() + end,
+              true);
+  }
+  return whole;
+}
+
+class ExtractorTest {
+  SyntheticCorpus corpus;
+  query_train qry;
+  QueryContext ctx;
+  std::vector<DocumentView> docs;
+  std::vector<QueryTermPositions> positions;
+
+  static SyntheticCorpusOptions options() {
+    SyntheticCorpusOptions opts;
+    opts.num_docs = 40;
+    opts.doc_len = 60;
+    opts.vocab_size = 30;
+    return opts;
+  }
+
+ public:
+  ExtractorTest()
+      : corpus(options()),
+        qry(query_train_file::parse_line("1;t1 t2 t3 t2 t7 t20 not-a-term",
+                                         corpus.lexicon)),
+        ctx(corpus.lexicon, corpus.field_ids, qry),
+        docs(corpus.documents.size() - 1) {
+    for (size_t d = 0; d < docs.size(); ++d) {
+      docs[d].decode(corpus.documents[d + 1]);
+      positions.emplace_back(qry);
+      positions.back().build(docs[d].terms());
+    }
+  }
+
+  /**
+   * The features enabled by `flags` of each document, a document at a time
+   * or in batches, which are scored in single precision if
+   * `single_precision`. The documents are decoded with the decode plan of
+   * the extractor if `planned`.
+   */
+  std::vector<FeatureRow> extract(const FeatureFlags &flags, bool batched,
+                                  bool single_precision = false,
+                                  bool planned = false) {
+    FeatureExtractor fe(flags);
+    fe.set_simd_level(SimdLevel::scalar);
+    fe.set_single_precision(single_precision);
+    std::vector<DocumentView> planned_docs;
+    const DocumentView *views = docs.data();
+    if (planned) {
+      planned_docs.resize(docs.size());
+      for (size_t d = 0; d < docs.size(); ++d) {
+        planned_docs[d].set_plan(fe.decode_plan(ctx));
+        planned_docs[d].decode(corpus.documents[d + 1]);
+      }
+      views = planned_docs.data();
+    }
+    std::vector<FeatureRow> rows(docs.size());
+    for (auto &row : rows) {
+      row.fill(0.0);
+    }
+    for (size_t first = 0; first < docs.size();
+         first += ScoreBatch::width) {
+      size_t n = std::min(ScoreBatch::width, docs.size() - first);
+      if (batched) {
+        fe.extract_batch(ctx, &rows[first], &views[first], n);
+      }
+      for (size_t i = 0; i < n; ++i) {
+        size_t d = first + i;
+        if (batched) {
+          fe.extract_batched(ctx, i, rows[d], views[d], positions[d]);
+        } else {
+          fe.extract(ctx, rows[d], views[d], positions[d]);
+        }
+      }
+    }
+    return rows;
+  }
+
+  /**
+   * Check that the features enabled by `flags` are the same as when their
+   * whole families are enabled, and when only the streams of the decode plan
+   * are decoded.
+   */
+  void check(const FeatureFlags &flags) {
+    auto columns = enabled_features(flags);
+    for (bool batched : {false, true}) {
+      auto rows = extract(flags, batched);
+      auto expected = extract(whole_families(flags), batched);
+      auto planned = extract(flags, batched, false, true);
+      for (size_t d = 0; d < rows.size(); ++d) {
+        for (auto id : columns) {
+          INFO(feature::name(id) << (batched ? " batched" : ""));
+          REQUIRE(expected[d][id] == rows[d][id]);
+          REQUIRE(expected[d][id] == planned[d][id]);
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+TEST_CASE("features extracted on their own match their whole family") {
+  ExtractorTest test;
+  for (size_t id = feature::stage0_score + 1; id < feature::first_static;
+       ++id) {
+    if (feature::sdm == id) {
+      // not extracted by `FeatureExtractor`
+      continue;
+    }
+    FeatureFlags flags = {};
+    flags[id] = true;
+    if (id >= feature::tag_title_qry_count && id < feature::tag_title_count) {
+      flags[feature::tag_title_count] = true;
+    }
+    test.check(flags);
+  }
+}
+
+TEST_CASE("any features extracted together match their whole families") {
+  ExtractorTest test;
+  std::mt19937 gen(42);
+  std::bernoulli_distribution enable(0.1);
+  for (int i = 0; i < 20; ++i) {
+    FeatureFlags flags = {};
+    for (size_t id = feature::stage0_score + 1; id < feature::first_static;
+         ++id) {
+      flags[id] = feature::sdm != id && enable(gen);
+    }
+    test.check(flags);
+  }
+}
+
+TEST_CASE("single precision batches are within float tolerance") {
+  ExtractorTest test;
+  FeatureFlags flags;
+  flags.fill(true);
+  auto expected = test.extract(flags, false);
+  auto rows = test.extract(flags, true, true);
+  for (size_t d = 0; d < rows.size(); ++d) {
+    for (size_t id = 0; id < feature::first_static; ++id) {
+      INFO(feature::name(feature::Id(id)));
+      double scale = std::max(1.0, std::abs(expected[d][id]));
+      REQUIRE(std::abs(expected[d][id] - rows[d][id]) <=
+              BatchScorer::float_tolerance * scale);
+    }
+  }
+}
+
+TEST_CASE("decode plan only decodes the streams the features read") {
+  SyntheticCorpus corpus(SyntheticCorpusOptions{});
+  auto qry = query_train_file::parse_line("1;t1 t2", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, corpus.field_ids, qry);
+
+  FeatureFlags bm25 = {};
+  bm25[feature::bm25_atire] = true;
+  bm25[feature::bm25_atire_title] = true;
+  DecodePlan plan = FeatureExtractor(bm25).decode_plan(ctx);
+  REQUIRE_FALSE(plan.terms);
+  REQUIRE(plan.freqs);
+  REQUIRE_FALSE(plan.all_fields);
+  REQUIRE(std::vector<uint16_t>{uint16_t(ctx.field_id(1))} == plan.field_ids);
+
+  FeatureFlags prox = {};
+  prox[feature::bm25_tp_dist_w100] = true;
+  plan = FeatureExtractor(prox).decode_plan(ctx);
+  REQUIRE(plan.terms);
+  REQUIRE(plan.field_ids.empty());
+
+  // The stream features of a field only read its frequencies
+  FeatureFlags stream = {};
+  stream[feature::sum_stream_len + 2] = true;
+  plan = FeatureExtractor(stream).decode_plan(ctx);
+  REQUIRE_FALSE(plan.freqs);
+  REQUIRE(std::vector<uint16_t>{uint16_t(ctx.field_id(1))} == plan.field_ids);
+
+  FeatureFlags tags = {};
+  tags[feature::tag_heading_count] = true;
+  plan = FeatureExtractor(tags).decode_plan(ctx);
+  REQUIRE_FALSE(plan.terms);
+  REQUIRE_FALSE(plan.freqs);
+  REQUIRE(plan.field_ids.empty());
+}
+
+TEST_CASE("batches decoded from a mapped index match single documents") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 40;
+  opts.doc_len = 60;
+  opts.vocab_size = 30;
+  SyntheticCorpus corpus(opts);
+  auto qry = query_train_file::parse_line("1;t1 t2 t7 t20", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, corpus.field_ids, qry);
+  std::string path = "feature_extractor_mapped.tmp";
+  {
+    MappedForwardIndexWriter writer(path, corpus.documents.size());
+    for (const auto &doc : corpus.documents) {
+      writer.add(doc);
+    }
+    writer.finish();
+  }
+  MappedForwardIndex mapped(path);
+
+  FeatureFlags flags;
+  flags.fill(true);
+  FeatureExtractor fe(flags);
+  fe.set_simd_level(SimdLevel::scalar);
+  QueryTermPositions positions(qry);
+
+  // As the extractor does, with a scratch document for each document of the
+  // batch. Views decoded from what `get` fills point into the scratch
+  // document, as with readers that do not decode blobs in place.
+  std::vector<Document> batch_docs(ScoreBatch::width);
+  std::vector<DocumentView> batch_views(ScoreBatch::width);
+  std::vector<FeatureRow> batch_rows(ScoreBatch::width);
+  Document scratch;
+  DocumentView view;
+  for (size_t first = 1; first <= opts.num_docs; first += ScoreBatch::width) {
+    size_t n = std::min(ScoreBatch::width, opts.num_docs + 1 - first);
+    for (size_t j = 0; j < n; ++j) {
+      batch_views[j].decode(mapped.get(first + j, batch_docs[j]));
+      batch_rows[j].fill(0.0);
+    }
+    fe.extract_batch(ctx, batch_rows.data(), batch_views.data(), n);
+    for (size_t j = 0; j < n; ++j) {
+      positions.build(batch_views[j].terms());
+      fe.extract_batched(ctx, j, batch_rows[j], batch_views[j], positions);
+
+      mapped.decode(first + j, view, scratch);
+      positions.build(view.terms());
+      FeatureRow row = {};
+      fe.extract(ctx, row, view, positions);
+      for (size_t id = 0; id < feature::first_static; ++id) {
+        INFO(feature::name(feature::Id(id)) << " of " << first + j);
+        REQUIRE(row[id] == batch_rows[j][id]);
+      }
+    }
+  }
+  std::remove(path.c_str());
+}
@@ -0,0 +1,194 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "fxt/feature_presenter.hpp"
+#include "fxt/feature_writer.hpp"
+
+static std::string ostream_format(double v) {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(5) << v;
+  return oss.str();
+}
+
+static std::string buffer_format(double v) {
+  FeatureBuffer buf;
+  buf << v;
+  return std::string(buf.data(), buf.size());
+}
+
+TEST_CASE("feature buffer formats doubles like ostream") {
+  std::vector<double> values = {0.0,
+                                -0.0,
+                                1.0,
+                                -1.5,
+                                0.000005,
+                                0.0000049999,
+                                2.675,
+                                123456789.123456789,
+                                1e300,
+                                -1e-300,
+                                std::numeric_limits<double>::max(),
+                                std::numeric_limits<double>::infinity(),
+                                -std::numeric_limits<double>::infinity()};
+  for (double v : values) {
+    REQUIRE(ostream_format(v) == buffer_format(v));
+  }
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dist(-100.0, 100.0);
+  for (int i = 0; i < 10000; ++i) {
+    double v = dist(gen);
+    REQUIRE(ostream_format(v) == buffer_format(v));
+  }
+}
+
+TEST_CASE("feature buffer formats rows") {
+  FeatureBuffer buf;
+  std::string qid = "51";
+
+  buf << -1 << "," << qid << "," << std::string("doc-1") << "," << 0.5
+      << '\n';
+
+  REQUIRE("-1,51,doc-1,0.50000\n" == std::string(buf.data(), buf.size()));
+  REQUIRE("-1,51,doc-1,0.50000\n" == buf.release());
+  REQUIRE(buf.empty());
+}
+
+TEST_CASE("feature presenter writes the same to a buffer and a stream") {
+  FeatureRow row = {};
+  FeatureFlags flags = {};
+  row[feature::stage0_score] = 12.25;
+  row[feature::bm25_atire] = 3.0 / 7.0;
+  row[feature::tag_title_count] = 3;
+  row[feature::url_depth] = 2;
+  row[feature::tpscore] = 5;
+  // Columns are written in id order, whatever order they are enabled in
+  flags[feature::url_depth] = true;
+  flags[feature::tag_title_count] = true;
+  flags[feature::stage0_score] = true;
+  flags[feature::bm25_atire] = true;
+  auto columns = enabled_features(flags);
+  FeaturePresenter presenter(row, columns);
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(5) << presenter;
+  FeatureBuffer buf;
+  buf << presenter;
+
+  REQUIRE(",12.25000,0.42857,3.00000,2.00000" == oss.str());
+  REQUIRE(oss.str() == std::string(buf.data(), buf.size()));
+}
+
+TEST_CASE("binary rows hold float32 features") {
+  FeatureRow row = {};
+  FeatureFlags flags = {};
+  row[feature::bm25_atire] = 3.0 / 7.0;
+  row[feature::url_depth] = 2;
+  flags[feature::bm25_atire] = true;
+  flags[feature::url_depth] = true;
+  auto columns = enabled_features(flags);
+  FeatureBuffer buf;
+
+  write_binary_row(buf, -1, "51", "doc-1", FeaturePresenter(row, columns));
+
+  std::string bytes = buf.release();
+  const char *p = bytes.data();
+  auto next = [&](auto &v) {
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+  };
+  int32_t label;
+  uint32_t len;
+  next(label);
+  REQUIRE(-1 == label);
+  next(len);
+  REQUIRE("51" == std::string(p, len));
+  p += len;
+  next(len);
+  REQUIRE("doc-1" == std::string(p, len));
+  p += len;
+  next(len);
+  REQUIRE(2 == len);
+  float v;
+  next(v);
+  REQUIRE(float(3.0 / 7.0) == v);
+  next(v);
+  REQUIRE(2.0f == v);
+  REQUIRE(bytes.data() + bytes.size() == p);
+}
+
+TEST_CASE("float rows are presented as their float32 features") {
+  FeatureRow row = {};
+  FeatureFlags flags = {};
+  row[feature::stage0_score] = 12.25;
+  row[feature::bm25_atire] = 3.0 / 7.0;
+  row[feature::url_depth] = 2;
+  flags[feature::stage0_score] = true;
+  flags[feature::bm25_atire] = true;
+  flags[feature::url_depth] = true;
+  auto columns = enabled_features(flags);
+  FloatFeatureRow float_row;
+  std::copy(row.begin(), row.end(), float_row.begin());
+
+  FeatureBuffer text;
+  text << FloatFeaturePresenter(float_row, columns);
+  REQUIRE(",12.25000,0.42857,2.00000" ==
+          std::string(text.data(), text.size()));
+
+  FeatureBuffer binary;
+  write_binary_row(binary, -1, "51", "doc-1",
+                   FloatFeaturePresenter(float_row, columns));
+  FeatureBuffer expected;
+  write_binary_row(expected, -1, "51", "doc-1",
+                   FeaturePresenter(row, columns));
+  REQUIRE(expected.release() == binary.release());
+}
+
+static std::string write_blocks(bool background, size_t block_size) {
+  std::ostringstream sink;
+  {
+    FeatureWriter writer(sink, background, block_size);
+    std::ostream out(&writer);
+    for (int i = 0; i < 1000; ++i) {
+      out << "row " << i << '\n';
+      if (0 == i % 100) {
+        out.flush();
+      }
+    }
+  }
+  return sink.str();
+}
+
+TEST_CASE("feature writer output does not depend on buffering") {
+  std::ostringstream expected;
+  for (int i = 0; i < 1000; ++i) {
+    expected << "row " << i << '\n';
+  }
+
+  REQUIRE(expected.str() == write_blocks(false, 1 << 20));
+  REQUIRE(expected.str() == write_blocks(false, 7));
+  REQUIRE(expected.str() == write_blocks(true, 1 << 20));
+  REQUIRE(expected.str() == write_blocks(true, 7));
+  REQUIRE(expected.str() == write_blocks(true, 2));
+}
+
+TEST_CASE("feature writer close is idempotent") {
+  std::ostringstream sink;
+  FeatureWriter writer(sink, true, 16);
+  std::ostream out(&writer);
+  out << "first block of output";
+
+  writer.close();
+  writer.close();
+
+  REQUIRE("first block of output" == sink.str());
+}
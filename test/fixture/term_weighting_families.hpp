@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "fxt/batch_scorer.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/features/features.hpp"
+#include "fxt/fused_scorer.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+
+namespace fixture {
+
+/**
+ * A term weighting family, with its feature class and its first feature.
+ */
+struct TermWeightingFamily {
+  FusedScorer::Family family;
+  std::function<void(const QueryContext &, FeatureRow &,
+                     const QueryTermFreqs &, FamilyMask)>
+      compute;
+  feature::Id first;
+
+  // `BatchScorer` scores every family but probability
+  bool batched() const { return FusedScorer::prob != family.kind; }
+
+  BatchFamily batch_family() const {
+    BatchFamily batch{BatchFamily::Kind(family.kind)};
+    batch.k1 = family.k1;
+    batch.b = family.b;
+    batch.mu = family.mu;
+    return batch;
+  }
+};
+
+// One family of each kind, with the parameters of one of its feature classes.
+inline std::vector<TermWeightingFamily> term_weighting_families() {
+  static doc_bm25_trec3_feature bm25;
+  static doc_lm_dir_1500_feature lm;
+  static doc_tfidf_feature tfidf;
+  static doc_prob_feature prob;
+  static doc_be_feature be;
+  static doc_dph_feature dph;
+  static doc_dfr_feature dfr;
+  using F = FusedScorer::Family;
+  return {
+      {F::make_bm25(bm25.k1, bm25.b),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         bm25.compute(ctx, row, freqs, mask);
+       },
+       feature::bm25_trec3},
+      {F::make_lm(lm.mu),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         lm.compute(ctx, row, freqs, mask);
+       },
+       feature::lm_dir_1500},
+      {F::make(FusedScorer::tfidf),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         tfidf.compute(ctx, row, freqs, mask);
+       },
+       feature::tfidf},
+      {F::make(FusedScorer::prob),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         prob.compute(ctx, row, freqs, mask);
+       },
+       feature::prob},
+      {F::make(FusedScorer::be),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         be.compute(ctx, row, freqs, mask);
+       },
+       feature::be},
+      {F::make(FusedScorer::dph),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         dph.compute(ctx, row, freqs, mask);
+       },
+       feature::dph},
+      {F::make(FusedScorer::dfr),
+       [](auto &ctx, auto &row, auto &freqs, auto mask) {
+         dfr.compute(ctx, row, freqs, mask);
+       },
+       feature::dfr},
+  };
+}
+
+}  // namespace fixture
@@ -0,0 +1,66 @@
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "fxt/fork_join_pool.hpp"
+
+TEST_CASE("a pool of one thread runs jobs on the caller") {
+  ForkJoinPool pool(1);
+  std::thread::id id;
+
+  pool.run([&](size_t t) {
+    REQUIRE(0 == t);
+    id = std::this_thread::get_id();
+  });
+
+  REQUIRE(1 == pool.size());
+  REQUIRE(std::this_thread::get_id() == id);
+}
+
+TEST_CASE("zero threads falls back to one") {
+  ForkJoinPool pool(0);
+  size_t calls = 0;
+
+  pool.run([&](size_t) { ++calls; });
+
+  REQUIRE(1 == pool.size());
+  REQUIRE(1 == calls);
+}
+
+TEST_CASE("each job runs once on every thread of the pool") {
+  ForkJoinPool pool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+
+  for (size_t job = 0; job < 100; ++job) {
+    std::vector<size_t> calls(pool.size());
+    pool.run([&](size_t t) {
+      ++calls[t];
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    });
+    // Every call has returned by the time `run` does
+    REQUIRE(std::vector<size_t>(pool.size(), 1) == calls);
+  }
+
+  // The same threads are used for every job
+  REQUIRE(4 == threads.size());
+}
+
+TEST_CASE("the threads of a pool share a job's work") {
+  ForkJoinPool pool(3);
+  std::atomic<size_t> next(0);
+  std::vector<size_t> done(1000);
+
+  pool.run([&](size_t) {
+    for (size_t i = next++; i < done.size(); i = next++) {
+      ++done[i];
+    }
+  });
+
+  REQUIRE(std::vector<size_t>(done.size(), 1) == done);
+}
@@ -1,5 +1,10 @@
 #include <catch2/catch.hpp>
 
+#include <sstream>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
 #include "fxt/forward_index.hpp"
 
 TEST_CASE("set terms on index of one document") {
@@ -106,6 +111,49 @@ TEST_CASE("document field minimum length initialization") {
   REQUIRE(0 == doc.field_min_len(1));
 }
 
+TEST_CASE("document field slots") {
+  Document doc;
+  doc.set_fields({7, 3});
+  doc.set_field_len(3, 5);
+  // a field with stats that is not one of `fields()`
+  doc.set_field_len(12, 2);
+
+  REQUIRE(0 == doc.field_slot(7));
+  REQUIRE(1 == doc.field_slot(3));
+  REQUIRE(doc.field_slot(12) >= doc.fields().size());
+  REQUIRE(doc.field_slot(4) >= doc.fields().size());
+  REQUIRE(doc.field_slot(1000) >= doc.fields().size());
+  REQUIRE(5 == doc.field_len(3));
+  REQUIRE(2 == doc.field_len(12));
+  REQUIRE(0 == doc.field_len(7));
+  REQUIRE(0 == doc.field_len(1000));
+}
+
+TEST_CASE("document field slots are rebuilt when loaded") {
+  Document doc;
+  doc.set_terms({1, 5, 7});
+  doc.set_fields({2, 0});
+  doc.set_freq(0, 5, 1);
+  doc.set_tag_count(0, 3);
+  doc.set_field_min_len(9, 4);
+  std::stringstream ss;
+  {
+    cereal::BinaryOutputArchive archive(ss);
+    archive(doc);
+  }
+
+  Document loaded;
+  cereal::BinaryInputArchive archive(ss);
+  archive(loaded);
+
+  REQUIRE(1 == loaded.field_slot(0));
+  REQUIRE(1 == loaded.freq(0, 5));
+  REQUIRE(0 == loaded.freq(2, 5));
+  REQUIRE(3 == loaded.tag_count(0));
+  REQUIRE(4 == loaded.field_min_len(9));
+  REQUIRE(0 == loaded.field_min_len(2));
+}
+
 TEST_CASE("document remap terms to local space") {
   Document doc;
   doc.set_terms({1, 5, 7, 7, 1, 1, 1});
@@ -151,3 +199,75 @@ TEST_CASE("compress and decompress document") {
   REQUIRE(10 == doc.terms()[0]);
   REQUIRE(10 == doc.terms()[1]);
 }
+
+TEST_CASE("document field frequencies are sparse") {
+  Document doc;
+  std::vector<uint32_t> terms;
+  for (uint32_t t = 1; t <= 100; ++t) {
+    terms.push_back(t);
+  }
+  doc.set_terms(terms);
+  doc.set_fields({0, 1});
+
+  doc.set_freq(0, 50, 3);
+  doc.set_freq(0, 7, 1);
+  REQUIRE(std::vector<uint32_t>({6, 49, 1, 3}) == doc.field_freqs()[0]);
+  REQUIRE(doc.field_freqs()[1].empty());
+  doc.set_freq(0, 7, 0);
+  REQUIRE(std::vector<uint32_t>({49, 3}) == doc.field_freqs()[0]);
+  REQUIRE(0 == doc.freq(0, 7));
+  REQUIRE(3 == doc.freq(0, 50));
+
+  doc.set_field_freqs(1, {{99, 4}, {2, 1}, {1000, 1}});
+  REQUIRE(std::vector<uint32_t>({1, 98, 1, 4}) == doc.field_freqs()[1]);
+
+  Document copy = doc;
+  doc.compress();
+  // The size of a field depends on its terms, not on those of the document
+  REQUIRE(doc.field_freqs()[0].size() < doc.freqs().size());
+  doc.decompress();
+  REQUIRE(copy.field_freqs() == doc.field_freqs());
+  REQUIRE(3 == doc.freq(0, 50));
+  REQUIRE(4 == doc.freq(1, 99));
+  REQUIRE(0 == doc.freq(1, 50));
+}
+
+TEST_CASE("dense field frequencies are made sparse") {
+  // The dense field frequencies, one for each unique term, of an index
+  // written before they were sparse. The frequencies of a compressed
+  // document are encoded the same way.
+  std::vector<uint32_t> terms = {1, 5, 7, 7, 1, 1, 1};
+  Document dense;
+  dense.set_terms(terms);
+  dense.set_freq(5, 0);
+  std::vector<uint32_t> dense_ff = dense.freqs();
+  dense.compress();
+  std::vector<uint32_t> unique_terms = {1, 5, 7};
+  for (bool compressed : {false, true}) {
+    std::stringstream ss;
+    {
+      std::vector<std::vector<uint32_t>> field_freqs = {
+          compressed ? dense.freqs() : dense_ff};
+      cereal::BinaryOutputArchive archive(ss);
+      archive(size_t(1), std::vector<uint16_t>{3},
+              compressed ? terms.size() : size_t(0),
+              compressed ? dense.terms() : terms,
+              compressed ? dense.unique_terms() : unique_terms,
+              compressed ? dense.freqs() : dense_ff, field_freqs,
+              std::map<uint16_t, Field>());
+    }
+    Document doc;
+    cereal::BinaryInputArchive archive(ss);
+    archive(doc);
+
+    doc.sparsify_field_freqs();
+    if (compressed) {
+      doc.decompress();
+    }
+    INFO((compressed ? "compressed" : "uncompressed"));
+    REQUIRE(std::vector<uint32_t>({0, 2, 4, 2}) == doc.field_freqs()[0]);
+    REQUIRE(4 == doc.freq(3, 1));
+    REQUIRE(0 == doc.freq(3, 5));
+    REQUIRE(2 == doc.freq(3, 7));
+  }
+}
@@ -0,0 +1,132 @@
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/fused_scorer.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+#include "fxt/features/features.hpp"
+
+#include "fixture/term_weighting_families.hpp"
+
+using fixture::term_weighting_families;
+
+TEST_CASE("families scored together match each scored on its own") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 50;
+  opts.doc_len = 60;
+  opts.vocab_size = 100;
+  SyntheticCorpus corpus(opts);
+  // Unindexed fields are skipped
+  FieldIdMap field_ids = corpus.field_ids;
+  field_ids.erase("a");
+  query_train qry = query_train_file::parse_line(
+      "1;t1 t2 t3 t2 t7 t40 t99 not-a-term", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, field_ids, qry);
+
+  // Every family, with every member and with only some of them
+  const auto families = term_weighting_families();
+  FamilyMask some;
+  some[0] = true;
+  some[2] = true;
+  FusedScorer fused;
+  for (const auto &family : families) {
+    FusedScorer::Family all = family.family;
+    all.outputs = {family.first};
+    fused.add(all);
+    FusedScorer::Family masked = family.family;
+    masked.mask = some;
+    masked.outputs = {feature::stream_len};
+    fused.add(masked);
+  }
+
+  QueryTermFreqs freqs;
+  DocumentView doc;
+  for (size_t d = 1; d <= opts.num_docs; ++d) {
+    doc.decode(corpus.documents[d]);
+    freqs.gather(ctx, doc);
+    FeatureRow row = {};
+    fused.score(ctx, freqs, row);
+
+    for (size_t i = 0; i < families.size(); ++i) {
+      const auto &family = families[i];
+      FeatureRow expected = {};
+      family.compute(ctx, expected, freqs, all_members);
+      FeatureRow expected_some = {};
+      family.compute(ctx, expected_some, freqs, some);
+      for (size_t s = 0; s < FusedScorer::slots; ++s) {
+        INFO(feature::name(feature::Id(family.first + s)));
+        REQUIRE(expected[family.first + s] == row[family.first + s]);
+        // The last family written to the same features wins them
+        if (i + 1 == families.size()) {
+          REQUIRE(expected_some[family.first + s] ==
+                  row[feature::stream_len + s]);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("fused scores of a fixed document") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 10;
+  opts.doc_len = 80;
+  opts.vocab_size = 20;
+  SyntheticCorpus corpus(opts);
+  query_train qry = query_train_file::parse_line("1;t1 t2 t3 t7 not-a-term",
+                                                 corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, corpus.field_ids, qry);
+  DocumentView doc;
+  doc.decode(corpus.documents[3]);
+  QueryTermFreqs freqs;
+  freqs.gather(ctx, doc);
+
+  FusedScorer fused;
+  for (const auto &family : term_weighting_families()) {
+    FusedScorer::Family all = family.family;
+    all.outputs = {family.first};
+    fused.add(all);
+  }
+  FeatureRow row = {};
+  fused.score(ctx, freqs, row);
+
+  // The whole document, then the body, title, heading, inlink and a fields
+  const std::vector<std::pair<feature::Id, std::array<double, 6>>> expected = {
+      {feature::bm25_trec3,
+       {7.651625142e-06, 7.651625142e-06, 3.669787234e-06,
+        0.5408052043, 1.12086077, 2.200555156}},
+      {feature::lm_dir_1500,
+       {-20.33701107, -20.33701107, -13.25078474,
+        -18.97575943, -26.81041562, -27.89845987}},
+      {feature::tfidf,
+       {0.02595007844, 0.02595007844, 0.2035699113,
+        0.2081377519, 0.2237688844, 0.3964307987}},
+      {feature::prob,
+       {0.5542168675, 0.5542168675, 0.5,
+        0.625, 0.5, 0.5}},
+      {feature::be,
+       {1.678982859, 1.678982859, 1.135244015,
+        1.933803546, 2.674684426, 3.276805082}},
+      {feature::dph,
+       {1.905554936, 1.905554936, 3.22730541,
+        5.289650615, 6.88566602, 7.891433405}},
+      {feature::dfr,
+       {2.909115264, 2.909115264, 1.364299159,
+        2.558014774, 3.155313276, 5.228660744}},
+  };
+  for (const auto &family : expected) {
+    for (size_t s = 0; s < FusedScorer::slots; ++s) {
+      INFO(feature::name(feature::Id(family.first + s)));
+      REQUIRE(Approx(family.second[s]).epsilon(1e-8) ==
+              row[family.first + s]);
+    }
+  }
+}
@@ -0,0 +1,206 @@
+#include "catch2/catch.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fxt/arena_forward_index.hpp"
+#include "fxt/document_view.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/index_codecs.hpp"
+#include "fxt/inverted_index.hpp"
+#include "fxt/mapped_forward_index.hpp"
+
+namespace {
+
+Document codec_doc() {
+  Document doc(1);
+  doc.set_terms({4, 4, 8, 15, 16, 23, 42});
+  doc.set_fields({2, 3});
+  doc.set_freq(2, 4, 2);
+  doc.set_freq(3, 42, 1);
+  return doc;
+}
+
+}  // namespace
+
+TEST_CASE("index codec header round trips") {
+  IndexCodecs codecs;
+  codecs.set("terms=varint");
+  codecs.set("posting_freqs=copy");
+  REQUIRE("varint" == codecs[IndexStream::terms]);
+  REQUIRE("copy" == codecs[IndexStream::posting_freqs]);
+  REQUIRE(codecs != IndexCodecs());
+
+  std::stringstream ss;
+  codecs.write_header(ss);
+  ss << "rest";
+  REQUIRE(codecs == IndexCodecs::read_header(ss));
+  REQUIRE_FALSE(codecs.dense_field_freqs);
+  std::string rest;
+  ss >> rest;
+  REQUIRE("rest" == rest);
+}
+
+TEST_CASE("index without a codec header uses the default codecs") {
+  std::stringstream ss("no header here");
+  IndexCodecs codecs = IndexCodecs::read_header(ss);
+  REQUIRE(IndexCodecs().names == codecs.names);
+  REQUIRE(codecs.dense_field_freqs);
+  REQUIRE(0 == ss.tellg());
+
+  std::stringstream empty;
+  REQUIRE(IndexCodecs().names == IndexCodecs::read_header(empty).names);
+  REQUIRE_FALSE(IndexCodecs().dense_field_freqs);
+}
+
+TEST_CASE("index codec header rejects bad input") {
+  IndexCodecs codecs;
+  REQUIRE_THROWS_AS(codecs.set("terms"), std::invalid_argument);
+  REQUIRE_THROWS_AS(codecs.set("postings=copy"), std::invalid_argument);
+  REQUIRE_THROWS_AS(codecs.set("terms=nope"), std::invalid_argument);
+  IndexCodecs unknown;
+  unknown.set("posting_docs=nope");
+  REQUIRE_THROWS_AS(StreamCodecs(unknown), std::invalid_argument);
+
+  std::stringstream ss;
+  codecs.write_header(ss);
+  std::string truncated = ss.str();
+  truncated.resize(truncated.size() - 4);
+  std::stringstream short_ss(truncated);
+  REQUIRE_THROWS_AS(IndexCodecs::read_header(short_ss), std::runtime_error);
+}
+
+TEST_CASE("document streams only take stateless codecs") {
+  IndexCodecs codecs;
+  for (auto stream : {"unique_terms", "terms", "freqs", "field_freqs"}) {
+    REQUIRE_THROWS_AS(codecs.set(std::string(stream) + "=simdfastpfor256"),
+                      std::invalid_argument);
+    codecs.set(std::string(stream) + "=varint");
+  }
+  codecs.set("posting_docs=simdfastpfor128");
+  codecs.set("posting_freqs=copy");
+  REQUIRE("varint" == codecs[IndexStream::terms]);
+  REQUIRE("simdfastpfor128" == codecs[IndexStream::posting_docs]);
+}
+
+TEST_CASE("choose the fastest codec within the size target") {
+  std::vector<CodecTrial> trials = {{"small", true, 100, 50.0},
+                                    {"fast", true, 108, 10.0},
+                                    {"fastest", true, 200, 1.0},
+                                    {"broken", false, 1, 0.0}};
+  REQUIRE("fast" == choose_codec(trials, 1.1));
+  REQUIRE("small" == choose_codec(trials, 1.0));
+  REQUIRE("fastest" == choose_codec(trials, 2.0));
+  REQUIRE(choose_codec({{"broken", false, 1, 0.0}}, 1.1).empty());
+}
+
+TEST_CASE("codec trials verify the sample") {
+  std::vector<std::vector<uint32_t>> sample = {{1, 2, 3, 4, 5}, {7}};
+  auto trial = trial_codec("copy", sample);
+  REQUIRE(trial.ok);
+  REQUIRE(trial.words > 0);
+  REQUIRE_FALSE(trial_codec("not-a-codec", sample).ok);
+
+  CodecSample streams;
+  streams.add(codec_doc());
+  streams.add({3, 5, 9}, {1, 1, 2});
+  for (const auto &arrays : streams.streams) {
+    REQUIRE_FALSE(arrays.empty());
+  }
+  IndexCodecs chosen = choose_codecs(streams, 1.1);
+  for (size_t s = 0; s < size_t(IndexStream::posting_docs); ++s) {
+    REQUIRE(is_stateless_codec(chosen.names[s]));
+  }
+}
+
+TEST_CASE("documents and posting lists round trip with chosen codecs") {
+  IndexCodecs codecs;
+  codecs.set("unique_terms=varint");
+  codecs.set("terms=copy");
+  codecs.set("field_freqs=maskedvbyte");
+  codecs.set("posting_docs=varint");
+  auto stream_codecs = std::make_shared<const StreamCodecs>(codecs);
+
+  Document expected = codec_doc();
+  Document doc = codec_doc();
+  doc.compress(*stream_codecs);
+  doc.decompress(*stream_codecs);
+  REQUIRE(expected.terms() == doc.terms());
+  REQUIRE(expected.unique_terms() == doc.unique_terms());
+  REQUIRE(expected.freqs() == doc.freqs());
+  REQUIRE(expected.field_freqs() == doc.field_freqs());
+
+  std::vector<uint32_t> docs = {1, 5, 9};
+  std::vector<uint32_t> freqs = {1, 1, 2};
+  PostingList pl("t", 4, stream_codecs);
+  pl.set(docs, freqs);
+  InvertedIndex inv_idx = {pl};
+  std::stringstream ss;
+  write_inverted_index(ss, inv_idx, *stream_codecs);
+
+  InvertedIndex loaded;
+  read_inverted_index(ss, loaded);
+  REQUIRE(codecs == loaded[0].codecs().names());
+  REQUIRE(IndexCodecs() == StreamCodecs::defaults().names());
+  loaded[0].decode(docs, freqs);
+  REQUIRE(std::vector<uint32_t>({1, 5, 9}) == docs);
+  REQUIRE(std::vector<uint32_t>({1, 1, 2}) == freqs);
+}
+
+TEST_CASE("mapped forward index records its codecs") {
+  IndexCodecs codecs;
+  codecs.set("freqs=varint");
+
+  Document doc = codec_doc();
+  doc.compress(StreamCodecs(codecs));
+  std::string path = "index_codecs.tmp";
+  {
+    MappedForwardIndexWriter writer(path, 2, codecs);
+    writer.add(Document(0));
+    writer.add(doc);
+    writer.finish();
+  }
+
+  MappedForwardIndex mapped(path);
+  REQUIRE(codecs == mapped.codecs().names());
+  Document scratch;
+  DocumentView view;
+  mapped.decode(1, view, scratch);
+  REQUIRE(2 == view.freq(4));
+  REQUIRE(1 == view.freq(42));
+  std::remove(path.c_str());
+}
+
+TEST_CASE("indexes with different codecs are read side by side") {
+  IndexCodecs varint;
+  for (auto stream : {"unique_terms", "terms", "freqs", "field_freqs"}) {
+    varint.set(std::string(stream) + "=varint");
+  }
+  std::vector<std::unique_ptr<ArenaForwardIndex>> arenas;
+  for (const auto &codecs : {IndexCodecs(), varint}) {
+    ForwardIndex fwdidx = {Document(0), codec_doc()};
+    fwdidx[1].compress(StreamCodecs(codecs));
+    std::stringstream ss;
+    codecs.write_header(ss);
+    {
+      cereal::BinaryOutputArchive archive(ss);
+      archive(fwdidx);
+    }
+    arenas.emplace_back(new ArenaForwardIndex(ss));
+    REQUIRE(codecs == arenas.back()->codecs().names());
+  }
+
+  Document scratch;
+  DocumentView view;
+  for (const auto &arena : arenas) {
+    arena->decode(1, view, scratch);
+    REQUIRE(codec_doc().terms().size() == view.length());
+    REQUIRE(2 == view.freq(4));
+    REQUIRE(2 == view.freq(2, 4));
+    REQUIRE(1 == view.freq(3, 42));
+  }
+}
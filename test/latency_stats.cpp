@@ -0,0 +1,52 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+
+#include "fxt/latency_stats.hpp"
+
+TEST_CASE("latency stats with no requests") {
+  LatencyStats stats;
+  auto s = stats.summary();
+
+  REQUIRE(0 == s.count);
+  REQUIRE(0.0 == s.mean);
+  REQUIRE(0.0 == s.p99);
+}
+
+TEST_CASE("latency stats percentiles") {
+  LatencyStats stats;
+  for (int i = 100; i >= 1; --i) {
+    stats.record(i);
+  }
+  auto s = stats.summary();
+
+  REQUIRE(100 == s.count);
+  REQUIRE(50.5 == Approx(s.mean));
+  REQUIRE(51 == Approx(s.p50));
+  REQUIRE(90 == Approx(s.p90));
+  REQUIRE(99 == Approx(s.p99));
+  REQUIRE(100 == Approx(s.max));
+}
+
+TEST_CASE("latency stats percentiles cover the recent window") {
+  LatencyStats stats(4);
+  stats.record(1000);
+  for (int i = 0; i < 4; ++i) {
+    stats.record(1);
+  }
+  auto s = stats.summary();
+
+  REQUIRE(5 == s.count);
+  REQUIRE(1000 == Approx(s.max));
+  REQUIRE(1 == Approx(s.p99));
+}
+
+TEST_CASE("latency stats summary is printable") {
+  LatencyStats stats;
+  stats.record(2);
+  std::ostringstream oss;
+
+  oss << stats.summary();
+
+  REQUIRE(0 == oss.str().find("requests: 1, mean: 2"));
+}
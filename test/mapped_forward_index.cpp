@@ -0,0 +1,161 @@
+#include "catch2/catch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fxt/document_view.hpp"
+#include "fxt/forward_index.hpp"
+#include "fxt/mapped_forward_index.hpp"
+
+static Document mapped_doc(size_t id, const std::vector<uint32_t> &terms) {
+  Document doc(id);
+  doc.set_terms(terms);
+  doc.set_fields({2, 3, 5});
+  doc.set_freq(2, terms[0], 1);
+  doc.set_field_len(2, 1);
+  doc.set_tag_count(2, 1);
+  doc.set_field_min_len(2, 1);
+  doc.set_field_max_len(2, 1);
+  doc.set_field_len_sum_sqrs(2, 1);
+  doc.set_field_len(5, 3);
+  doc.compress();
+  return doc;
+}
+
+static std::string write_mapped(const ForwardIndex &fwdidx) {
+  std::string path = "mapped_forward_index.tmp";
+  MappedForwardIndexWriter writer(path, fwdidx.size());
+  for (const auto &doc : fwdidx) {
+    writer.add(doc);
+  }
+  writer.finish();
+  return path;
+}
+
+TEST_CASE("mapped forward index round trips documents") {
+  ForwardIndex fwdidx = {Document(0), mapped_doc(1, {4, 4, 8, 15, 16, 23}),
+                         mapped_doc(2, {42})};
+  std::string path = write_mapped(fwdidx);
+  REQUIRE(MappedForwardIndex::is_mapped(path));
+  MappedForwardIndex mapped(path);
+  Document scratch;
+
+  REQUIRE(3 == mapped.size());
+  for (size_t i = 0; i < fwdidx.size(); ++i) {
+    const Document &doc = mapped.get(i, scratch);
+    REQUIRE(i == doc.id());
+    REQUIRE(fwdidx[i].terms() == doc.terms());
+    REQUIRE(fwdidx[i].unique_terms() == doc.unique_terms());
+    REQUIRE(fwdidx[i].freqs() == doc.freqs());
+    REQUIRE(fwdidx[i].fields() == doc.fields());
+    REQUIRE(fwdidx[i].field_freqs() == doc.field_freqs());
+    REQUIRE(fwdidx[i].field_stats().size() == doc.field_stats().size());
+  }
+
+  const Document &doc = mapped.get(1, scratch);
+  REQUIRE(1 == doc.tag_count(2));
+  REQUIRE(1 == doc.field_len(2));
+  REQUIRE(3 == doc.field_len(5));
+  REQUIRE(0 == doc.field_len(3));
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("mapped documents decode into a view") {
+  ForwardIndex fwdidx = {Document(0), mapped_doc(1, {1, 5, 7, 7, 1, 1, 1})};
+  std::string path = write_mapped(fwdidx);
+  MappedForwardIndex mapped(path);
+  Document scratch;
+  DocumentView view;
+
+  view.decode(mapped.get(1, scratch));
+
+  REQUIRE(1 == view.id());
+  REQUIRE(7 == view.length());
+  REQUIRE(4 == view.freq(1));
+  REQUIRE(2 == view.freq(7));
+  REQUIRE(1 == view.freq(2, 1));
+
+  DocumentView in_place;
+  mapped.decode(1, in_place, scratch);
+
+  REQUIRE(1 == in_place.id());
+  REQUIRE(7 == in_place.length());
+  REQUIRE(4 == in_place.freq(1));
+  REQUIRE(1 == in_place.freq(2, 1));
+  REQUIRE(1 == in_place.tag_count(2));
+  REQUIRE(3 == in_place.field_len(5));
+  REQUIRE(0 == in_place.field_len(3));
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("cereal forward index is not mapped") {
+  std::string path = "not_mapped_forward_index.tmp";
+  {
+    std::ofstream os(path, std::ios::binary);
+    os << "forward index";
+  }
+
+  REQUIRE_FALSE(MappedForwardIndex::is_mapped(path));
+  REQUIRE_THROWS_AS(MappedForwardIndex(path), std::runtime_error);
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("mapped forward index rejects a corrupt header") {
+  ForwardIndex fwdidx = {Document(0), mapped_doc(1, {4, 8, 15})};
+  std::string path = write_mapped(fwdidx);
+  std::string good;
+  {
+    std::ifstream is(path, std::ios::binary);
+    good.assign(std::istreambuf_iterator<char>(is), {});
+  }
+  // Overwrite a field of a good header and try to open the file
+  auto open_with = [&](size_t offset, uint64_t value, size_t size) {
+    std::string bad = good;
+    bad.replace(offset, size, reinterpret_cast<const char *>(&value), size);
+    std::ofstream(path, std::ios::binary) << bad;
+    MappedForwardIndex mapped(path);
+  };
+  using H = MappedForwardIndexHeader;
+
+  open_with(offsetof(H, version), 2, sizeof(uint32_t));
+  REQUIRE_THROWS_AS(open_with(offsetof(H, version), 1, sizeof(uint32_t)),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(open_with(offsetof(H, version), 3, sizeof(uint32_t)),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(
+      open_with(offsetof(H, codecs_len), good.size(), sizeof(uint32_t)),
+      std::runtime_error);
+  REQUIRE_THROWS_AS(open_with(offsetof(H, num_docs), 1000, sizeof(uint64_t)),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(
+      open_with(offsetof(H, num_docs), UINT64_MAX / 8, sizeof(uint64_t)),
+      std::runtime_error);
+  REQUIRE_THROWS_AS(
+      open_with(offsetof(H, offsets_pos), good.size() + 8, sizeof(uint64_t)),
+      std::runtime_error);
+  REQUIRE_THROWS_AS(open_with(offsetof(H, data_pos), 8, sizeof(uint64_t)),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(
+      open_with(offsetof(H, data_len), good.size(), sizeof(uint64_t)),
+      std::runtime_error);
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("mapped forward index writer checks the document count") {
+  std::string path = "short_mapped_forward_index.tmp";
+  MappedForwardIndexWriter writer(path, 2);
+  writer.add(Document(0));
+
+  REQUIRE_THROWS_AS(writer.finish(), std::logic_error);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,103 @@
+#include "catch2/catch.hpp"
+
+#include "fxt/document_view.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+#include "fxt/features/features.hpp"
+
+namespace {
+
+SyntheticCorpus small_corpus() {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 50;
+  opts.doc_len = 40;
+  opts.vocab_size = 200;
+  return SyntheticCorpus(opts);
+}
+
+}  // namespace
+
+TEST_CASE("query context resolves query terms") {
+  SyntheticCorpus corpus = small_corpus();
+  query_train qry =
+      query_train_file::parse_line("1;t3 t7 t3 not-a-term", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, corpus.field_ids, qry);
+
+  REQUIRE(&qry == &ctx.query());
+  REQUIRE(3 == ctx.terms().size());
+  REQUIRE(corpus.lexicon.document_count() == ctx.document_count());
+  REQUIRE(corpus.lexicon.term_count() == ctx.collection_length());
+
+  size_t t3 = ctx.term_index(3);
+  REQUIRE(t3 < ctx.terms().size());
+  REQUIRE(2 == ctx.terms()[t3].q_ft);
+  REQUIRE_FALSE(ctx.terms()[t3].oov);
+  REQUIRE(corpus.lexicon[3].document_count() == ctx.stats(t3).document_count);
+  REQUIRE(corpus.lexicon[3].term_count() == ctx.stats(t3).term_count);
+
+  size_t oov = ctx.term_index(Lexicon::oov_id);
+  REQUIRE(oov < ctx.terms().size());
+  REQUIRE(ctx.terms()[oov].oov);
+  REQUIRE(0 == ctx.stats(oov).document_count);
+
+  REQUIRE(ctx.terms().size() == ctx.term_index(8));
+}
+
+TEST_CASE("query context resolves fields") {
+  SyntheticCorpus corpus = small_corpus();
+  FieldIdMap field_ids = corpus.field_ids;
+  field_ids.erase("a");
+  query_train qry = query_train_file::parse_line("1;t3", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, field_ids, qry);
+
+  for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+    if ("a" == QueryContext::fields[f]) {
+      REQUIRE(0 == ctx.field_id(f));
+      REQUIRE(0 == ctx.field_stats(0, f).term_count);
+      continue;
+    }
+    int field_id = field_ids.at(QueryContext::fields[f]);
+    REQUIRE(field_id == ctx.field_id(f));
+    REQUIRE(corpus.lexicon[3].field_document_count(field_id) ==
+            ctx.field_stats(0, f).document_count);
+    REQUIRE(corpus.lexicon[3].field_term_count(field_id) ==
+            ctx.field_stats(0, f).term_count);
+  }
+  for (size_t f = 0; f < QueryContext::num_tag_fields; ++f) {
+    REQUIRE(field_ids.at(QueryContext::tag_fields[f]) == ctx.tag_field_id(f));
+  }
+  // Looking up fields must not add them
+  REQUIRE(0 == field_ids.count("a"));
+}
+
+TEST_CASE("query context precomputes the query parts of the scores") {
+  SyntheticCorpus corpus = small_corpus();
+  query_train qry = query_train_file::parse_line("1;t3 t3", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, corpus.field_ids, qry);
+  const auto &stats = ctx.stats(0);
+  uint64_t c_f = stats.term_count;
+  uint64_t c_idf = stats.document_count;
+  uint32_t num_docs = ctx.document_count();
+  double avg_dlen = ctx.avg_doc_len();
+
+  rank_bm25 bm25;
+  bm25.num_docs = num_docs;
+  bm25.avg_doc_len = avg_dlen;
+  bm25.set_k1(0.9);
+  bm25.set_b(0.4);
+  REQUIRE(bm25.calculate_docscore(2, 3, c_idf, 40) ==
+          bm25.calculate_docscore(stats.bm25_w_qt, 3, 40));
+  REQUIRE(calculate_lm(3, c_f, 40, ctx.collection_length(), 2500) ==
+          calculate_lm(3, stats.lm_coll_prob, 40, 2500));
+  REQUIRE(calculate_tfidf(3, c_f, 40, num_docs) ==
+          calculate_tfidf(3, stats.tfidf_w_qt, 40));
+  REQUIRE(calculate_be(3, c_f, num_docs, avg_dlen, 40) ==
+          calculate_be(3, stats.be, avg_dlen, 40));
+  REQUIRE(calculate_dph(3, c_f, num_docs, avg_dlen, 40) ==
+          calculate_dph(3, stats.dph, avg_dlen, 40));
+  REQUIRE(calculate_dfr(3, c_f, c_idf, num_docs, avg_dlen, 40) ==
+          calculate_dfr(3, stats.dfr, c_idf, avg_dlen, 40));
+}
@@ -0,0 +1,68 @@
+#include "catch2/catch.hpp"
+
+#include "fxt/document_view.hpp"
+#include "fxt/field_id.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_freqs.hpp"
+#include "fxt/query_train_file.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+TEST_CASE("query term frequencies match the document view") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 50;
+  opts.doc_len = 40;
+  opts.vocab_size = 200;
+  SyntheticCorpus corpus(opts);
+  // A field that is not indexed reads as empty
+  FieldIdMap field_ids = corpus.field_ids;
+  field_ids.erase("a");
+  query_train qry = query_train_file::parse_line(
+      "1;t1 t2 t3 t7 t2 t150 t199 not-a-term", corpus.lexicon);
+  QueryContext ctx(corpus.lexicon, field_ids, qry);
+
+  QueryTermFreqs freqs;
+  DocumentView doc;
+  for (size_t docid = 1; docid <= opts.num_docs; ++docid) {
+    doc.decode(corpus.documents[docid]);
+    freqs.gather(ctx, doc);
+
+    // The entries are the pairs of the dense frequencies that are scored
+    auto entry = freqs.entries().begin();
+    uint64_t tf_sum = 0;
+    for (size_t t = 0; t < ctx.terms().size(); ++t) {
+      tf_sum += freqs.freq(t);
+      if (ctx.terms()[t].oov || 0 == freqs.freq(t)) {
+        continue;
+      }
+      REQUIRE(t == entry->term);
+      REQUIRE(0 == entry->slot);
+      REQUIRE(freqs.freq(t) == entry->tf);
+      REQUIRE(freqs.length() == entry->len);
+      ++entry;
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        if (ctx.field_id(f) > 0 && freqs.field_len(f) > 0 &&
+            freqs.field_freq(t, f) > 0) {
+          REQUIRE(t == entry->term);
+          REQUIRE(1 + f == entry->slot);
+          REQUIRE(freqs.field_freq(t, f) == entry->tf);
+          REQUIRE(freqs.field_len(f) == entry->len);
+          ++entry;
+        }
+      }
+    }
+    REQUIRE(freqs.entries().end() == entry);
+    REQUIRE(tf_sum == freqs.tf_sum());
+
+    REQUIRE(doc.length() == freqs.length());
+    for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+      REQUIRE(doc.field_len(ctx.field_id(f)) == freqs.field_len(f));
+    }
+    for (size_t t = 0; t < ctx.terms().size(); ++t) {
+      uint64_t id = ctx.terms()[t].id;
+      REQUIRE(doc.freq(id) == freqs.freq(t));
+      for (size_t f = 0; f < QueryContext::num_fields; ++f) {
+        REQUIRE(doc.freq(ctx.field_id(f), id) == freqs.field_freq(t, f));
+      }
+    }
+  }
+}
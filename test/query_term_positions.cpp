@@ -0,0 +1,122 @@
+#include "catch2/catch.hpp"
+
+#include <vector>
+
+#include "fxt/query_term_positions.hpp"
+#include "fxt/query_train_file.hpp"
+
+namespace {
+
+query_train make_query(const std::vector<uint64_t> &tids) {
+  query_train qry;
+  qry.id = "1";
+  for (auto tid : tids) {
+    qry.tids.push_back(tid);
+    qry.q_ft[tid] += 1;
+  }
+  return qry;
+}
+
+std::vector<uint32_t> to_vector(Span<uint32_t> span) {
+  return std::vector<uint32_t>(span.begin(), span.end());
+}
+
+}  // namespace
+
+TEST_CASE("query term positions of a document") {
+  query_train qry = make_query({7, 3, 11});
+  std::vector<uint32_t> terms = {3, 5, 7, 3, 9, 7, 7, 2};
+  QueryTermPositions positions(qry);
+
+  positions.build(terms);
+
+  REQUIRE(3 == positions.size());
+  REQUIRE(std::vector<uint32_t>{2, 5, 6} == to_vector(positions.positions(7)));
+  REQUIRE(std::vector<uint32_t>{0, 3} == to_vector(positions.positions(3)));
+  REQUIRE(positions.positions(11).empty());
+  REQUIRE(positions.positions(5).empty());
+}
+
+TEST_CASE("query term hits are in position order") {
+  query_train qry = make_query({7, 3});
+  std::vector<uint32_t> terms = {3, 5, 7, 3, 9, 7};
+  QueryTermPositions positions(qry);
+
+  positions.build(terms);
+
+  const auto &hits = positions.hits();
+  REQUIRE(4 == hits.size());
+  std::vector<uint32_t> hit_terms, hit_pos;
+  for (const auto &hit : hits) {
+    hit_terms.push_back(hit.term);
+    hit_pos.push_back(hit.pos);
+    REQUIRE(positions.slot(hit.term) == hit.slot);
+  }
+  REQUIRE(std::vector<uint32_t>{3, 7, 3, 7} == hit_terms);
+  REQUIRE(std::vector<uint32_t>{0, 2, 3, 5} == hit_pos);
+}
+
+TEST_CASE("repeated and oov query terms") {
+  // Terms not in the lexicon have id 0, they are matched like any other term
+  query_train qry = make_query({4, 0, 4});
+  std::vector<uint32_t> terms = {4, 0, 1, 4};
+  QueryTermPositions positions(qry);
+
+  positions.build(terms);
+
+  REQUIRE(2 == positions.size());
+  REQUIRE(std::vector<uint32_t>{0, 3} == to_vector(positions.positions(4)));
+  REQUIRE(std::vector<uint32_t>{1} == to_vector(positions.positions(0)));
+  REQUIRE(3 == positions.hits().size());
+}
+
+TEST_CASE("query term positions are rebuilt for each document") {
+  query_train qry = make_query({1, 2});
+  QueryTermPositions positions(qry);
+
+  positions.build(std::vector<uint32_t>{1, 1, 2});
+  positions.build(std::vector<uint32_t>{2, 3});
+
+  REQUIRE(positions.positions(1).empty());
+  REQUIRE(std::vector<uint32_t>{0} == to_vector(positions.positions(2)));
+  REQUIRE(1 == positions.hits().size());
+
+  positions.set_query(make_query({3}));
+  positions.build(std::vector<uint32_t>{2, 3});
+
+  REQUIRE(1 == positions.size());
+  REQUIRE(positions.positions(2).empty());
+  REQUIRE(std::vector<uint32_t>{1} == to_vector(positions.positions(3)));
+}
+
+TEST_CASE("query term positions of an empty query") {
+  QueryTermPositions positions(make_query({}));
+
+  positions.build(std::vector<uint32_t>{1, 2, 3});
+
+  REQUIRE(0 == positions.size());
+  REQUIRE(positions.hits().empty());
+  REQUIRE(positions.positions(1).empty());
+}
+
+TEST_CASE("query term positions with many query terms") {
+  std::vector<uint64_t> tids;
+  for (uint64_t t = 0; t < 100; ++t) {
+    tids.push_back(t * 1024);
+  }
+  QueryTermPositions positions(make_query(tids));
+  std::vector<uint32_t> terms;
+  for (uint32_t t = 0; t < 200 * 1024; t += 512) {
+    terms.push_back(t);
+  }
+
+  positions.build(terms);
+
+  REQUIRE(100 == positions.size());
+  REQUIRE(100 == positions.hits().size());
+  for (uint32_t t = 0; t < 100; ++t) {
+    REQUIRE(std::vector<uint32_t>{2 * t} ==
+            to_vector(positions.positions(t * 1024)));
+  }
+  REQUIRE(positions.positions(512).empty());
+}
@@ -0,0 +1,97 @@
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fxt/reorder_buffer.hpp"
+
+TEST_CASE("blocks written in order are not buffered") {
+  std::ostringstream oss;
+  ReorderBuffer reorder(oss);
+
+  reorder.write(0, "a");
+  reorder.write(1, "b");
+
+  REQUIRE("ab" == oss.str());
+  REQUIRE(0 == reorder.pending());
+}
+
+TEST_CASE("blocks written out of order are held back") {
+  std::ostringstream oss;
+  ReorderBuffer reorder(oss);
+
+  reorder.write(2, "c");
+  reorder.write(1, "b");
+
+  REQUIRE("" == oss.str());
+  REQUIRE(2 == reorder.pending());
+
+  reorder.write(0, "a");
+
+  REQUIRE("abc" == oss.str());
+  REQUIRE(0 == reorder.pending());
+}
+
+TEST_CASE("a window bounds the blocks held back") {
+  const size_t window = 3;
+  const size_t num_blocks = 200;
+  std::ostringstream oss;
+  ReorderBuffer reorder(oss, window);
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> max_pending(0);
+
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < window; ++t) {
+    pool.emplace_back([&]() {
+      for (size_t pos = next++; pos < num_blocks; pos = next++) {
+        reorder.wait(pos);
+        // Every tenth block is slow, as a query with many candidates
+        if (0 == pos % 10) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        reorder.write(pos, std::to_string(pos) + ",");
+        size_t pending = reorder.pending();
+        size_t seen = max_pending;
+        while (pending > seen &&
+               !max_pending.compare_exchange_weak(seen, pending)) {
+        }
+      }
+    });
+  }
+  for (auto &th : pool) {
+    th.join();
+  }
+
+  std::string expected;
+  for (size_t pos = 0; pos < num_blocks; ++pos) {
+    expected += std::to_string(pos) + ",";
+  }
+  REQUIRE(expected == oss.str());
+  REQUIRE(max_pending < window);
+  REQUIRE(0 == reorder.pending());
+}
+
+TEST_CASE("a position outside the window waits for earlier blocks") {
+  std::ostringstream oss;
+  ReorderBuffer reorder(oss, 2);
+  std::atomic<bool> started(false);
+
+  reorder.wait(1);
+  std::thread producer([&]() {
+    reorder.wait(2);
+    started = true;
+    reorder.write(2, "c");
+  });
+  reorder.write(1, "b");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE_FALSE(started);
+
+  reorder.write(0, "a");
+  producer.join();
+  REQUIRE(started);
+  REQUIRE("abc" == oss.str());
+}
@@ -1,9 +1,15 @@
 #include "catch2/catch.hpp"
 
+#include "fxt/document_view.hpp"
+#include "fxt/feature_row.hpp"
+#include "fxt/features/proximity/doc_sdm_feature.hpp"
 #include "fxt/features/proximity/sdm.hpp"
 #include "fxt/forward_index.hpp"
+#include "fxt/forward_index_reader.hpp"
 #include "fxt/inverted_index.hpp"
 #include "fxt/lexicon.hpp"
+#include "fxt/query_context.hpp"
+#include "fxt/query_term_positions.hpp"
 #include "fxt/query_train_file.hpp"
 
 #include "fixture/stub_index.hpp"
@@ -513,6 +519,49 @@ TEST_CASE("SDM score for query 'one two three four' for doc 12") {
   REQUIRE(Approx(-5.32726) == score);
 }
 
+TEST_CASE("SDM phrase counts from query term positions match the document") {
+  const ForwardIndex fwdidx = fixture::stub_forward_index();
+  const Lexicon lexicon = fixture::stub_lexicon();
+  std::vector<std::vector<std::string>> queries = {
+      {"one", "two", "three", "four"},
+      {"two", "two"},
+      {"model", "agnostic"},
+      {"image", "segway", "example"},
+      {"one", "not-a-term", "two"}};
+  Sdm sdm;
+
+  for (const auto &terms : queries) {
+    query_train qry = fixture::stub_query(terms, lexicon);
+    QueryTermPositions positions(qry);
+    for (const auto &doc : fwdidx) {
+      positions.build(doc.terms());
+      for (const auto &bigram : sdm.bigrams(qry)) {
+        REQUIRE(sdm.count_ordered_phrase(bigram, doc) ==
+                sdm.count_ordered_phrase(bigram, positions));
+        REQUIRE(sdm.count_unordered_phrase(bigram, doc) ==
+                sdm.count_unordered_phrase(bigram, positions));
+      }
+    }
+  }
+}
+
+TEST_CASE("SDM score from query term positions matches the document") {
+  const ForwardIndex fwdidx = fixture::stub_forward_index();
+  const Lexicon lexicon = fixture::stub_lexicon();
+  const InvertedIndex invidx = fixture::stub_inverted_index();
+  Document doc = fwdidx[12];
+  query_train qry =
+      fixture::stub_query({"one", "two", "three", "four"}, lexicon);
+  Sdm sdm;
+  sdm.set_context(qry, invidx);
+  QueryTermPositions positions(qry);
+  positions.build(doc.terms());
+
+  double score = sdm.extract(qry, doc, lexicon, fwdidx, invidx, positions);
+
+  REQUIRE(Approx(-5.32726) == score);
+}
+
 TEST_CASE("SDM convert empty query to vector of bigrams") {
   const Lexicon lexicon = fixture::stub_lexicon();
   query_train qry = fixture::stub_query({}, lexicon);
@@ -611,3 +660,62 @@ TEST_CASE("SDM intersect bigrams for query") {
   CHECK(std::equal(expected.begin(), expected.end(), result[0].begin(),
                    result[0].end()));
 }
+
+TEST_CASE("SDM feature scores a reused query id with its own terms") {
+  // Clients of the server may send different queries with the same id
+  const ForwardIndex fwdidx = fixture::stub_forward_index();
+  const Lexicon lexicon = fixture::stub_lexicon();
+  const InvertedIndex invidx = fixture::stub_inverted_index();
+  InMemoryForwardIndex reader(fwdidx);
+  DocumentView doc;
+  doc.decode(fwdidx[16]);
+  query_train qry1 = fixture::stub_query({"model", "agnostic"}, lexicon);
+  query_train qry2 =
+      fixture::stub_query({"image", "segway", "example"}, lexicon);
+  REQUIRE(qry1.id == qry2.id);
+  Sdm sdm;
+  DocSdmFeature f_sdm(sdm);
+  FeatureRow row = {};
+
+  for (auto *qry : {&qry1, &qry2}) {
+    QueryContext ctx(lexicon, FieldIdMap(), *qry);
+    QueryTermPositions positions(*qry);
+    positions.build(doc.terms());
+    f_sdm.set_query(*qry, invidx);
+    f_sdm.compute(ctx, row, doc, reader, invidx, positions);
+    REQUIRE(Approx(qry == &qry1 ? -5.31989 : -6.51295) == row[feature::sdm]);
+  }
+}
+
+TEST_CASE("SDM features share the postings of a query") {
+  const ForwardIndex fwdidx = fixture::stub_forward_index();
+  const Lexicon lexicon = fixture::stub_lexicon();
+  const InvertedIndex invidx = fixture::stub_inverted_index();
+  InMemoryForwardIndex reader(fwdidx);
+  query_train qry =
+      fixture::stub_query({"image", "segway", "example"}, lexicon);
+  QueryContext ctx(lexicon, FieldIdMap(), qry);
+  Sdm sdm;
+  DocSdmFeature own(sdm);
+  own.set_query(qry, invidx);
+  // As the document threads of one query do
+  DocSdmFeature first(sdm);
+  DocSdmFeature second(sdm);
+  auto shared = first.make_context(qry, invidx);
+  first.set_query(qry, shared);
+  second.set_query(qry, shared);
+
+  for (size_t docid = 1; docid < fwdidx.size(); ++docid) {
+    DocumentView doc;
+    doc.decode(fwdidx[docid]);
+    QueryTermPositions positions(qry);
+    positions.build(doc.terms());
+    FeatureRow expected = {};
+    own.compute(ctx, expected, doc, reader, invidx, positions);
+    for (auto *f_sdm : {&first, &second}) {
+      FeatureRow row = {};
+      f_sdm->compute(ctx, row, doc, reader, invidx, positions);
+      REQUIRE(expected[feature::sdm] == row[feature::sdm]);
+    }
+  }
+}
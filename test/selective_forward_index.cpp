@@ -0,0 +1,60 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "cereal/archives/binary.hpp"
+
+#include "fxt/forward_index.hpp"
+#include "fxt/selective_forward_index.hpp"
+
+static std::string archive_of(size_t num_docs) {
+  std::ostringstream os;
+  cereal::BinaryOutputArchive archive(os);
+  archive(num_docs);
+  for (size_t i = 0; i < num_docs; ++i) {
+    Document doc(i);
+    doc.set_terms({uint32_t(i), uint32_t(i + 1)});
+    archive(doc);
+  }
+  return os.str();
+}
+
+TEST_CASE("selective forward index keeps the selected documents") {
+  std::istringstream is(archive_of(8));
+  SelectiveForwardIndex fwdidx(is, {6, 2, 2, 5});
+  Document scratch;
+
+  REQUIRE(8 == fwdidx.size());
+  REQUIRE(3 == fwdidx.loaded());
+  REQUIRE(fwdidx.contains(2));
+  REQUIRE_FALSE(fwdidx.contains(3));
+
+  for (size_t docid : {2, 5, 6}) {
+    const Document &doc = fwdidx.get(docid, scratch);
+    REQUIRE(docid == doc.id());
+    REQUIRE(std::vector<uint32_t>({uint32_t(docid), uint32_t(docid + 1)}) ==
+            doc.terms());
+  }
+  REQUIRE_THROWS_AS(fwdidx.get(3, scratch), std::out_of_range);
+}
+
+TEST_CASE("selective forward index ignores docids past the archive") {
+  std::istringstream is(archive_of(4));
+  SelectiveForwardIndex fwdidx(is, {3, 9});
+  Document scratch;
+
+  REQUIRE(4 == fwdidx.size());
+  REQUIRE(1 == fwdidx.loaded());
+  REQUIRE(3 == fwdidx.get(3, scratch).id());
+  REQUIRE_THROWS_AS(fwdidx.get(9, scratch), std::out_of_range);
+}
+
+TEST_CASE("selective forward index with an empty selection") {
+  std::istringstream is(archive_of(4));
+  SelectiveForwardIndex fwdidx(is, {});
+
+  REQUIRE(4 == fwdidx.size());
+  REQUIRE(0 == fwdidx.loaded());
+}
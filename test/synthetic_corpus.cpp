@@ -0,0 +1,101 @@
+#include "catch2/catch.hpp"
+
+#include "fxt/document_view.hpp"
+#include "fxt/synthetic_corpus.hpp"
+
+TEST_CASE("synthetic corpus is consistent") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 50;
+  opts.doc_len = 40;
+  opts.vocab_size = 200;
+  SyntheticCorpus corpus(opts);
+
+  REQUIRE(51 == corpus.documents.size());
+  REQUIRE(0 == corpus.documents[0].length());
+  REQUIRE(200 == corpus.lexicon.length());
+  REQUIRE(50 == corpus.lexicon.document_count());
+  REQUIRE(201 == corpus.inverted_index.size());
+
+  uint64_t total = 0;
+  DocumentView view;
+  for (size_t i = 1; i < corpus.documents.size(); ++i) {
+    view.decode(corpus.documents[i]);
+    REQUIRE(view.length() >= 20);
+    REQUIRE(view.length() <= 60);
+    REQUIRE(view.field_len(corpus.field_ids["body"]) == view.length());
+    REQUIRE(1 == view.tag_count(corpus.field_ids["title"]));
+    total += view.length();
+  }
+  REQUIRE(total == corpus.lexicon.term_count());
+
+  uint64_t t1_count = 0;
+  for (auto f : corpus.inverted_index[1].get().frequency) {
+    t1_count += f;
+  }
+  REQUIRE(corpus.lexicon[1].term_count() == t1_count);
+  REQUIRE(1 == corpus.lexicon.term("t1"));
+}
+
+TEST_CASE("synthetic queries") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 10;
+  opts.vocab_size = 100;
+  SyntheticCorpus corpus(opts);
+
+  auto queries = corpus.queries(3, 4);
+
+  REQUIRE(3 == queries.size());
+  for (const auto &qry : queries) {
+    REQUIRE(4 == qry.tids.size());
+    REQUIRE(4 == qry.pos.size());
+    for (auto tid : qry.tids) {
+      REQUIRE(Lexicon::oov_id != tid);
+    }
+  }
+  REQUIRE("1" == queries[0].id);
+}
+
+TEST_CASE("synthetic documents are generated independently") {
+  SyntheticCorpusOptions opts;
+  opts.num_docs = 20;
+  opts.doc_len = 100;
+  opts.vocab_size = 500;
+  opts.length_dist = LengthDistribution::lognormal;
+  SyntheticDocuments docs(opts);
+  SyntheticCorpus corpus(opts);
+
+  // Out of order, and more than once
+  DocumentView view;
+  for (size_t docid : {7, 3, 20, 7, 1}) {
+    auto terms = docs.terms(docid);
+    REQUIRE(terms == docs.terms(docid));
+    view.decode(corpus.documents[docid]);
+    REQUIRE(terms.size() == view.length());
+    REQUIRE(terms.size() == docs.static_feature(docid, terms).dentry.len);
+  }
+  REQUIRE("SYN-000000007" == docs.docno(7));
+
+  opts.seed += 1;
+  REQUIRE(docs.terms(1) != SyntheticDocuments(opts).terms(1));
+}
+
+TEST_CASE("synthetic field structure") {
+  SyntheticCorpusOptions opts;
+  opts.length_dist = LengthDistribution::fixed;
+  opts.doc_len = 100;
+  opts.title_len = 5;
+  opts.headings = 0;
+  opts.anchors = 2;
+  opts.anchor_len = 6;
+  opts.inlink_len = 0;
+  SyntheticDocuments docs(opts);
+
+  auto terms = docs.terms(1);
+  REQUIRE(100 == terms.size());
+  auto doc = docs.document(1, terms);
+  REQUIRE(5 == doc.field_len(docs.field_ids["title"]));
+  REQUIRE(0 == doc.tag_count(docs.field_ids["heading"]));
+  REQUIRE(2 == doc.tag_count(docs.field_ids["a"]));
+  REQUIRE(12 == doc.field_len(docs.field_ids["a"]));
+  REQUIRE(0 == doc.tag_count(docs.field_ids["inlink"]));
+}
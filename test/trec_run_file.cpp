@@ -0,0 +1,61 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fxt/trec_run_file.hpp"
+
+TEST_CASE("run stream groups consecutive lines by query") {
+  std::istringstream is(
+      "51 Q0 doc-1 1 12.5 run\n"
+      "51 Q0 doc-2 2 11.0 run\n"
+      "\n"
+      "52 1 doc-7 1 9.25 run\n");
+  trec_run_stream run(is);
+  trec_run_group group;
+
+  REQUIRE(run.next(group));
+  REQUIRE("51" == group.id);
+  REQUIRE(std::vector<std::string>({"doc-1", "doc-2"}) == group.docnos);
+  REQUIRE(std::vector<int>({0, 0}) == group.labels);
+  REQUIRE(std::vector<double>({12.5, 11.0}) == group.scores);
+  REQUIRE(group.query.empty());
+
+  REQUIRE(run.next(group));
+  REQUIRE("52" == group.id);
+  REQUIRE(std::vector<std::string>({"doc-7"}) == group.docnos);
+  REQUIRE(std::vector<int>({1}) == group.labels);
+
+  REQUIRE_FALSE(run.next(group));
+  REQUIRE_FALSE(run.next(group));
+}
+
+TEST_CASE("run stream reads inline query terms") {
+  std::istringstream is(
+      "51 Q0 doc-1 1 12.5 run foo bar\n"
+      "51 Q0 doc-2 2 11.0 run foo bar\n");
+  trec_run_stream run(is);
+  trec_run_group group;
+
+  REQUIRE(run.next(group));
+  REQUIRE("foo bar" == group.query);
+  REQUIRE(2 == group.docnos.size());
+}
+
+TEST_CASE("run stream rejects short lines") {
+  std::istringstream is("51 Q0 doc-1 1\n");
+  trec_run_stream run(is);
+  trec_run_group group;
+
+  REQUIRE_THROWS_AS(run.next(group), std::logic_error);
+}
+
+TEST_CASE("run stream of empty input") {
+  std::istringstream is("");
+  trec_run_stream run(is);
+  trec_run_group group;
+
+  REQUIRE_FALSE(run.next(group));
+}
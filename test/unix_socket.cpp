@@ -0,0 +1,58 @@
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "fxt/unix_socket.hpp"
+
+TEST_CASE("unix socket request and response") {
+  UnixSocketServer server("fxt_test.sock");
+
+  std::thread handler([&]() {
+    int fd = server.accept();
+    FdStreamBuf buf(fd);
+    std::iostream io(&buf);
+    std::string line;
+    while (std::getline(io, line) && !line.empty()) {
+      io << "echo " << line << "\n";
+    }
+    io << "\n" << std::flush;
+    ::close(fd);
+  });
+
+  int fd = unix_socket_connect("fxt_test.sock");
+  {
+    FdStreamBuf buf(fd);
+    std::iostream io(&buf);
+    io << "51;foo bar\ndoc-1\n\n" << std::flush;
+
+    std::string line;
+    REQUIRE(std::getline(io, line));
+    REQUIRE("echo 51;foo bar" == line);
+    REQUIRE(std::getline(io, line));
+    REQUIRE("echo doc-1" == line);
+    REQUIRE(std::getline(io, line));
+    REQUIRE(line.empty());
+  }
+  ::close(fd);
+  handler.join();
+}
+
+TEST_CASE("unix socket server shutdown wakes accept") {
+  UnixSocketServer server("fxt_test.sock");
+  int fd = 0;
+
+  std::thread handler([&]() { fd = server.accept(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  server.shutdown();
+  handler.join();
+
+  REQUIRE(-1 == fd);
+}
+
+TEST_CASE("unix socket connect to missing server") {
+  REQUIRE_THROWS_AS(unix_socket_connect("fxt_missing.sock"),
+                    std::runtime_error);
+}